@@ -65,6 +65,20 @@ enum class DrivingEventType : uint8_t
     IDLE_EXCESSIVE = 4
 };
 
+// Id spaces with a persisted high-water mark in SDMHeader::id_high_water
+enum class IdSpace : uint8_t
+{
+    DRIVER = 0,
+    VEHICLE = 1,
+    TRIP = 2,
+    MAINTENANCE = 3,
+    EXPENSE = 4,
+    DOCUMENT = 5,
+    INCIDENT = 6,
+    ALERT = 7,
+    COUNT = 8
+};
+
 //DATABASE HEADER
 struct SDMHeader
 {
@@ -93,7 +107,14 @@ struct SDMHeader
     uint32_t max_vehicles;              // 4 (180)
     uint32_t max_trips;                 // 4 (184)
 
-    uint8_t reserved[3912];
+    // Highest id leased so far, indexed by IdSpace
+    uint64_t id_high_water[8];          // 64 (248)
+
+    // Non-zero once id_high_water has been checked against the tables;
+    // files from before the marks existed have zeros in both
+    uint32_t id_high_water_seeded;      // 4 (252)
+
+    uint8_t reserved[3844];
 
     SDMHeader() : version(0x00010000), total_size(0), created_time(0),
                   last_modified(0), driver_table_offset(0), vehicle_table_offset(0),
@@ -101,10 +122,11 @@ struct SDMHeader
                   expense_table_offset(0), document_table_offset(0),
                   incident_table_offset(0), primary_index_offset(0),
                   secondary_index_offset(0), max_drivers(10000),
-                  max_vehicles(50000), max_trips(10000000)
+                  max_vehicles(50000), max_trips(10000000), id_high_water_seeded(0)
     {
         strncpy(magic, "SDMDB001", 8);
         memset(creator_info, 0, sizeof(creator_info));
+        memset(id_high_water, 0, sizeof(id_high_water));
         memset(reserved, 0, sizeof(reserved));
     }
 };
@@ -262,10 +284,14 @@ struct TripRecord
     
     // Notes
     char notes[256];             // 256 (648)
+
+    // Byte offset just past the trip's last GPS log entry; 0 in trips
+    // recorded before it was kept
+    uint64_t gps_data_end_offset; // 8 (656)
     
     // Padding to make exactly 1024 bytes
-    // Total so far: 648 bytes, need 1024 - 648 = 376 bytes padding
-    uint8_t reserved[376];
+    // Total so far: 656 bytes, need 1024 - 656 = 368 bytes padding
+    uint8_t reserved[368];
 
     TripRecord() : trip_id(0), driver_id(0), vehicle_id(0), start_time(0),
                    end_time(0), duration(0), start_latitude(0), start_longitude(0),
@@ -273,7 +299,7 @@ struct TripRecord
                    max_speed(0), fuel_consumed(0), fuel_efficiency(0),
                    harsh_braking_count(0), rapid_acceleration_count(0),
                    speeding_count(0), sharp_turn_count(0), gps_data_offset(0),
-                   gps_data_count(0)
+                   gps_data_count(0), gps_data_end_offset(0)
     {
         memset(start_address, 0, sizeof(start_address));
         memset(end_address, 0, sizeof(end_address));
@@ -302,6 +328,18 @@ struct GPSWaypoint
     }
 };
 
+static_assert(sizeof(GPSWaypoint) == 40, "GPSWaypoint must be 40 bytes");
+
+// One record of the append-only GPS log (<database>.gps)
+struct GPSLogEntry
+{
+    uint64_t trip_id;        // 8 bytes
+    GPSWaypoint waypoint;    // 40 (48)
+
+    GPSLogEntry() : trip_id(0) {}
+};
+
+static_assert(sizeof(GPSLogEntry) == 48, "GPSLogEntry must be 48 bytes");
 
 struct MaintenanceRecord
 {
@@ -486,15 +524,18 @@ struct IncidentReport
     
     char notes[256];             // 256 (1802)
     
+    // Crash telemetry (CrashRecorder capture offset, 0 = none)
+    uint64_t telemetry_capture_id; // 8 (1810)
+    
     // Padding to make exactly 2048 bytes
-    // Total: 1802 bytes, need 2048 - 1802 = 246 bytes padding
-    uint8_t reserved[246];
+    // Total: 1810 bytes, need 2048 - 1810 = 238 bytes padding
+    uint8_t reserved[238];
 
     IncidentReport() : incident_id(0), driver_id(0), vehicle_id(0), trip_id(0),
                        type(IncidentType::ACCIDENT), incident_time(0),
                        latitude(0), longitude(0), estimated_damage(0),
                        insurance_payout(0), report_doc_id(0), is_resolved(0),
-                       resolved_date(0)
+                       resolved_date(0), telemetry_capture_id(0)
     {
         memset(location_address, 0, sizeof(location_address));
         memset(description, 0, sizeof(description));
@@ -31,6 +31,8 @@ private:
     ExpenseManager *expense_manager_;
     DriverManager *driver_manager_;
     IncidentManager *incident_manager_;
+    RollupManager *rollup_manager_;
+    ExpiryIndex *expiry_index_;
 
     // Current session
     string current_session_id_;
@@ -58,7 +60,8 @@ public:
           session_manager_(nullptr), trip_manager_(nullptr),
           vehicle_manager_(nullptr), expense_manager_(nullptr),
           driver_manager_(nullptr),
-          incident_manager_(nullptr) {}
+          incident_manager_(nullptr), rollup_manager_(nullptr),
+          expiry_index_(nullptr) {}
 
     ~MenuSystem()
     {
@@ -159,7 +162,33 @@ public:
         driver_manager_ = new DriverManager(*db_manager_, *cache_manager_,
                                             *index_manager_);
        
-        incident_manager_ = new IncidentManager(*db_manager_, *cache_manager_);
+        incident_manager_ = new IncidentManager(*db_manager_, *cache_manager_, *index_manager_);
+
+        DriverLeaderboard &leaderboard = driver_manager_->leaderboard();
+        session_manager_->set_leaderboard(&leaderboard);
+        trip_manager_->set_leaderboard(&leaderboard);
+        incident_manager_->set_leaderboard(&leaderboard);
+
+        expiry_index_ = new ExpiryIndex();
+        expiry_index_->rebuild(*db_manager_);
+        driver_manager_->set_expiry_index(expiry_index_);
+        vehicle_manager_->set_expiry_index(expiry_index_);
+
+        rollup_manager_ = new RollupManager(config_.database_path + ".rollup");
+        bool rollups_existed = false;
+        if (rollup_manager_->open(rollups_existed))
+        {
+            if (!rollups_existed)
+            {
+                rollup_manager_->rebuild(*db_manager_);
+            }
+            else
+            {
+                rollup_manager_->rebuild_sketches(*db_manager_);
+            }
+            trip_manager_->set_rollups(rollup_manager_);
+            expense_manager_->set_rollups(rollup_manager_);
+        }
 
         cout << " ✓" << endl;
 
@@ -1362,12 +1391,15 @@ public:
         
         delete incident_manager_;
         
-        delete driver_manager_;
         delete expense_manager_;
         delete vehicle_manager_;
         delete trip_manager_;
+        delete rollup_manager_;
+        delete expiry_index_;
         
         delete session_manager_;
+        // Owns the leaderboard the trip, incident and session managers point at
+        delete driver_manager_;
         delete security_manager_;
         delete index_manager_;
         delete cache_manager_;
@@ -14,16 +14,14 @@ SDMServer *g_server = nullptr;
 
 void signal_handler(int signal)
 {
+    // main returns once the listener exits, and ~SDMServer then joins the
+    // workers and closes the database so its column files are marked clean
     if (signal == SIGINT || signal == SIGTERM)
     {
-        cout << endl
-             << endl;
-        cout << "Received shutdown signal..." << endl;
         if (g_server)
         {
-            g_server->stop();
+            g_server->request_shutdown();
         }
-        exit(0);
     }
 }
 
@@ -141,6 +139,7 @@ int main(int argc, char *argv[])
         }
 
         server.wait_for_shutdown();
+        g_server = nullptr;
     }
     else
     {
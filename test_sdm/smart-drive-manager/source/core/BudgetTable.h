@@ -0,0 +1,252 @@
+#ifndef BUDGETTABLE_H
+#define BUDGETTABLE_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/ExpenseAggregates.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+#pragma pack(push, 1)
+
+// One logged budget setting; the last record for a (driver, category) wins
+struct BudgetLimitRecord
+{
+    uint64_t driver_id;
+    uint8_t category;
+    uint8_t reserved[3];
+    uint32_t alert_percentage;
+    double monthly_limit;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(BudgetLimitRecord) == 24, "BudgetLimitRecord must be 24 bytes");
+
+struct BudgetState
+{
+    uint64_t driver_id;
+    ExpenseCategory category;
+    double monthly_limit;
+    uint32_t alert_percentage;
+    int32_t month; // period the running total covers, as ExpenseAggregates::month_of
+    double spent;
+
+    bool alerting() const
+    {
+        return spent > monthly_limit ||
+               (monthly_limit > 0 && spent / monthly_limit * 100.0 >= alert_percentage);
+    }
+};
+
+// Monthly budget limits per (driver, category) with a running total of the
+// current month's spend, so checking a budget is one hash lookup. Limits are
+// appended to <db>.budgets and replayed on open. Totals are not stored: a
+// budget reads its month's spend from the expense aggregates when it is
+// loaded or a new month begins, then follows each recorded expense.
+class BudgetTable
+{
+private:
+    string filename_;
+    ofstream log_;
+    ExpenseAggregates &aggregates_;
+    unordered_map<uint64_t, BudgetState> budgets_;
+    uint64_t log_records_;
+    mutex mtx_;
+
+    static constexpr uint64_t COMPACT_MIN_RECORDS = 1024;
+
+    static uint64_t budget_key(uint64_t driver_id, int category)
+    {
+        return (driver_id << 3) | (uint64_t)category;
+    }
+
+    // Caller holds mtx_. Starts the running total over when the month moved.
+    BudgetState &current_locked(BudgetState &budget, int32_t month)
+    {
+        if (budget.month != month)
+        {
+            budget.month = month;
+            budget.spent = aggregates_.spent(budget.driver_id, month, budget.category);
+        }
+        return budget;
+    }
+
+    // Caller holds mtx_
+    void apply_locked(const BudgetLimitRecord &record, int32_t month)
+    {
+        int category = ExpenseAggregates::category_slot((ExpenseCategory)record.category);
+        uint64_t key = budget_key(record.driver_id, category);
+
+        auto it = budgets_.find(key);
+        if (it == budgets_.end())
+        {
+            BudgetState budget;
+            budget.driver_id = record.driver_id;
+            budget.category = (ExpenseCategory)category;
+            budget.month = month - 1; // forces a read of this month's spend
+            budget.spent = 0;
+            it = budgets_.emplace(key, budget).first;
+            current_locked(it->second, month);
+        }
+        it->second.monthly_limit = record.monthly_limit;
+        it->second.alert_percentage = record.alert_percentage;
+    }
+
+    // Caller holds mtx_. Writes one record per budget and swaps it in.
+    bool compact_locked()
+    {
+        string tmp = filename_ + ".tmp";
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        for (const auto &entry : budgets_)
+        {
+            BudgetLimitRecord r = make_record(entry.second.driver_id, entry.second.category,
+                                              entry.second.monthly_limit, entry.second.alert_percentage);
+            out.write(reinterpret_cast<const char *>(&r), sizeof(r));
+        }
+        out.close();
+        if (!out.good())
+            return false;
+
+        log_.close();
+        if (rename(tmp.c_str(), filename_.c_str()) != 0)
+        {
+            log_.open(filename_, ios::binary | ios::app);
+            return false;
+        }
+
+        log_.open(filename_, ios::binary | ios::app);
+        log_records_ = budgets_.size();
+        return log_.is_open();
+    }
+
+    static BudgetLimitRecord make_record(uint64_t driver_id, ExpenseCategory category,
+                                         double monthly_limit, uint32_t alert_percentage)
+    {
+        BudgetLimitRecord r;
+        memset(&r, 0, sizeof(r));
+        r.driver_id = driver_id;
+        r.category = (uint8_t)category;
+        r.alert_percentage = alert_percentage;
+        r.monthly_limit = monthly_limit;
+        return r;
+    }
+
+public:
+    BudgetTable(const string &filename, ExpenseAggregates &aggregates)
+        : filename_(filename), aggregates_(aggregates), log_records_(0) {}
+
+    ~BudgetTable()
+    {
+        close();
+    }
+
+    // month is the current one, as ExpenseAggregates::month_of
+    bool open(int32_t month)
+    {
+        lock_guard<mutex> lock(mtx_);
+        budgets_.clear();
+        log_records_ = 0;
+
+        ifstream in(filename_, ios::binary);
+        BudgetLimitRecord record;
+        while (in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+        {
+            apply_locked(record, month);
+            log_records_++;
+        }
+        in.close();
+
+        log_.open(filename_, ios::binary | ios::app);
+        return log_.is_open();
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (log_.is_open())
+            log_.close();
+    }
+
+    // Adds or changes a budget; the spend so far this month counts towards it
+    bool set(uint64_t driver_id, ExpenseCategory category, double monthly_limit,
+             uint32_t alert_percentage, int32_t month)
+    {
+        BudgetLimitRecord record = make_record(driver_id, category, monthly_limit, alert_percentage);
+
+        lock_guard<mutex> lock(mtx_);
+        if (!log_.is_open())
+            return false;
+
+        apply_locked(record, month);
+        log_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        log_.flush();
+        log_records_++;
+
+        if (log_records_ > COMPACT_MIN_RECORDS && log_records_ > 4 * budgets_.size())
+            compact_locked();
+
+        return log_.good();
+    }
+
+    // Follows an expense before it reaches the aggregates; sign = -1 backs
+    // one out. Only expenses dated in the current month move a total.
+    // Returns the budget's state when it has one for the expense.
+    bool record(const ExpenseRecord &expense, int sign, int32_t month, BudgetState &out)
+    {
+        int category = ExpenseAggregates::category_slot(expense.category);
+
+        lock_guard<mutex> lock(mtx_);
+        auto it = budgets_.find(budget_key(expense.driver_id, category));
+        if (it == budgets_.end())
+            return false;
+
+        BudgetState &budget = current_locked(it->second, month);
+        if (ExpenseAggregates::month_of(expense.expense_date) == month)
+            budget.spent += sign * expense.amount;
+        out = budget;
+        return true;
+    }
+
+    bool find(uint64_t driver_id, ExpenseCategory category, int32_t month, BudgetState &out)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = budgets_.find(budget_key(driver_id, ExpenseAggregates::category_slot(category)));
+        if (it == budgets_.end())
+            return false;
+
+        out = current_locked(it->second, month);
+        return true;
+    }
+
+    // The driver's budgets in category order
+    vector<BudgetState> driver_budgets(uint64_t driver_id, int32_t month)
+    {
+        vector<BudgetState> result;
+
+        lock_guard<mutex> lock(mtx_);
+        for (int c = 0; c < EXPENSE_CATEGORIES; c++)
+        {
+            auto it = budgets_.find(budget_key(driver_id, c));
+            if (it != budgets_.end())
+                result.push_back(current_locked(it->second, month));
+        }
+        return result;
+    }
+
+    size_t size()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return budgets_.size();
+    }
+};
+
+#endif
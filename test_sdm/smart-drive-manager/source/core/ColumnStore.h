@@ -0,0 +1,650 @@
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include "../../include/sdm_types.hpp"
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+#pragma pack(push, 1)
+struct ColumnFileHeader
+{
+    char magic[8];         // "SDMCOL1"
+    uint32_t version;
+    uint32_t clean;        // 1 after an orderly close; 0 while open
+    uint64_t slots;
+    uint32_t column_count;
+    uint8_t reserved[36];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ColumnFileHeader) == 64, "ColumnFileHeader must be 64 bytes");
+
+// One memory-mapped file holding a table's hot fields as separate arrays of
+// `slots` values, each starting on a 64-byte boundary. Slot i of every column
+// mirrors slot i of the table; unused slots are all zeroes.
+class ColumnFile
+{
+private:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    int fd_;
+    uint8_t *map_;
+    size_t map_size_;
+    uint64_t slots_;
+    vector<size_t> offsets_;
+
+    static size_t align64(size_t n) { return (n + 63) & ~(size_t)63; }
+
+    ColumnFileHeader *header() { return reinterpret_cast<ColumnFileHeader *>(map_); }
+
+public:
+    ColumnFile() : fd_(-1), map_(nullptr), map_size_(0), slots_(0) {}
+
+    ~ColumnFile()
+    {
+        close();
+    }
+
+    ColumnFile(const ColumnFile &) = delete;
+    ColumnFile &operator=(const ColumnFile &) = delete;
+
+    // Maps the file, creating or resizing it as needed. stale is set when
+    // the contents cannot be trusted (new file, different layout, or not
+    // closed cleanly) and the caller must rewrite every slot.
+    bool open(const string &path, uint64_t slots, const vector<size_t> &widths, bool &stale)
+    {
+        close();
+
+        offsets_.clear();
+        size_t size = align64(sizeof(ColumnFileHeader));
+        for (size_t width : widths)
+        {
+            offsets_.push_back(size);
+            size = align64(size + width * slots);
+        }
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0)
+        {
+            close();
+            return false;
+        }
+        stale = (size_t)st.st_size != size;
+        if (stale && ftruncate(fd_, 0) != 0)
+        {
+            close();
+            return false;
+        }
+        if (stale && ftruncate(fd_, (off_t)size) != 0)
+        {
+            close();
+            return false;
+        }
+
+        void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        map_ = static_cast<uint8_t *>(map);
+        map_size_ = size;
+        slots_ = slots;
+
+        ColumnFileHeader *h = header();
+        if (memcmp(h->magic, "SDMCOL1", 8) != 0 || h->version != FORMAT_VERSION ||
+            h->slots != slots || h->column_count != widths.size() || h->clean != 1)
+        {
+            stale = true;
+        }
+        if (stale)
+        {
+            memcpy(h->magic, "SDMCOL1", 8);
+            h->version = FORMAT_VERSION;
+            h->slots = slots;
+            h->column_count = (uint32_t)widths.size();
+        }
+
+        h->clean = 0;
+        msync(map_, sizeof(ColumnFileHeader), MS_SYNC);
+        return true;
+    }
+
+    void close()
+    {
+        if (map_)
+        {
+            header()->clean = 1;
+            msync(map_, map_size_, MS_SYNC);
+            munmap(map_, map_size_);
+        }
+        if (fd_ >= 0)
+            ::close(fd_);
+
+        fd_ = -1;
+        map_ = nullptr;
+        map_size_ = 0;
+        slots_ = 0;
+    }
+
+    bool is_open() const { return map_ != nullptr; }
+    uint64_t slots() const { return slots_; }
+
+    template <typename T>
+    T *column(int index)
+    {
+        return reinterpret_cast<T *>(map_ + offsets_[index]);
+    }
+};
+
+// Aggregation kernels work on 4 slots at a time in 256-bit vectors (GCC/Clang
+// vector extensions; one AVX2 register with -march=native). Filters become
+// all-ones/all-zero lane masks that are ANDed into the values, so the loops
+// have no branches. Narrow columns are widened to 64-bit lanes on load.
+// Helpers take 256-bit vectors by reference and write results through
+// out-parameters: passed or returned by value they change the ABI when built
+// without AVX (-Wpsabi).
+typedef double f64x4 __attribute__((vector_size(32)));
+typedef int64_t i64x4 __attribute__((vector_size(32)));
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint8_t u8x4 __attribute__((vector_size(4)));
+typedef uint16_t u16x4 __attribute__((vector_size(8)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+namespace column_simd
+{
+    template <typename V, typename T>
+    inline void load(V &out, const T *p) { memcpy(&out, p, sizeof(V)); }
+
+    template <typename N, typename T>
+    inline void widen_as(i64x4 &out, const T *p)
+    {
+        N narrow;
+        load(narrow, p);
+        out = __builtin_convertvector(narrow, i64x4);
+    }
+
+    inline void widen(i64x4 &out, const uint8_t *p) { widen_as<u8x4>(out, p); }
+    inline void widen(i64x4 &out, const uint16_t *p) { widen_as<u16x4>(out, p); }
+    inline void widen(i64x4 &out, const uint32_t *p) { widen_as<u32x4>(out, p); }
+
+    // x where mask is set, +0.0 elsewhere
+    inline void keep(f64x4 &x, const i64x4 &mask) { x = (f64x4)((i64x4)x & mask); }
+
+    inline double sum(const f64x4 &v) { return (v[0] + v[1]) + (v[2] + v[3]); }
+    inline int64_t sum(const i64x4 &v) { return (v[0] + v[1]) + (v[2] + v[3]); }
+    inline double max(const f64x4 &v) { return std::max(std::max(v[0], v[1]), std::max(v[2], v[3])); }
+}
+
+struct TripColumnTotals
+{
+    uint64_t trips;
+    double distance;
+    double duration;
+    double fuel;
+    double max_speed;
+    uint64_t harsh_braking;
+    uint64_t rapid_acceleration;
+    uint64_t speeding;
+    uint64_t sharp_turns;
+};
+
+// Finished and in-progress trips: ids, times and the metrics analytics read
+class TripColumns
+{
+private:
+    ColumnFile file_;
+    uint8_t *live_;
+    uint64_t *driver_id_;
+    uint64_t *vehicle_id_;
+    uint64_t *start_time_;
+    uint64_t *end_time_;
+    uint32_t *duration_;
+    double *distance_;
+    double *max_speed_;
+    double *fuel_;
+    uint16_t *harsh_braking_;
+    uint16_t *rapid_acceleration_;
+    uint16_t *speeding_;
+    uint16_t *sharp_turns_;
+
+public:
+    bool open(const string &path, uint64_t slots, bool &stale)
+    {
+        vector<size_t> widths = {1, 8, 8, 8, 8, 4, 8, 8, 8, 2, 2, 2, 2};
+        if (!file_.open(path, slots, widths, stale))
+            return false;
+
+        live_ = file_.column<uint8_t>(0);
+        driver_id_ = file_.column<uint64_t>(1);
+        vehicle_id_ = file_.column<uint64_t>(2);
+        start_time_ = file_.column<uint64_t>(3);
+        end_time_ = file_.column<uint64_t>(4);
+        duration_ = file_.column<uint32_t>(5);
+        distance_ = file_.column<double>(6);
+        max_speed_ = file_.column<double>(7);
+        fuel_ = file_.column<double>(8);
+        harsh_braking_ = file_.column<uint16_t>(9);
+        rapid_acceleration_ = file_.column<uint16_t>(10);
+        speeding_ = file_.column<uint16_t>(11);
+        sharp_turns_ = file_.column<uint16_t>(12);
+        return true;
+    }
+
+    void close() { file_.close(); }
+    bool is_open() const { return file_.is_open(); }
+
+    void put(uint64_t slot, const TripRecord &trip)
+    {
+        if (slot >= file_.slots())
+            return;
+
+        bool live = trip.trip_id != 0;
+        live_[slot] = live;
+        driver_id_[slot] = live ? trip.driver_id : 0;
+        vehicle_id_[slot] = live ? trip.vehicle_id : 0;
+        start_time_[slot] = live ? trip.start_time : 0;
+        end_time_[slot] = live ? trip.end_time : 0;
+        duration_[slot] = live ? trip.duration : 0;
+        distance_[slot] = live ? trip.distance : 0;
+        max_speed_[slot] = live ? trip.max_speed : 0;
+        fuel_[slot] = live ? trip.fuel_consumed : 0;
+        harsh_braking_[slot] = live ? trip.harsh_braking_count : 0;
+        rapid_acceleration_[slot] = live ? trip.rapid_acceleration_count : 0;
+        speeding_[slot] = live ? trip.speeding_count : 0;
+        sharp_turns_[slot] = live ? trip.sharp_turn_count : 0;
+    }
+
+    // Used slots, finished or not
+    uint64_t count() const
+    {
+        const uint8_t *__restrict live = live_;
+        uint64_t n = 0;
+        for (size_t i = 0; i < file_.slots(); i++)
+            n += live[i];
+        return n;
+    }
+
+    // fn(driver_id, vehicle_id, start_time, duration, distance) for every
+    // finished trip, in slot order
+    template <typename Fn>
+    void for_each_finished(Fn fn) const
+    {
+        for (size_t i = 0; i < file_.slots(); i++)
+        {
+            if (live_[i] && end_time_[i] != 0)
+                fn(driver_id_[i], vehicle_id_[i], start_time_[i], duration_[i], distance_[i]);
+        }
+    }
+
+    // Finished trips with from <= start_time <= to. A driver or vehicle id
+    // of 0 matches any.
+    TripColumnTotals totals(uint64_t driver_id, uint64_t vehicle_id,
+                            uint64_t from, uint64_t to) const
+    {
+        using namespace column_simd;
+
+        int64_t any_driver = driver_id == 0 ? -1 : 0;
+        int64_t any_vehicle = vehicle_id == 0 ? -1 : 0;
+
+        i64x4 trips = {}, braking = {}, acceleration = {}, speeding = {}, turns = {};
+        f64x4 distance = {}, duration = {}, fuel = {}, max_speed = {};
+
+        size_t n = file_.slots();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            i64x4 live;
+            u64x4 starts, ends, drivers, vehicles;
+            widen(live, live_ + i);
+            load(starts, start_time_ + i);
+            load(ends, end_time_ + i);
+            load(drivers, driver_id_ + i);
+            load(vehicles, vehicle_id_ + i);
+            i64x4 hit = (live != 0) & (ends != 0) &
+                        ((drivers == driver_id) | any_driver) &
+                        ((vehicles == vehicle_id) | any_vehicle) &
+                        (starts >= from) & (starts <= to);
+
+            trips -= hit;
+
+            f64x4 value;
+            load(value, distance_ + i);
+            keep(value, hit);
+            distance += value;
+            load(value, fuel_ + i);
+            keep(value, hit);
+            fuel += value;
+            load(value, max_speed_ + i);
+            keep(value, hit);
+            max_speed = value > max_speed ? value : max_speed;
+
+            i64x4 count;
+            widen(count, duration_ + i);
+            duration += __builtin_convertvector(count & hit, f64x4);
+            widen(count, harsh_braking_ + i);
+            braking += count & hit;
+            widen(count, rapid_acceleration_ + i);
+            acceleration += count & hit;
+            widen(count, speeding_ + i);
+            speeding += count & hit;
+            widen(count, sharp_turns_ + i);
+            turns += count & hit;
+        }
+
+        TripColumnTotals result = {};
+        result.trips = sum(trips);
+        result.distance = sum(distance);
+        result.duration = sum(duration);
+        result.fuel = sum(fuel);
+        result.max_speed = column_simd::max(max_speed);
+        result.harsh_braking = sum(braking);
+        result.rapid_acceleration = sum(acceleration);
+        result.speeding = sum(speeding);
+        result.sharp_turns = sum(turns);
+
+        for (; i < n; i++)
+        {
+            if (!live_[i] || end_time_[i] == 0 || (driver_id && driver_id_[i] != driver_id) ||
+                (vehicle_id && vehicle_id_[i] != vehicle_id) ||
+                start_time_[i] < from || start_time_[i] > to)
+                continue;
+
+            result.trips++;
+            result.distance += distance_[i];
+            result.duration += duration_[i];
+            result.fuel += fuel_[i];
+            result.max_speed = std::max(result.max_speed, max_speed_[i]);
+            result.harsh_braking += harsh_braking_[i];
+            result.rapid_acceleration += rapid_acceleration_[i];
+            result.speeding += speeding_[i];
+            result.sharp_turns += sharp_turns_[i];
+        }
+        return result;
+    }
+};
+
+struct ExpenseColumnTotals
+{
+    double amount[6]; // by ExpenseCategory
+    uint64_t count[6];
+
+    double total() const
+    {
+        double sum = 0;
+        for (double a : amount)
+            sum += a;
+        return sum;
+    }
+};
+
+class ExpenseColumns
+{
+private:
+    ColumnFile file_;
+    uint8_t *live_;
+    uint8_t *category_;
+    uint64_t *driver_id_;
+    uint64_t *vehicle_id_;
+    uint64_t *expense_date_;
+    double *amount_;
+
+public:
+    bool open(const string &path, uint64_t slots, bool &stale)
+    {
+        vector<size_t> widths = {1, 1, 8, 8, 8, 8};
+        if (!file_.open(path, slots, widths, stale))
+            return false;
+
+        live_ = file_.column<uint8_t>(0);
+        category_ = file_.column<uint8_t>(1);
+        driver_id_ = file_.column<uint64_t>(2);
+        vehicle_id_ = file_.column<uint64_t>(3);
+        expense_date_ = file_.column<uint64_t>(4);
+        amount_ = file_.column<double>(5);
+        return true;
+    }
+
+    void close() { file_.close(); }
+    bool is_open() const { return file_.is_open(); }
+
+    void put(uint64_t slot, const ExpenseRecord &expense)
+    {
+        if (slot >= file_.slots())
+            return;
+
+        bool live = expense.expense_id != 0;
+        live_[slot] = live;
+        // Unknown categories count as OTHER, as in ExpenseAggregates
+        category_[slot] = live ? (uint8_t)min<int>((int)expense.category, 5) : 0;
+        driver_id_[slot] = live ? expense.driver_id : 0;
+        vehicle_id_[slot] = live ? expense.vehicle_id : 0;
+        expense_date_[slot] = live ? expense.expense_date : 0;
+        amount_[slot] = live ? expense.amount : 0;
+    }
+
+    // Expenses with from <= expense_date <= to, per category. A driver or
+    // vehicle id of 0 matches any.
+    ExpenseColumnTotals totals(uint64_t driver_id, uint64_t vehicle_id,
+                               uint64_t from, uint64_t to) const
+    {
+        using namespace column_simd;
+
+        int64_t any_driver = driver_id == 0 ? -1 : 0;
+        int64_t any_vehicle = vehicle_id == 0 ? -1 : 0;
+
+        f64x4 amount[6] = {};
+        i64x4 count[6] = {};
+
+        size_t n = file_.slots();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            i64x4 live;
+            u64x4 dates, drivers, vehicles;
+            widen(live, live_ + i);
+            load(dates, expense_date_ + i);
+            load(drivers, driver_id_ + i);
+            load(vehicles, vehicle_id_ + i);
+            i64x4 hit = (live != 0) &
+                        ((drivers == driver_id) | any_driver) &
+                        ((vehicles == vehicle_id) | any_vehicle) &
+                        (dates >= from) & (dates <= to);
+
+            f64x4 value;
+            i64x4 category;
+            load(value, amount_ + i);
+            widen(category, category_ + i);
+            for (int c = 0; c < 6; c++)
+            {
+                i64x4 in = hit & (category == c);
+                f64x4 kept = value;
+                keep(kept, in);
+                amount[c] += kept;
+                count[c] -= in;
+            }
+        }
+
+        ExpenseColumnTotals result = {};
+        for (int c = 0; c < 6; c++)
+        {
+            result.amount[c] = sum(amount[c]);
+            result.count[c] = sum(count[c]);
+        }
+
+        for (; i < n; i++)
+        {
+            if (!live_[i] || (driver_id && driver_id_[i] != driver_id) ||
+                (vehicle_id && vehicle_id_[i] != vehicle_id) ||
+                expense_date_[i] < from || expense_date_[i] > to)
+                continue;
+
+            result.amount[category_[i]] += amount_[i];
+            result.count[category_[i]]++;
+        }
+        return result;
+    }
+};
+
+struct DriverColumnTotals
+{
+    uint64_t drivers;
+    uint64_t trips;
+    double distance;
+    double fuel;
+    uint64_t safety_score_sum;
+    uint64_t harsh_events;
+};
+
+class DriverColumns
+{
+private:
+    ColumnFile file_;
+    uint8_t *live_;
+    uint32_t *safety_score_;
+    uint32_t *harsh_events_;
+    uint64_t *total_trips_;
+    double *total_distance_;
+    double *total_fuel_;
+
+public:
+    bool open(const string &path, uint64_t slots, bool &stale)
+    {
+        vector<size_t> widths = {1, 4, 4, 8, 8, 8};
+        if (!file_.open(path, slots, widths, stale))
+            return false;
+
+        live_ = file_.column<uint8_t>(0);
+        safety_score_ = file_.column<uint32_t>(1);
+        harsh_events_ = file_.column<uint32_t>(2);
+        total_trips_ = file_.column<uint64_t>(3);
+        total_distance_ = file_.column<double>(4);
+        total_fuel_ = file_.column<double>(5);
+        return true;
+    }
+
+    void close() { file_.close(); }
+    bool is_open() const { return file_.is_open(); }
+
+    void put(uint64_t slot, const DriverProfile &driver)
+    {
+        if (slot >= file_.slots())
+            return;
+
+        bool live = driver.is_active == 1;
+        live_[slot] = live;
+        safety_score_[slot] = live ? driver.safety_score : 0;
+        harsh_events_[slot] = live ? driver.harsh_events_count : 0;
+        total_trips_[slot] = live ? driver.total_trips : 0;
+        total_distance_[slot] = live ? driver.total_distance : 0;
+        total_fuel_[slot] = live ? driver.total_fuel_consumed : 0;
+    }
+
+    // Active drivers only; unused slots hold zeroes
+    DriverColumnTotals totals() const
+    {
+        using namespace column_simd;
+
+        i64x4 drivers = {}, trips = {}, score = {}, events = {};
+        f64x4 distance = {}, fuel = {};
+
+        size_t n = file_.slots();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            i64x4 count;
+            widen(count, live_ + i);
+            drivers += count;
+            load(count, total_trips_ + i);
+            trips += count;
+            widen(count, safety_score_ + i);
+            score += count;
+            widen(count, harsh_events_ + i);
+            events += count;
+
+            f64x4 value;
+            load(value, total_distance_ + i);
+            distance += value;
+            load(value, total_fuel_ + i);
+            fuel += value;
+        }
+
+        DriverColumnTotals result = {};
+        result.drivers = sum(drivers);
+        result.trips = sum(trips);
+        result.safety_score_sum = sum(score);
+        result.harsh_events = sum(events);
+        result.distance = sum(distance);
+        result.fuel = sum(fuel);
+
+        for (; i < n; i++)
+        {
+            result.drivers += live_[i];
+            result.trips += total_trips_[i];
+            result.safety_score_sum += safety_score_[i];
+            result.harsh_events += harsh_events_[i];
+            result.distance += total_distance_[i];
+            result.fuel += total_fuel_[i];
+        }
+        return result;
+    }
+};
+
+// Hot numeric fields of the trip, expense and driver tables in column files
+// next to the database (<db>.tripcols, .expcols, .drvcols). DatabaseManager
+// updates them on every write to those tables and refills a table's columns
+// whenever its file is new or was not closed cleanly.
+class ColumnStore
+{
+private:
+    TripColumns trips_;
+    ExpenseColumns expenses_;
+    DriverColumns drivers_;
+
+public:
+    struct Staleness
+    {
+        bool trips;
+        bool expenses;
+        bool drivers;
+    };
+
+    bool open(const string &db_filename, const SDMHeader &header, Staleness &stale)
+    {
+        stale = Staleness();
+        if (!trips_.open(db_filename + ".tripcols", header.max_trips, stale.trips) ||
+            !expenses_.open(db_filename + ".expcols", 500000, stale.expenses) ||
+            !drivers_.open(db_filename + ".drvcols", header.max_drivers, stale.drivers))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        trips_.close();
+        expenses_.close();
+        drivers_.close();
+    }
+
+    bool is_open() const { return trips_.is_open(); }
+
+    TripColumns &trips() { return trips_; }
+    ExpenseColumns &expenses() { return expenses_; }
+    DriverColumns &drivers() { return drivers_; }
+};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include "../../include/sdm_types.hpp"
 #include "../../include/sdm_config.hpp"
+#include "IdAllocator.h"
+#include "TableScanner.h"
+#include "ColumnStore.h"
 #include <fstream>
 #include <string>
 #include <vector>
@@ -12,6 +15,12 @@
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -19,6 +28,8 @@ class DatabaseManager
 {
 private:
     fstream file_;
+    recursive_mutex io_mtx_; // file_ is shared by request threads and GPS ingest
+    int header_fd_; // id marks only; see persist_id_high_water
     string filename_;
     SDMHeader header_;
     bool is_open_;
@@ -31,6 +42,96 @@ private:
     uint64_t document_table_start_;
     uint64_t incident_table_start_;
 
+    IdAllocator id_allocator_;
+    TableScanner scanner_; // parallel read-only scans for analytics
+    ColumnStore columns_;  // hot trip/expense/driver fields, written through
+
+    static constexpr uint32_t SCAN_CHUNK = 256; // records per read in full-table scans
+
+    // Called by the allocator from whichever thread ran out of ids, so it
+    // uses its own descriptor and pwrite rather than file_, whose stream
+    // position the other table operations move around
+    bool persist_id_high_water(IdSpace space, uint64_t value)
+    {
+        size_t s = static_cast<size_t>(space);
+        header_.id_high_water[s] = value;
+        return write_header_field(offsetof(SDMHeader, id_high_water) + s * sizeof(uint64_t),
+                                  &header_.id_high_water[s], sizeof(uint64_t));
+    }
+
+    bool write_header_field(size_t offset, const void *value, size_t bytes)
+    {
+        return header_fd_ >= 0 &&
+               pwrite(header_fd_, value, bytes, (off_t)offset) == (ssize_t)bytes;
+    }
+
+    void close_header_fd()
+    {
+        if (header_fd_ >= 0)
+        {
+            ::close(header_fd_);
+            header_fd_ = -1;
+        }
+    }
+
+    // Largest id in any slot of a table, deleted slots included
+    template <typename Record, typename IdOf>
+    uint64_t highest_id(IdOf id_of)
+    {
+        atomic<uint64_t> highest(0);
+        scanner_.for_each_slot<Record>([&](uint64_t, const Record &record)
+                                       {
+            uint64_t id = id_of(record);
+            uint64_t seen = highest.load(memory_order_relaxed);
+            while (id > seen && !highest.compare_exchange_weak(seen, id, memory_order_relaxed))
+            {
+            } });
+        return highest.load();
+    }
+
+    // Files written before the marks were kept have zeros in them, so raise
+    // each mark to the highest id already stored before anything is leased.
+    // Done once per file; afterwards every id comes from the allocator.
+    bool seed_id_high_water()
+    {
+        if (header_.id_high_water_seeded)
+            return true;
+
+        uint64_t found[static_cast<size_t>(IdSpace::COUNT)] = {};
+        found[static_cast<size_t>(IdSpace::DRIVER)] =
+            highest_id<DriverProfile>([](const DriverProfile &r)
+                                      { return r.driver_id; });
+        found[static_cast<size_t>(IdSpace::VEHICLE)] =
+            highest_id<VehicleInfo>([](const VehicleInfo &r)
+                                    { return r.vehicle_id; });
+        found[static_cast<size_t>(IdSpace::TRIP)] =
+            highest_id<TripRecord>([](const TripRecord &r)
+                                   { return r.trip_id; });
+        found[static_cast<size_t>(IdSpace::MAINTENANCE)] =
+            highest_id<MaintenanceRecord>([](const MaintenanceRecord &r)
+                                          { return r.maintenance_id; });
+        found[static_cast<size_t>(IdSpace::EXPENSE)] =
+            highest_id<ExpenseRecord>([](const ExpenseRecord &r)
+                                      { return r.expense_id; });
+        found[static_cast<size_t>(IdSpace::DOCUMENT)] =
+            highest_id<DocumentMetadata>([](const DocumentMetadata &r)
+                                         { return r.document_id; });
+        found[static_cast<size_t>(IdSpace::INCIDENT)] =
+            highest_id<IncidentReport>([](const IncidentReport &r)
+                                       { return r.incident_id; });
+
+        for (size_t s = 0; s < static_cast<size_t>(IdSpace::COUNT); s++)
+        {
+            if (found[s] > header_.id_high_water[s] &&
+                !persist_id_high_water(static_cast<IdSpace>(s), found[s]))
+                return false;
+        }
+
+        header_.id_high_water_seeded = 1;
+        return write_header_field(offsetof(SDMHeader, id_high_water_seeded),
+                                  &header_.id_high_water_seeded, sizeof(uint32_t));
+    }
+
     void calculate_offsets()
     {
         uint64_t current_offset = sizeof(SDMHeader);
@@ -67,7 +168,7 @@ private:
     }
 
 public:
-    DatabaseManager(const string &filename) : filename_(filename), is_open_(false) {}
+    DatabaseManager(const string &filename) : header_fd_(-1), filename_(filename), is_open_(false) {}
 
     bool isOpen()
     {
@@ -81,6 +182,7 @@ public:
 
     bool create(const SDMConfig &config)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
 
         if (file_.is_open())
         {
@@ -118,6 +220,7 @@ public:
         header_.max_drivers = config.max_drivers;
         header_.max_vehicles = config.max_vehicles;
         header_.max_trips = config.max_trips;
+        header_.id_high_water_seeded = 1; // empty tables, nothing to seed from
 
         calculate_offsets();
 
@@ -191,6 +294,7 @@ public:
 
     bool open()
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         file_.open(filename_, ios::in | ios::out | ios::binary);
         if (!file_.is_open())
         {
@@ -213,12 +317,53 @@ public:
         document_table_start_ = header_.document_table_offset;
         incident_table_start_ = header_.incident_table_offset;
 
+        if (!scanner_.open(filename_, header_))
+        {
+            file_.close();
+            return false;
+        }
+
+        ColumnStore::Staleness stale;
+        if (!columns_.open(filename_, header_, stale))
+        {
+            scanner_.close();
+            file_.close();
+            return false;
+        }
+        if (stale.trips)
+            scanner_.for_each_slot<TripRecord>([this](uint64_t slot, const TripRecord &trip)
+                                               { columns_.trips().put(slot, trip); });
+        if (stale.expenses)
+            scanner_.for_each_slot<ExpenseRecord>([this](uint64_t slot, const ExpenseRecord &expense)
+                                                  { columns_.expenses().put(slot, expense); });
+        if (stale.drivers)
+            scanner_.for_each_slot<DriverProfile>([this](uint64_t slot, const DriverProfile &driver)
+                                                  { columns_.drivers().put(slot, driver); });
+
+        header_fd_ = ::open(filename_.c_str(), O_WRONLY);
+        if (header_fd_ < 0 || !seed_id_high_water())
+        {
+            close_header_fd();
+            columns_.close();
+            scanner_.close();
+            file_.close();
+            return false;
+        }
+
+        id_allocator_.load(header_.id_high_water,
+                           [this](IdSpace space, uint64_t value)
+                           { return persist_id_high_water(space, value); });
+
         is_open_ = true;
         return true;
     }
 
     void close()
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        scanner_.close();
+        columns_.close();
+        close_header_fd();
         if (is_open_ && file_.is_open())
         {
             header_.last_modified = get_current_timestamp();
@@ -232,6 +377,7 @@ public:
 
     bool create_driver(const DriverProfile &driver)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -248,6 +394,7 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&driver), sizeof(DriverProfile));
                 file_.flush();
+                columns_.drivers().put(i, driver);
                 return true;
             }
         }
@@ -257,6 +404,7 @@ public:
 
     bool read_driver(uint64_t driver_id, DriverProfile &driver)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -277,6 +425,7 @@ public:
 
     bool update_driver(const DriverProfile &driver)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -293,6 +442,7 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&driver), sizeof(DriverProfile));
                 file_.flush();
+                columns_.drivers().put(i, driver);
                 return true;
             }
         }
@@ -302,6 +452,7 @@ public:
 
     bool delete_driver(uint64_t driver_id)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -319,6 +470,7 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&driver), sizeof(DriverProfile));
                 file_.flush();
+                columns_.drivers().put(i, driver);
                 return true;
             }
         }
@@ -326,31 +478,32 @@ public:
         return false;
     }
 
-    vector<DriverProfile> get_all_drivers()
+    // Reads, changes and writes back a driver under one lock, so updates
+    // from request threads and the GPS ingest thread cannot overwrite each
+    // other's fields. driver receives the stored record.
+    template <typename Fn>
+    bool modify_driver(uint64_t driver_id, Fn fn, DriverProfile &driver)
     {
-        vector<DriverProfile> drivers;
-        if (!is_open_)
-            return drivers;
-
-        for (uint32_t i = 0; i < header_.max_drivers; i++)
-        {
-            DriverProfile driver;
-            uint64_t offset = driver_table_start_ + (i * sizeof(DriverProfile));
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!read_driver(driver_id, driver))
+            return false;
 
-            file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&driver), sizeof(DriverProfile));
+        fn(driver);
+        return update_driver(driver);
+    }
 
-            if (driver.is_active == 1)
-            {
-                drivers.push_back(driver);
-            }
-        }
+    vector<DriverProfile> get_all_drivers()
+    {
+        if (!is_open_)
+            return vector<DriverProfile>();
 
-        return drivers;
+        return scanner_.filter<DriverProfile>([](const DriverProfile &)
+                                              { return true; });
     }
 
     bool create_vehicle(const VehicleInfo &vehicle)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -376,6 +529,7 @@ public:
 
     bool read_vehicle(uint64_t vehicle_id, VehicleInfo &vehicle)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -396,6 +550,7 @@ public:
 
     bool update_vehicle(const VehicleInfo &vehicle)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -421,6 +576,7 @@ public:
 
     bool delete_vehicle(uint64_t vehicle_id)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -447,29 +603,72 @@ public:
 
     vector<VehicleInfo> get_vehicles_by_owner(uint64_t owner_id)
     {
-        vector<VehicleInfo> vehicles;
         if (!is_open_)
-            return vehicles;
+            return vector<VehicleInfo>();
 
-        for (uint32_t i = 0; i < header_.max_vehicles; i++)
-        {
-            VehicleInfo vehicle;
-            uint64_t offset = vehicle_table_start_ + (i * sizeof(VehicleInfo));
+        return scanner_.filter<VehicleInfo>([owner_id](const VehicleInfo &vehicle)
+                                            { return vehicle.owner_driver_id == owner_id; });
+    }
 
-            file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&vehicle), sizeof(VehicleInfo));
+    // Calls fn for every active vehicle, reading the table in chunks
+    template <typename Fn>
+    void for_each_vehicle(Fn fn)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return;
+
+        vector<VehicleInfo> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < header_.max_vehicles; i += SCAN_CHUNK)
+        {
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, header_.max_vehicles - i);
+            file_.seekg(vehicle_table_start_ + (uint64_t)i * sizeof(VehicleInfo), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(VehicleInfo));
+            if (!file_)
+            {
+                file_.clear();
+                return;
+            }
 
-            if (vehicle.is_active == 1 && vehicle.owner_driver_id == owner_id)
+            for (uint32_t j = 0; j < n; j++)
             {
-                vehicles.push_back(vehicle);
+                if (chunk[j].is_active == 1)
+                    fn(chunk[j]);
             }
         }
+    }
+
+    // Calls fn for every stored document's metadata
+    template <typename Fn>
+    void for_each_document(Fn fn)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return;
+
+        vector<DocumentMetadata> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < 100000; i += SCAN_CHUNK)
+        {
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, 100000 - i);
+            file_.seekg(document_table_start_ + (uint64_t)i * sizeof(DocumentMetadata), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(DocumentMetadata));
+            if (!file_)
+            {
+                file_.clear();
+                return;
+            }
 
-        return vehicles;
+            for (uint32_t j = 0; j < n; j++)
+            {
+                if (chunk[j].document_id != 0)
+                    fn(chunk[j]);
+            }
+        }
     }
 
     bool create_trip(const TripRecord &trip)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -486,6 +685,7 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&trip), sizeof(TripRecord));
                 file_.flush();
+                columns_.trips().put(i, trip);
                 return true;
             }
         }
@@ -495,6 +695,7 @@ public:
 
     bool read_trip(uint64_t trip_id, TripRecord &trip)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -515,6 +716,7 @@ public:
 
     bool update_trip(const TripRecord &trip)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -531,6 +733,7 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&trip), sizeof(TripRecord));
                 file_.flush();
+                columns_.trips().put(i, trip);
                 return true;
             }
         }
@@ -540,6 +743,7 @@ public:
 
     vector<TripRecord> get_trips_by_driver(uint64_t driver_id, int limit = 100)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         vector<TripRecord> trips;
         if (!is_open_)
             return trips;
@@ -563,8 +767,37 @@ public:
         return trips;
     }
 
+    // Calls fn for every stored trip, reading the table in chunks
+    template <typename Fn>
+    void for_each_trip(Fn fn)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return;
+
+        vector<TripRecord> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < header_.max_trips; i += SCAN_CHUNK)
+        {
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, header_.max_trips - i);
+            file_.seekg(trip_table_start_ + (uint64_t)i * sizeof(TripRecord), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(TripRecord));
+            if (!file_)
+            {
+                file_.clear();
+                return;
+            }
+
+            for (uint32_t j = 0; j < n; j++)
+            {
+                if (chunk[j].trip_id != 0)
+                    fn(chunk[j]);
+            }
+        }
+    }
+
     bool create_maintenance(const MaintenanceRecord &record)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -590,29 +823,44 @@ public:
 
     vector<MaintenanceRecord> get_maintenance_by_vehicle(uint64_t vehicle_id)
     {
-        vector<MaintenanceRecord> records;
         if (!is_open_)
-            return records;
+            return vector<MaintenanceRecord>();
 
-        for (uint32_t i = 0; i < 100000; i++)
-        {
-            MaintenanceRecord record;
-            uint64_t offset = maintenance_table_start_ + (i * sizeof(MaintenanceRecord));
+        return scanner_.filter<MaintenanceRecord>([vehicle_id](const MaintenanceRecord &record)
+                                                  { return record.vehicle_id == vehicle_id; });
+    }
 
-            file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&record), sizeof(MaintenanceRecord));
+    // Calls fn for every stored maintenance record, reading the table in chunks
+    template <typename Fn>
+    void for_each_maintenance(Fn fn)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return;
 
-            if (record.maintenance_id != 0 && record.vehicle_id == vehicle_id)
+        vector<MaintenanceRecord> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < 100000; i += SCAN_CHUNK)
+        {
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, 100000 - i);
+            file_.seekg(maintenance_table_start_ + (uint64_t)i * sizeof(MaintenanceRecord), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(MaintenanceRecord));
+            if (!file_)
             {
-                records.push_back(record);
+                file_.clear();
+                return;
             }
-        }
 
-        return records;
+            for (uint32_t j = 0; j < n; j++)
+            {
+                if (chunk[j].maintenance_id != 0)
+                    fn(chunk[j]);
+            }
+        }
     }
 
     bool create_expense(const ExpenseRecord &expense)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
             return false;
 
@@ -629,6 +877,84 @@ public:
                 file_.seekp(offset, ios::beg);
                 file_.write(reinterpret_cast<const char *>(&expense), sizeof(ExpenseRecord));
                 file_.flush();
+                columns_.expenses().put(i, expense);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool read_expense(uint64_t expense_id, ExpenseRecord &expense)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_ || expense_id == 0)
+            return false;
+
+        for (uint32_t i = 0; i < 500000; i++)
+        {
+            uint64_t offset = expense_table_start_ + (i * sizeof(ExpenseRecord));
+            file_.seekg(offset, ios::beg);
+            file_.read(reinterpret_cast<char *>(&expense), sizeof(ExpenseRecord));
+
+            if (expense.expense_id == expense_id)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool update_expense(const ExpenseRecord &expense)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_ || expense.expense_id == 0)
+            return false;
+
+        for (uint32_t i = 0; i < 500000; i++)
+        {
+            ExpenseRecord existing;
+            uint64_t offset = expense_table_start_ + (i * sizeof(ExpenseRecord));
+
+            file_.seekg(offset, ios::beg);
+            file_.read(reinterpret_cast<char *>(&existing), sizeof(ExpenseRecord));
+
+            if (existing.expense_id == expense.expense_id)
+            {
+                file_.seekp(offset, ios::beg);
+                file_.write(reinterpret_cast<const char *>(&expense), sizeof(ExpenseRecord));
+                file_.flush();
+                columns_.expenses().put(i, expense);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Frees the slot for reuse by create_expense
+    bool delete_expense(uint64_t expense_id)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_ || expense_id == 0)
+            return false;
+
+        for (uint32_t i = 0; i < 500000; i++)
+        {
+            ExpenseRecord existing;
+            uint64_t offset = expense_table_start_ + (i * sizeof(ExpenseRecord));
+
+            file_.seekg(offset, ios::beg);
+            file_.read(reinterpret_cast<char *>(&existing), sizeof(ExpenseRecord));
+
+            if (existing.expense_id == expense_id)
+            {
+                ExpenseRecord empty;
+                file_.seekp(offset, ios::beg);
+                file_.write(reinterpret_cast<const char *>(&empty), sizeof(ExpenseRecord));
+                file_.flush();
+                columns_.expenses().put(i, empty);
                 return true;
             }
         }
@@ -638,6 +964,7 @@ public:
 
     vector<ExpenseRecord> get_expenses_by_driver(uint64_t driver_id, int limit = 100)
     {
+        lock_guard<recursive_mutex> lock(io_mtx_);
         vector<ExpenseRecord> expenses;
         if (!is_open_)
             return expenses;
@@ -661,84 +988,156 @@ public:
         return expenses;
     }
 
-    vector<ExpenseRecord> get_expenses_by_category(uint64_t driver_id, ExpenseCategory category)
+    template <typename Fn>
+    void for_each_expense(Fn fn)
     {
-        vector<ExpenseRecord> expenses;
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
-            return expenses;
+            return;
 
-        for (uint32_t i = 0; i < 500000; i++)
+        vector<ExpenseRecord> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < 500000; i += SCAN_CHUNK)
         {
-            ExpenseRecord expense;
-            uint64_t offset = expense_table_start_ + (i * sizeof(ExpenseRecord));
-
-            file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&expense), sizeof(ExpenseRecord));
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, 500000 - i);
+            file_.seekg(expense_table_start_ + (uint64_t)i * sizeof(ExpenseRecord), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(ExpenseRecord));
+            if (!file_)
+            {
+                file_.clear();
+                return;
+            }
 
-            if (expense.expense_id != 0 && expense.driver_id == driver_id &&
-                expense.category == category)
+            for (uint32_t j = 0; j < n; j++)
             {
-                expenses.push_back(expense);
+                if (chunk[j].expense_id != 0)
+                    fn(chunk[j]);
             }
         }
-
-        return expenses;
     }
 
-    uint64_t get_current_timestamp() const
+    vector<ExpenseRecord> get_expenses_by_category(uint64_t driver_id, ExpenseCategory category)
     {
-        return static_cast<uint64_t>(time(nullptr));
-    }
+        if (!is_open_)
+            return vector<ExpenseRecord>();
 
-    const SDMHeader &get_header() const { return header_; }
-    bool is_database_open() const { return is_open_; }
+        return scanner_.filter<ExpenseRecord>([driver_id, category](const ExpenseRecord &expense)
+                                              { return expense.driver_id == driver_id &&
+                                                       expense.category == category; });
+    }
 
-    DatabaseStats get_stats()
+    bool create_incident(const IncidentReport &incident)
     {
-        DatabaseStats stats;
+        lock_guard<recursive_mutex> lock(io_mtx_);
         if (!is_open_)
-            return stats;
+            return false;
 
-        for (uint32_t i = 0; i < header_.max_drivers; i++)
+        for (uint32_t i = 0; i < 50000; i++)
         {
-            DriverProfile driver;
-            uint64_t offset = driver_table_start_ + (i * sizeof(DriverProfile));
+            IncidentReport existing;
+            uint64_t offset = incident_table_start_ + (i * sizeof(IncidentReport));
+
             file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&driver), sizeof(DriverProfile));
+            file_.read(reinterpret_cast<char *>(&existing), sizeof(IncidentReport));
 
-            if (driver.is_active == 1)
+            if (existing.incident_id == 0)
             {
-                stats.total_drivers++;
-                stats.active_drivers++;
-                stats.total_distance += driver.total_distance;
+                file_.seekp(offset, ios::beg);
+                file_.write(reinterpret_cast<const char *>(&incident), sizeof(IncidentReport));
+                file_.flush();
+                return true;
             }
         }
 
-        for (uint32_t i = 0; i < header_.max_vehicles; i++)
+        return false;
+    }
+
+    bool update_incident(const IncidentReport &incident)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return false;
+
+        for (uint32_t i = 0; i < 50000; i++)
         {
-            VehicleInfo vehicle;
-            uint64_t offset = vehicle_table_start_ + (i * sizeof(VehicleInfo));
+            IncidentReport existing;
+            uint64_t offset = incident_table_start_ + (i * sizeof(IncidentReport));
+
             file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&vehicle), sizeof(VehicleInfo));
+            file_.read(reinterpret_cast<char *>(&existing), sizeof(IncidentReport));
 
-            if (vehicle.is_active == 1)
+            if (existing.incident_id == incident.incident_id)
             {
-                stats.total_vehicles++;
+                file_.seekp(offset, ios::beg);
+                file_.write(reinterpret_cast<const char *>(&incident), sizeof(IncidentReport));
+                file_.flush();
+                return true;
             }
         }
 
-        for (uint32_t i = 0; i < header_.max_trips; i++)
+        return false;
+    }
+
+    // Calls fn for every stored incident, reading the table in chunks
+    template <typename Fn>
+    void for_each_incident(Fn fn)
+    {
+        lock_guard<recursive_mutex> lock(io_mtx_);
+        if (!is_open_)
+            return;
+
+        vector<IncidentReport> chunk(SCAN_CHUNK);
+        for (uint32_t i = 0; i < 50000; i += SCAN_CHUNK)
         {
-            TripRecord trip;
-            uint64_t offset = trip_table_start_ + (i * sizeof(TripRecord));
-            file_.seekg(offset, ios::beg);
-            file_.read(reinterpret_cast<char *>(&trip), sizeof(TripRecord));
+            uint32_t n = min<uint32_t>(SCAN_CHUNK, 50000 - i);
+            file_.seekg(incident_table_start_ + (uint64_t)i * sizeof(IncidentReport), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(IncidentReport));
+            if (!file_)
+            {
+                file_.clear();
+                return;
+            }
 
-            if (trip.trip_id != 0)
+            for (uint32_t j = 0; j < n; j++)
             {
-                stats.total_trips++;
+                if (chunk[j].incident_id != 0)
+                    fn(chunk[j]);
             }
         }
+    }
+
+    uint64_t get_current_timestamp() const
+    {
+        return static_cast<uint64_t>(time(nullptr));
+    }
+
+    // Unique across restarts; returns 0 if the database is not open
+    uint64_t next_id(IdSpace space)
+    {
+        if (!is_open_)
+            return 0;
+
+        return id_allocator_.next(space);
+    }
+
+    const SDMHeader &get_header() const { return header_; }
+    TableScanner &scanner() { return scanner_; }
+    ColumnStore &columns() { return columns_; }
+    const string &get_filename() const { return filename_; }
+    bool is_database_open() const { return is_open_; }
+
+    DatabaseStats get_stats()
+    {
+        DatabaseStats stats;
+        if (!is_open_)
+            return stats;
+
+        DriverColumnTotals drivers = columns_.drivers().totals();
+        stats.total_drivers = drivers.drivers;
+        stats.active_drivers = drivers.drivers;
+        stats.total_distance = (uint64_t)drivers.distance;
+        stats.total_vehicles = scanner_.count<VehicleInfo>([](const VehicleInfo &)
+                                                           { return true; });
+        stats.total_trips = columns_.trips().count();
 
         stats.database_size = header_.total_size;
         stats.used_space = stats.database_size;
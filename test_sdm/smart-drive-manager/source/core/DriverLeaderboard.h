@@ -0,0 +1,165 @@
+#ifndef DRIVERLEADERBOARD_H
+#define DRIVERLEADERBOARD_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/DatabaseManager.h"
+#include "../../source/data_structures/RankedSkipList.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+using namespace std;
+
+// Drivers ordered by (safety_score desc, total_distance desc, driver_id).
+// Loaded once from the driver table and then kept current by the managers
+// that change scores, so top-N, rank and percentile are O(log n).
+class DriverLeaderboard
+{
+public:
+    struct Entry
+    {
+        uint64_t driver_id;
+        string driver_name;
+        uint32_t safety_score;
+        double total_distance;
+        uint32_t rank; // 1-based
+        double percentile;
+    };
+
+private:
+    struct Key
+    {
+        uint32_t safety_score;
+        double total_distance;
+        uint64_t driver_id;
+    };
+
+    struct KeyOrder
+    {
+        bool operator()(const Key &a, const Key &b) const
+        {
+            if (a.safety_score != b.safety_score)
+                return a.safety_score > b.safety_score;
+            if (a.total_distance != b.total_distance)
+                return a.total_distance > b.total_distance;
+            return a.driver_id < b.driver_id;
+        }
+    };
+
+    struct Driver
+    {
+        Key key;
+        string name;
+    };
+
+    RankedSkipList<Key, KeyOrder> ranking_;
+    unordered_map<uint64_t, Driver> drivers_;
+    mutex mtx_;
+
+    Entry make_entry(const Key &key, size_t position)
+    {
+        Entry entry;
+        entry.driver_id = key.driver_id;
+        entry.driver_name = drivers_[key.driver_id].name;
+        entry.safety_score = key.safety_score;
+        entry.total_distance = key.total_distance;
+        entry.rank = (uint32_t)(position + 1);
+        entry.percentile = ((double)(ranking_.size() - position) / ranking_.size()) * 100.0;
+        return entry;
+    }
+
+public:
+    void rebuild(DatabaseManager &db)
+    {
+        auto all_drivers = db.get_all_drivers();
+
+        lock_guard<mutex> lock(mtx_);
+        ranking_.clear();
+        drivers_.clear();
+        for (const auto &driver : all_drivers)
+        {
+            Driver &d = drivers_[driver.driver_id];
+            d.key = {driver.safety_score, driver.total_distance, driver.driver_id};
+            d.name = driver.full_name;
+            ranking_.insert(d.key);
+        }
+    }
+
+    // Inserts or repositions a driver after its profile was written
+    void update(const DriverProfile &driver)
+    {
+        Key key = {driver.safety_score, driver.total_distance, driver.driver_id};
+
+        lock_guard<mutex> lock(mtx_);
+        auto it = drivers_.find(driver.driver_id);
+        if (it == drivers_.end())
+        {
+            drivers_[driver.driver_id] = {key, driver.full_name};
+            ranking_.insert(key);
+            return;
+        }
+
+        it->second.name = driver.full_name;
+        if (it->second.key.safety_score == key.safety_score &&
+            it->second.key.total_distance == key.total_distance)
+            return;
+
+        ranking_.erase(it->second.key);
+        it->second.key = key;
+        ranking_.insert(key);
+    }
+
+    void remove(uint64_t driver_id)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = drivers_.find(driver_id);
+        if (it == drivers_.end())
+            return;
+        ranking_.erase(it->second.key);
+        drivers_.erase(it);
+    }
+
+    vector<Entry> top(size_t limit)
+    {
+        vector<Entry> entries;
+
+        lock_guard<mutex> lock(mtx_);
+        size_t position = 0;
+        ranking_.for_range(0, limit, [&](const Key &key)
+                           { entries.push_back(make_entry(key, position++)); });
+        return entries;
+    }
+
+    bool rank_of(uint64_t driver_id, Entry &entry)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = drivers_.find(driver_id);
+        if (it == drivers_.end())
+            return false;
+
+        long long position = ranking_.rank(it->second.key);
+        if (position < 0)
+            return false;
+        entry = make_entry(it->second.key, (size_t)position);
+        return true;
+    }
+
+    // Driver at a 1-based rank, e.g. the cut-off for the top 10%
+    bool at_rank(uint32_t rank, Entry &entry)
+    {
+        lock_guard<mutex> lock(mtx_);
+        Key key;
+        if (rank == 0 || !ranking_.at(rank - 1, key))
+            return false;
+        entry = make_entry(key, rank - 1);
+        return true;
+    }
+
+    size_t size()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return ranking_.size();
+    }
+};
+
+#endif
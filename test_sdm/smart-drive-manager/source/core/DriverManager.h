@@ -8,6 +8,8 @@
 #include "DatabaseManager.h"
 #include "CacheManager.h"
 #include "IndexManager.h"
+#include "DriverLeaderboard.h"
+#include "ExpiryIndex.h"
 #include <vector>
 #include <algorithm>
 
@@ -17,10 +19,28 @@ private:
     DatabaseManager &db_;
     CacheManager &cache_;
     IndexManager &index_;
+    DriverLeaderboard leaderboard_;
+    ExpiryIndex *expiry_;
 
 public:
     DriverManager(DatabaseManager &db, CacheManager &cache, IndexManager &index)
-        : db_(db), cache_(cache), index_(index) {}
+        : db_(db), cache_(cache), index_(index), expiry_(nullptr)
+    {
+        leaderboard_.rebuild(db_);
+    }
+
+    // License changes are written through to the index, and expiry alerts
+    // become range scans over it
+    void set_expiry_index(ExpiryIndex *expiry)
+    {
+        expiry_ = expiry;
+    }
+
+    // Managers that change safety scores or distances report them here
+    DriverLeaderboard &leaderboard()
+    {
+        return leaderboard_;
+    }
 
     // ========================================================================
     // DRIVER PROFILE OPERATIONS
@@ -32,18 +52,20 @@ public:
                                const std::string &phone)
     {
         DriverProfile driver;
-        if (!db_.read_driver(driver_id, driver))
-        {
-            return false;
-        }
+        bool updated = db_.modify_driver(driver_id, [&](DriverProfile &d)
+                                         {
+            strncpy(d.full_name, full_name.c_str(), sizeof(d.full_name) - 1);
+            strncpy(d.email, email.c_str(), sizeof(d.email) - 1);
+            strncpy(d.phone, phone.c_str(), sizeof(d.phone) - 1); }, driver);
 
-        strncpy(driver.full_name, full_name.c_str(), sizeof(driver.full_name) - 1);
-        strncpy(driver.email, email.c_str(), sizeof(driver.email) - 1);
-        strncpy(driver.phone, phone.c_str(), sizeof(driver.phone) - 1);
-
-        if (db_.update_driver(driver))
+        if (updated)
         {
             cache_.invalidate_driver(driver_id);
+            leaderboard_.update(driver);
+            if (expiry_)
+            {
+                expiry_->set_driver(driver);
+            }
             return true;
         }
 
@@ -55,17 +77,18 @@ public:
                              uint64_t expiry_date)
     {
         DriverProfile driver;
-        if (!db_.read_driver(driver_id, driver))
-        {
-            return false;
-        }
+        bool updated = db_.modify_driver(driver_id, [&](DriverProfile &d)
+                                         {
+            strncpy(d.license_number, license_number.c_str(), sizeof(d.license_number) - 1);
+            d.license_expiry = expiry_date; }, driver);
 
-        strncpy(driver.license_number, license_number.c_str(), sizeof(driver.license_number) - 1);
-        driver.license_expiry = expiry_date;
-
-        if (db_.update_driver(driver))
+        if (updated)
         {
             cache_.invalidate_driver(driver_id);
+            if (expiry_)
+            {
+                expiry_->set_driver(driver);
+            }
             return true;
         }
 
@@ -201,47 +224,47 @@ public:
         double percentile;
     };
 
+    // Safety score descending, then distance descending
     std::vector<DriverRanking> get_driver_leaderboard(int limit = 100)
     {
         std::vector<DriverRanking> rankings;
 
-        auto all_drivers = db_.get_all_drivers();
-
-        for (const auto &driver : all_drivers)
+        for (const auto &entry : leaderboard_.top(limit > 0 ? limit : 0))
         {
-            DriverRanking rank;
-            rank.driver_id = driver.driver_id;
-            rank.driver_name = driver.full_name;
-            rank.safety_score = driver.safety_score;
-            rank.total_distance = driver.total_distance;
-            rankings.push_back(rank);
+            rankings.push_back(to_ranking(entry));
         }
 
-        // Sort by safety score descending
-        std::sort(rankings.begin(), rankings.end(),
-                  [](const DriverRanking &a, const DriverRanking &b)
-                  {
-                      if (a.safety_score == b.safety_score)
-                      {
-                          return a.total_distance > b.total_distance;
-                      }
-                      return a.safety_score > b.safety_score;
-                  });
-
-        // Assign ranks and percentiles
-        for (size_t i = 0; i < rankings.size(); i++)
+        return rankings;
+    }
+
+    bool get_driver_rank(uint64_t driver_id, DriverRanking &ranking)
+    {
+        DriverLeaderboard::Entry entry;
+        if (!leaderboard_.rank_of(driver_id, entry))
         {
-            rankings[i].rank = i + 1;
-            rankings[i].percentile = ((double)(rankings.size() - i) / rankings.size()) * 100.0;
+            return false;
         }
+        ranking = to_ranking(entry);
+        return true;
+    }
 
-        // Return top N
-        if (rankings.size() > limit)
+    // Lowest-ranked driver still inside the top `percent` of the fleet
+    bool get_percentile_cutoff(double percent, DriverRanking &ranking)
+    {
+        size_t drivers = leaderboard_.size();
+        if (drivers == 0 || percent <= 0)
         {
-            rankings.resize(limit);
+            return false;
         }
 
-        return rankings;
+        uint32_t rank = (uint32_t)(drivers * std::min(percent, 100.0) / 100.0);
+        DriverLeaderboard::Entry entry;
+        if (!leaderboard_.at_rank(rank > 0 ? rank : 1, entry))
+        {
+            return false;
+        }
+        ranking = to_ranking(entry);
+        return true;
     }
 
     struct DriverComparison
@@ -311,43 +334,33 @@ public:
     std::vector<DocumentAlert> get_license_expiry_alerts(int days_threshold = 30)
     {
         std::vector<DocumentAlert> alerts;
+        uint64_t current_time = get_current_timestamp();
+
+        if (expiry_)
+        {
+            uint64_t horizon = current_time + (uint64_t)std::max(days_threshold, 0) * 86400ULL * 1000000000ULL;
+            for (const auto &entry : expiry_->expiring(ExpiryKind::DRIVER_LICENSE, 1, horizon))
+            {
+                alerts.push_back(make_document_alert(entry.owner_id, entry.label, ExpiryKind::DRIVER_LICENSE,
+                                                     entry.expiry_date, current_time));
+            }
+            return alerts;
+        }
 
         auto all_drivers = db_.get_all_drivers();
-        uint64_t current_time = get_current_timestamp();
 
         for (const auto &driver : all_drivers)
         {
             if (driver.license_expiry > 0)
             {
-                int64_t days_until = (driver.license_expiry - current_time) / (86400ULL * 1000000000ULL);
+                int64_t days_until = ((int64_t)driver.license_expiry - (int64_t)current_time) /
+                                     (int64_t)(86400ULL * 1000000000ULL);
 
                 if (days_until <= days_threshold)
                 {
-                    DocumentAlert alert;
-                    alert.driver_id = driver.driver_id;
-                    alert.driver_name = driver.full_name;
-                    alert.alert_type = "License Expiry";
-                    alert.expiry_date = driver.license_expiry;
-                    alert.days_until_expiry = days_until;
-
-                    if (days_until <= 0)
-                    {
-                        alert.severity = 3; // Critical - expired
-                    }
-                    else if (days_until <= 7)
-                    {
-                        alert.severity = 3; // Critical - < 1 week
-                    }
-                    else if (days_until <= 14)
-                    {
-                        alert.severity = 2; // Warning - < 2 weeks
-                    }
-                    else
-                    {
-                        alert.severity = 1; // Info
-                    }
-
-                    alerts.push_back(alert);
+                    alerts.push_back(make_document_alert(driver.driver_id, driver.full_name,
+                                                         ExpiryKind::DRIVER_LICENSE,
+                                                         driver.license_expiry, current_time));
                 }
             }
         }
@@ -355,6 +368,28 @@ public:
         return alerts;
     }
 
+    // Licenses, vehicle insurance/registration and documents expiring within
+    // the threshold (or already expired), soonest first per kind. Needs the
+    // expiry index.
+    std::vector<DocumentAlert> get_expiry_alerts(int days_threshold = 30)
+    {
+        std::vector<DocumentAlert> alerts;
+        if (!expiry_)
+        {
+            return alerts;
+        }
+
+        uint64_t current_time = get_current_timestamp();
+        uint64_t horizon = current_time + (uint64_t)std::max(days_threshold, 0) * 86400ULL * 1000000000ULL;
+        for (const auto &entry : expiry_->expiring_before(horizon))
+        {
+            alerts.push_back(make_document_alert(entry.owner_id, entry.label, entry.kind,
+                                                 entry.expiry_date, current_time));
+        }
+
+        return alerts;
+    }
+
     // ========================================================================
     // DRIVER RECOMMENDATIONS
     // ========================================================================
@@ -434,17 +469,41 @@ private:
     }
     void calculate_driver_ranking(uint64_t driver_id, DriverBehaviorMetrics &metrics)
     {
-        auto leaderboard = get_driver_leaderboard(10000);
-
-        for (const auto &rank : leaderboard)
+        DriverLeaderboard::Entry entry;
+        if (leaderboard_.rank_of(driver_id, entry))
         {
-            if (rank.driver_id == driver_id)
-            {
-                metrics.rank_in_fleet = rank.rank;
-                metrics.percentile = rank.percentile;
-                break;
-            }
+            metrics.rank_in_fleet = entry.rank;
+            metrics.percentile = entry.percentile;
         }
     }
+
+    static DocumentAlert make_document_alert(uint64_t driver_id, const std::string &name,
+                                             ExpiryKind kind, uint64_t expiry_date,
+                                             uint64_t current_time)
+    {
+        DocumentAlert alert;
+        alert.driver_id = driver_id;
+        alert.driver_name = name;
+        alert.alert_type = expiry_kind_name(kind);
+        alert.expiry_date = expiry_date;
+
+        int64_t days_until = ((int64_t)expiry_date - (int64_t)current_time) / (int64_t)(86400ULL * 1000000000ULL);
+        alert.days_until_expiry = days_until;
+        alert.severity = ExpiryScheduler::severity_for(days_until);
+
+        return alert;
+    }
+
+    static DriverRanking to_ranking(const DriverLeaderboard::Entry &entry)
+    {
+        DriverRanking ranking;
+        ranking.driver_id = entry.driver_id;
+        ranking.driver_name = entry.driver_name;
+        ranking.safety_score = entry.safety_score;
+        ranking.total_distance = entry.total_distance;
+        ranking.rank = entry.rank;
+        ranking.percentile = entry.percentile;
+        return ranking;
+    }
 };
 #endif // DRIVERMANAGER_H
\ No newline at end of file
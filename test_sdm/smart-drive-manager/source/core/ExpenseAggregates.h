@@ -0,0 +1,292 @@
+#ifndef EXPENSEAGGREGATES_H
+#define EXPENSEAGGREGATES_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/DatabaseManager.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+static const int EXPENSE_CATEGORIES = 6; // ExpenseCategory::FUEL .. OTHER
+
+#pragma pack(push, 1)
+
+// One logged change to a (driver, month, category) bucket
+struct ExpenseAggregateDelta
+{
+    uint64_t driver_id;
+    int32_t month; // year * 12 + (month - 1), local time
+    uint8_t category;
+    uint8_t reserved[3];
+    double amount;
+    int32_t count;
+    int32_t reserved2;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(ExpenseAggregateDelta) == 32, "ExpenseAggregateDelta must be 32 bytes");
+
+struct MonthlyExpenseTotals
+{
+    double amount[EXPENSE_CATEGORIES];
+    int32_t count[EXPENSE_CATEGORIES];
+
+    MonthlyExpenseTotals()
+    {
+        memset(amount, 0, sizeof(amount));
+        memset(count, 0, sizeof(count));
+    }
+
+    double total() const
+    {
+        double sum = 0;
+        for (int c = 0; c < EXPENSE_CATEGORIES; c++)
+            sum += amount[c];
+        return sum;
+    }
+};
+
+// Expense totals per (driver, calendar month, category), kept in step with
+// the expense table so reports and budgets never rescan it. Changes are
+// appended to <db>.expagg and replayed on open; the log is rewritten as one
+// record per bucket when it grows too long.
+class ExpenseAggregates
+{
+private:
+    string filename_;
+    ofstream log_;
+    unordered_map<uint64_t, map<int32_t, MonthlyExpenseTotals>> drivers_;
+    uint64_t log_records_;
+    uint64_t buckets_;
+    mutex mtx_;
+
+    static constexpr uint64_t COMPACT_MIN_RECORDS = 100000;
+
+    // Caller holds mtx_
+    void apply_locked(const ExpenseAggregateDelta &delta)
+    {
+        MonthlyExpenseTotals &totals = drivers_[delta.driver_id][delta.month];
+        int slot = category_slot((ExpenseCategory)delta.category);
+        bool was_empty = totals.count[slot] == 0;
+        totals.amount[slot] += delta.amount;
+        totals.count[slot] += delta.count;
+        if (totals.count[slot] == 0)
+            totals.amount[slot] = 0; // drop rounding residue
+        if (was_empty != (totals.count[slot] == 0))
+            was_empty ? buckets_++ : buckets_--;
+    }
+
+    // Caller holds mtx_
+    bool log_locked(const ExpenseAggregateDelta &delta)
+    {
+        if (!log_.is_open())
+            return false;
+
+        log_.write(reinterpret_cast<const char *>(&delta), sizeof(delta));
+        log_.flush();
+        log_records_++;
+
+        if (log_records_ > COMPACT_MIN_RECORDS && log_records_ > 4 * buckets_)
+            compact_locked();
+
+        return log_.good();
+    }
+
+    // Caller holds mtx_
+    bool compact_locked()
+    {
+        string tmp = filename_ + ".tmp";
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        uint64_t records = 0;
+        buckets_ = 0;
+        for (const auto &driver : drivers_)
+        {
+            for (const auto &month : driver.second)
+            {
+                for (int c = 0; c < EXPENSE_CATEGORIES; c++)
+                {
+                    if (month.second.count[c] == 0)
+                        continue;
+                    ExpenseAggregateDelta d = make_delta(driver.first, month.first, c,
+                                                         month.second.amount[c], month.second.count[c]);
+                    out.write(reinterpret_cast<const char *>(&d), sizeof(d));
+                    records++;
+                    buckets_++;
+                }
+            }
+        }
+        out.close();
+        if (!out.good())
+            return false;
+
+        log_.close();
+        if (rename(tmp.c_str(), filename_.c_str()) != 0)
+        {
+            log_.open(filename_, ios::binary | ios::app);
+            return false;
+        }
+
+        log_.open(filename_, ios::binary | ios::app);
+        log_records_ = records;
+        return log_.is_open();
+    }
+
+    static ExpenseAggregateDelta make_delta(uint64_t driver_id, int32_t month, int category,
+                                            double amount, int32_t count)
+    {
+        ExpenseAggregateDelta d;
+        memset(&d, 0, sizeof(d));
+        d.driver_id = driver_id;
+        d.month = month;
+        d.category = (uint8_t)category;
+        d.amount = amount;
+        d.count = count;
+        return d;
+    }
+
+public:
+    ExpenseAggregates(const string &filename)
+        : filename_(filename), log_records_(0), buckets_(0) {}
+
+    ~ExpenseAggregates()
+    {
+        close();
+    }
+
+    // Replays the log. existed is false when there was none, in which case
+    // the caller should backfill with rebuild().
+    bool open(bool &existed)
+    {
+        lock_guard<mutex> lock(mtx_);
+        drivers_.clear();
+        log_records_ = 0;
+        buckets_ = 0;
+
+        ifstream in(filename_, ios::binary);
+        existed = in.is_open();
+        if (existed)
+        {
+            ExpenseAggregateDelta delta;
+            while (in.read(reinterpret_cast<char *>(&delta), sizeof(delta)))
+            {
+                apply_locked(delta);
+                log_records_++;
+            }
+        }
+        in.close();
+
+        log_.open(filename_, ios::binary | ios::app);
+        return log_.is_open();
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (log_.is_open())
+            log_.close();
+    }
+
+    // Recomputes every bucket from the expense table
+    bool rebuild(DatabaseManager &db)
+    {
+        vector<ExpenseAggregateDelta> deltas = db.scanner().select<ExpenseRecord>(
+            [](const ExpenseRecord &)
+            { return true; },
+            [](const ExpenseRecord &expense)
+            { return make_delta(expense.driver_id, month_of(expense.expense_date),
+                                category_slot(expense.category), expense.amount, 1); });
+
+        lock_guard<mutex> lock(mtx_);
+        drivers_.clear();
+        buckets_ = 0;
+        for (const auto &delta : deltas)
+            apply_locked(delta);
+        return compact_locked();
+    }
+
+    // sign = -1 backs an expense out (deletes, or the old side of an edit)
+    bool record(const ExpenseRecord &expense, int sign = 1)
+    {
+        ExpenseAggregateDelta delta = make_delta(expense.driver_id, month_of(expense.expense_date),
+                                                 category_slot(expense.category),
+                                                 sign * expense.amount, sign);
+
+        lock_guard<mutex> lock(mtx_);
+        apply_locked(delta);
+        return log_locked(delta);
+    }
+
+    MonthlyExpenseTotals month_totals(uint64_t driver_id, int32_t month)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto driver = drivers_.find(driver_id);
+        if (driver == drivers_.end())
+            return MonthlyExpenseTotals();
+
+        auto it = driver->second.find(month);
+        return it == driver->second.end() ? MonthlyExpenseTotals() : it->second;
+    }
+
+    // Inclusive month range
+    MonthlyExpenseTotals range_totals(uint64_t driver_id, int32_t first_month, int32_t last_month)
+    {
+        MonthlyExpenseTotals sum;
+
+        lock_guard<mutex> lock(mtx_);
+        auto driver = drivers_.find(driver_id);
+        if (driver == drivers_.end())
+            return sum;
+
+        auto end = driver->second.upper_bound(last_month);
+        for (auto it = driver->second.lower_bound(first_month); it != end; ++it)
+        {
+            for (int c = 0; c < EXPENSE_CATEGORIES; c++)
+            {
+                sum.amount[c] += it->second.amount[c];
+                sum.count[c] += it->second.count[c];
+            }
+        }
+        return sum;
+    }
+
+    double spent(uint64_t driver_id, int32_t month, ExpenseCategory category)
+    {
+        return month_totals(driver_id, month).amount[category_slot(category)];
+    }
+
+    // Unknown categories count as OTHER
+    static int category_slot(ExpenseCategory category)
+    {
+        int slot = (int)category;
+        return slot < EXPENSE_CATEGORIES ? slot : (int)ExpenseCategory::OTHER;
+    }
+
+    // Nanosecond timestamp to year * 12 + (month - 1), in local time like
+    // the budget periods
+    static int32_t month_of(uint64_t timestamp_ns)
+    {
+        time_t seconds = (time_t)(timestamp_ns / 1000000000ULL);
+        struct tm parts;
+        localtime_r(&seconds, &parts);
+        return (parts.tm_year + 1900) * 12 + parts.tm_mon;
+    }
+
+    size_t driver_count()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return drivers_.size();
+    }
+};
+
+#endif
@@ -8,11 +8,16 @@
 #include "../../source/core/DatabaseManager.h"
 #include "../../source/core/CacheManager.h"
 #include "../../source/core/IndexManager.h"
+#include "../../source/core/RollupManager.h"
+#include "../../source/core/ExpenseAggregates.h"
+#include "../../source/core/BudgetTable.h"
 #include <vector>
 #include <map>
 #include <string>
 #include <algorithm>
 #include <iostream>
+#include <iomanip>
+#include <mutex>
 using namespace std;
 
 
@@ -23,20 +28,32 @@ private:
     CacheManager &cache_;
     IndexManager &index_;
 
-    struct BudgetLimit
-    {
-        uint64_t driver_id;
-        ExpenseCategory category;
-        double monthly_limit;
-        double current_month_spent;
-        uint64_t alert_threshold_percentage; 
-    };
+    RollupManager *rollups_;
+    ExpenseAggregates aggregates_;
+    BudgetTable budgets_;
 
-    vector<BudgetLimit> budget_limits_;
+    // Serializes a record write with its index, budget and aggregate updates
+    mutex write_mtx_;
 
 public:
     ExpenseManager(DatabaseManager &db, CacheManager &cache, IndexManager &index)
-        : db_(db), cache_(cache), index_(index) {}
+        : db_(db), cache_(cache), index_(index), rollups_(nullptr),
+          aggregates_(db.get_filename() + ".expagg"),
+          budgets_(db.get_filename() + ".budgets", aggregates_)
+    {
+        // First start against this database: backfill from the expense table
+        bool existed = false;
+        if (aggregates_.open(existed) && !existed)
+        {
+            aggregates_.rebuild(db_);
+        }
+        budgets_.open(current_month());
+    }
+
+    void set_rollups(RollupManager *rollups)
+    {
+        rollups_ = rollups;
+    }
 
 
     uint64_t add_expense(uint64_t driver_id,
@@ -46,7 +63,12 @@ public:
                          const string &description,
                          uint64_t trip_id = 0)
     {
+        lock_guard<mutex> lock(write_mtx_);
         uint64_t expense_id = generate_expense_id();
+        if (expense_id == 0)
+        {
+            return 0;
+        }
 
         ExpenseRecord expense;
         expense.expense_id = expense_id;
@@ -65,8 +87,12 @@ public:
         }
 
         index_.insert_primary(4, expense_id, expense.expense_date, 0); 
-
-        check_budget_alert(driver_id, category, amount);
+        check_budget_alert(expense);
+        aggregates_.record(expense);
+        if (rollups_)
+        {
+            rollups_->record_expense(expense);
+        }
 
         cache_.clear_query_cache();
 
@@ -80,7 +106,12 @@ public:
                               double price_per_unit,
                               const string &station)
     {
+        lock_guard<mutex> lock(write_mtx_);
         uint64_t expense_id = generate_expense_id();
+        if (expense_id == 0)
+        {
+            return 0;
+        }
 
         ExpenseRecord expense;
         expense.expense_id = expense_id;
@@ -104,12 +135,73 @@ public:
         }
 
         index_.insert_primary(4, expense_id, expense.expense_date, 0);
-        check_budget_alert(driver_id, ExpenseCategory::FUEL, expense.amount);
+        check_budget_alert(expense);
+        aggregates_.record(expense);
+        if (rollups_)
+        {
+            rollups_->record_expense(expense);
+        }
         cache_.clear_query_cache();
 
         return expense_id;
     }
 
+    // Replaces the stored record with the same expense_id
+    bool update_expense(const ExpenseRecord &expense)
+    {
+        lock_guard<mutex> lock(write_mtx_);
+        ExpenseRecord old;
+        if (!db_.read_expense(expense.expense_id, old) || !db_.update_expense(expense))
+        {
+            return false;
+        }
+
+        if (old.expense_date != expense.expense_date)
+        {
+            index_.remove_primary(4, old.expense_id, old.expense_date);
+            index_.insert_primary(4, expense.expense_id, expense.expense_date, 0);
+        }
+
+        BudgetState budget;
+        budgets_.record(old, -1, current_month(), budget);
+        check_budget_alert(expense);
+
+        aggregates_.record(old, -1);
+        aggregates_.record(expense);
+        if (rollups_)
+        {
+            rollups_->record_expense(old, -1);
+            rollups_->record_expense(expense);
+        }
+
+        cache_.clear_query_cache();
+        return true;
+    }
+
+    bool delete_expense(uint64_t expense_id)
+    {
+        lock_guard<mutex> lock(write_mtx_);
+        ExpenseRecord old;
+        if (!db_.read_expense(expense_id, old) || !db_.delete_expense(expense_id))
+        {
+            return false;
+        }
+
+        index_.remove_primary(4, expense_id, old.expense_date);
+
+        BudgetState budget;
+        budgets_.record(old, -1, current_month(), budget);
+
+        aggregates_.record(old, -1);
+        if (rollups_)
+        {
+            rollups_->record_expense(old, -1);
+        }
+
+        cache_.clear_query_cache();
+        return true;
+    }
+
     vector<ExpenseRecord> get_driver_expenses(uint64_t driver_id, int limit = 100)
     {
         return db_.get_expenses_by_driver(driver_id, limit);
@@ -139,67 +231,29 @@ public:
         return filtered;
     }
 
+    // Persists in <db>.budgets; spend earlier this month counts towards it
     bool set_budget_limit(uint64_t driver_id,
                           ExpenseCategory category,
                           double monthly_limit,
                           uint64_t alert_percentage = 80)
     {
-        // Find existing budget or create new
-        auto it = find_if(budget_limits_.begin(), budget_limits_.end(),
-                               [driver_id, category](const BudgetLimit &b)
-                               {
-                                   return b.driver_id == driver_id && b.category == category;
-                               });
-
-        if (it != budget_limits_.end())
-        {
-            it->monthly_limit = monthly_limit;
-            it->alert_threshold_percentage = alert_percentage;
-        }
-        else
-        {
-            BudgetLimit budget;
-            budget.driver_id = driver_id;
-            budget.category = category;
-            budget.monthly_limit = monthly_limit;
-            budget.current_month_spent = 0;
-            budget.alert_threshold_percentage = alert_percentage;
-            budget_limits_.push_back(budget);
-        }
-
-        return true;
+        // Seeded from the aggregates, so no write may land in between
+        lock_guard<mutex> lock(write_mtx_);
+        return budgets_.set(driver_id, category, monthly_limit, (uint32_t)alert_percentage,
+                            current_month());
     }
 
     bool get_budget_status(uint64_t driver_id, ExpenseCategory category,
                            double &limit, double &spent, double &remaining)
     {
-        auto it = find_if(budget_limits_.begin(), budget_limits_.end(),
-                               [driver_id, category](const BudgetLimit &b)
-                               {
-                                   return b.driver_id == driver_id && b.category == category;
-                               });
-
-        if (it == budget_limits_.end())
+        BudgetState budget;
+        if (!budgets_.find(driver_id, category, current_month(), budget))
         {
             return false;
         }
 
-        uint64_t month_start = get_month_start_timestamp();
-        uint64_t month_end = get_current_timestamp();
-
-        auto expenses = get_expenses_by_date_range(driver_id, month_start, month_end);
-
-        double total_spent = 0;
-        for (const auto &expense : expenses)
-        {
-            if (expense.category == category)
-            {
-                total_spent += expense.amount;
-            }
-        }
-
-        limit = it->monthly_limit;
-        spent = total_spent;
+        limit = budget.monthly_limit;
+        spent = budget.spent;
         remaining = limit - spent;
 
         return true;
@@ -219,27 +273,11 @@ public:
     {
         vector<BudgetAlert> alerts;
 
-        for (const auto &budget : budget_limits_)
+        for (const auto &budget : budgets_.driver_budgets(driver_id, current_month()))
         {
-            if (budget.driver_id != driver_id)
-                continue;
-
-            double limit, spent, remaining;
-            if (get_budget_status(driver_id, budget.category, limit, spent, remaining))
+            if (budget.alerting())
             {
-                double percentage = (spent / limit) * 100.0;
-
-                if (percentage >= budget.alert_threshold_percentage || spent > limit)
-                {
-                    BudgetAlert alert;
-                    alert.driver_id = driver_id;
-                    alert.category = budget.category;
-                    alert.limit = limit;
-                    alert.spent = spent;
-                    alert.percentage_used = percentage;
-                    alert.over_budget = (spent > limit);
-                    alerts.push_back(alert);
-                }
+                alerts.push_back(to_budget_alert(budget));
             }
         }
 
@@ -323,38 +361,59 @@ public:
         map<ExpenseCategory, double> by_category;
     };
 
+    // Calendar months, oldest first, ending with the current one
     vector<MonthlyExpenseReport> get_monthly_reports(uint64_t driver_id,
                                                           int num_months = 12)
     {
         vector<MonthlyExpenseReport> reports;
 
-        // Get current date components
-        auto current = get_current_timestamp();
-
-        for (int i = 0; i < num_months; i++)
+        int32_t last = current_month();
+        for (int32_t month = last - num_months + 1; month <= last; month++)
         {
             MonthlyExpenseReport report;
+            report.year = month / 12;
+            report.month = month % 12 + 1;
 
-            // Calculate month start/end (simplified)
-            uint64_t month_start = current - (i * 30ULL * 86400ULL * 1000000000ULL);
-            uint64_t month_end = month_start + (30ULL * 86400ULL * 1000000000ULL);
-
-            auto expenses = get_expenses_by_date_range(driver_id, month_start, month_end);
-
-            report.total = 0;
-            for (const auto &expense : expenses)
-            {
-                report.total += expense.amount;
-                report.by_category[expense.category] += expense.amount;
-            }
+            MonthlyExpenseTotals totals = aggregates_.month_totals(driver_id, month);
+            report.total = totals.total();
+            add_categories(report.by_category, totals);
 
             reports.push_back(report);
         }
 
-        reverse(reports.begin(), reports.end());
         return reports;
     }
 
+    // Spending per category over the last num_months calendar months,
+    // including the current one
+    map<ExpenseCategory, double> get_category_breakdown(uint64_t driver_id, int num_months = 1)
+    {
+        map<ExpenseCategory, double> breakdown;
+
+        int32_t last = current_month();
+        add_categories(breakdown, aggregates_.range_totals(driver_id, last - num_months + 1, last));
+
+        return breakdown;
+    }
+
+    // Fleet-wide spending per category between the two dates (ns), or for
+    // one vehicle; scans the expense columns
+    map<ExpenseCategory, double> get_fleet_category_totals(uint64_t start_date, uint64_t end_date,
+                                                           uint64_t vehicle_id = 0)
+    {
+        ExpenseColumnTotals totals = db_.columns().expenses().totals(0, vehicle_id, start_date, end_date);
+
+        map<ExpenseCategory, double> breakdown;
+        for (int c = 0; c < EXPENSE_CATEGORIES; c++)
+        {
+            if (totals.count[c] != 0)
+            {
+                breakdown[(ExpenseCategory)c] = totals.amount[c];
+            }
+        }
+        return breakdown;
+    }
+
     
 
     struct TaxReport
@@ -455,8 +514,7 @@ public:
 private:
     uint64_t generate_expense_id()
     {
-        static uint64_t counter = 1;
-        return counter++;
+        return db_.next_id(IdSpace::EXPENSE);
     }
 
     uint64_t get_current_timestamp()
@@ -464,50 +522,56 @@ private:
         return chrono::system_clock::now().time_since_epoch().count();
     }
 
-    uint64_t get_month_start_timestamp()
+    int32_t current_month()
     {
-        auto now = chrono::system_clock::now();
-        auto time_t = chrono::system_clock::to_time_t(now);
-        auto tm = *localtime(&time_t);
-        tm.tm_mday = 1;
-        tm.tm_hour = 0;
-        tm.tm_min = 0;
-        tm.tm_sec = 0;
-
-        auto month_start = chrono::system_clock::from_time_t(mktime(&tm));
-        return month_start.time_since_epoch().count();
+        return ExpenseAggregates::month_of(get_current_timestamp());
     }
 
-    void check_budget_alert(uint64_t driver_id, ExpenseCategory category, double amount)
+    static void add_categories(map<ExpenseCategory, double> &out, const MonthlyExpenseTotals &totals)
     {
-        auto it = find_if(budget_limits_.begin(), budget_limits_.end(),
-                               [driver_id, category](const BudgetLimit &b)
-                               {
-                                   return b.driver_id == driver_id && b.category == category;
-                               });
-
-        if (it != budget_limits_.end())
+        for (int c = 0; c < EXPENSE_CATEGORIES; c++)
         {
-            it->current_month_spent += amount;
-            
-            double percentage = (it->current_month_spent / it->monthly_limit) * 100.0;
-
-            if (percentage >= it->alert_threshold_percentage || it->current_month_spent > it->monthly_limit)
+            if (totals.count[c] != 0)
             {
-                cout << "\n💰 BUDGET ALERT!" << endl;
-                cout << "Category: " << get_category_name(category) << endl;
-                cout << "Spent: $" << fixed << setprecision(2) 
-                         << it->current_month_spent << " / $" << it->monthly_limit << endl;
-                cout << "Usage: " << percentage << "%" << endl;
-                
-                if (it->current_month_spent > it->monthly_limit) {
-                    cout << "⚠️  OVER BUDGET!" << endl;
-                }
-                cout << endl;
+                out[(ExpenseCategory)c] += totals.amount[c];
             }
         }
     }
 
+    static BudgetAlert to_budget_alert(const BudgetState &budget)
+    {
+        BudgetAlert alert;
+        alert.driver_id = budget.driver_id;
+        alert.category = budget.category;
+        alert.limit = budget.monthly_limit;
+        alert.spent = budget.spent;
+        alert.percentage_used = (budget.spent / budget.monthly_limit) * 100.0;
+        alert.over_budget = (budget.spent > budget.monthly_limit);
+        return alert;
+    }
+
+    // Call before the expense is in the aggregates
+    void check_budget_alert(const ExpenseRecord &expense)
+    {
+        BudgetState budget;
+        if (!budgets_.record(expense, 1, current_month(), budget) || !budget.alerting())
+        {
+            return;
+        }
+
+        BudgetAlert alert = to_budget_alert(budget);
+        cout << "\n💰 BUDGET ALERT!" << endl;
+        cout << "Category: " << get_category_name(alert.category) << endl;
+        cout << "Spent: $" << fixed << setprecision(2)
+             << alert.spent << " / $" << alert.limit << endl;
+        cout << "Usage: " << alert.percentage_used << "%" << endl;
+
+        if (alert.over_budget) {
+            cout << "⚠️  OVER BUDGET!" << endl;
+        }
+        cout << endl;
+    }
+
     string get_category_name(ExpenseCategory category)
     {
         switch (category)
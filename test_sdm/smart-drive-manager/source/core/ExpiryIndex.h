@@ -0,0 +1,315 @@
+#ifndef EXPIRYINDEX_H
+#define EXPIRYINDEX_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/DatabaseManager.h"
+#include <set>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+using namespace std;
+
+enum class ExpiryKind : uint8_t
+{
+    DRIVER_LICENSE = 0,
+    VEHICLE_INSURANCE = 1,
+    VEHICLE_REGISTRATION = 2,
+    DOCUMENT = 3
+};
+
+static const int EXPIRY_KINDS = 4;
+
+inline const char *expiry_kind_name(ExpiryKind kind)
+{
+    switch (kind)
+    {
+    case ExpiryKind::DRIVER_LICENSE:
+        return "License Expiry";
+    case ExpiryKind::VEHICLE_INSURANCE:
+        return "Insurance Expiry";
+    case ExpiryKind::VEHICLE_REGISTRATION:
+        return "Registration Expiry";
+    case ExpiryKind::DOCUMENT:
+        return "Document Expiry";
+    }
+    return "Expiry";
+}
+
+struct ExpiryEntry
+{
+    ExpiryKind kind;
+    uint64_t entity_id; // driver, vehicle or document id
+    uint64_t owner_id;  // driver responsible for renewing it
+    uint64_t expiry_date;
+    string label;
+};
+
+// Every expiring thing in the database, ordered by (kind, expiry date), so
+// "expiring before T" is a range scan costing O(log n + results). Filled
+// once from the tables; the managers that change expiry dates keep it
+// current through update().
+class ExpiryIndex
+{
+private:
+    typedef tuple<uint8_t, uint64_t, uint64_t> Key; // kind, expiry, entity
+
+    set<Key> order_;
+    unordered_map<uint64_t, ExpiryEntry> entries_; // slot() -> entry
+    mutex mtx_;
+
+    static uint64_t slot(ExpiryKind kind, uint64_t entity_id)
+    {
+        return (entity_id << 2) | (uint64_t)kind;
+    }
+
+    // Caller holds mtx_
+    void erase_locked(ExpiryKind kind, uint64_t entity_id)
+    {
+        auto it = entries_.find(slot(kind, entity_id));
+        if (it == entries_.end())
+            return;
+        order_.erase(Key((uint8_t)kind, it->second.expiry_date, entity_id));
+        entries_.erase(it);
+    }
+
+    // Caller holds mtx_
+    void set_locked(const ExpiryEntry &entry)
+    {
+        erase_locked(entry.kind, entry.entity_id);
+        if (entry.expiry_date == 0)
+            return;
+        entries_[slot(entry.kind, entry.entity_id)] = entry;
+        order_.insert(Key((uint8_t)entry.kind, entry.expiry_date, entry.entity_id));
+    }
+
+public:
+    void rebuild(DatabaseManager &db)
+    {
+        vector<ExpiryEntry> found;
+
+        for (const auto &driver : db.get_all_drivers())
+        {
+            found.push_back({ExpiryKind::DRIVER_LICENSE, driver.driver_id, driver.driver_id,
+                             driver.license_expiry, driver.full_name});
+        }
+        db.for_each_vehicle([&](const VehicleInfo &vehicle)
+                            {
+            found.push_back({ExpiryKind::VEHICLE_INSURANCE, vehicle.vehicle_id, vehicle.owner_driver_id,
+                             vehicle.insurance_expiry, vehicle.license_plate});
+            found.push_back({ExpiryKind::VEHICLE_REGISTRATION, vehicle.vehicle_id, vehicle.owner_driver_id,
+                             vehicle.registration_expiry, vehicle.license_plate}); });
+        db.for_each_document([&](const DocumentMetadata &doc)
+                             { found.push_back({ExpiryKind::DOCUMENT, doc.document_id, doc.owner_id,
+                                                doc.expiry_date, doc.filename}); });
+
+        lock_guard<mutex> lock(mtx_);
+        order_.clear();
+        entries_.clear();
+        for (const auto &entry : found)
+            set_locked(entry);
+    }
+
+    // An expiry_date of 0 removes the entry
+    void update(ExpiryKind kind, uint64_t entity_id, uint64_t owner_id,
+                uint64_t expiry_date, const string &label)
+    {
+        lock_guard<mutex> lock(mtx_);
+        set_locked({kind, entity_id, owner_id, expiry_date, label});
+    }
+
+    void remove(ExpiryKind kind, uint64_t entity_id)
+    {
+        lock_guard<mutex> lock(mtx_);
+        erase_locked(kind, entity_id);
+    }
+
+    void set_driver(const DriverProfile &driver)
+    {
+        update(ExpiryKind::DRIVER_LICENSE, driver.driver_id, driver.driver_id,
+               driver.license_expiry, driver.full_name);
+    }
+
+    void set_vehicle(const VehicleInfo &vehicle)
+    {
+        lock_guard<mutex> lock(mtx_);
+        set_locked({ExpiryKind::VEHICLE_INSURANCE, vehicle.vehicle_id, vehicle.owner_driver_id,
+                    vehicle.insurance_expiry, vehicle.license_plate});
+        set_locked({ExpiryKind::VEHICLE_REGISTRATION, vehicle.vehicle_id, vehicle.owner_driver_id,
+                    vehicle.registration_expiry, vehicle.license_plate});
+    }
+
+    void remove_vehicle(uint64_t vehicle_id)
+    {
+        lock_guard<mutex> lock(mtx_);
+        erase_locked(ExpiryKind::VEHICLE_INSURANCE, vehicle_id);
+        erase_locked(ExpiryKind::VEHICLE_REGISTRATION, vehicle_id);
+    }
+
+    // Entries of one kind with from <= expiry_date <= to, soonest first
+    vector<ExpiryEntry> expiring(ExpiryKind kind, uint64_t from, uint64_t to)
+    {
+        vector<ExpiryEntry> result;
+
+        lock_guard<mutex> lock(mtx_);
+        auto end = order_.upper_bound(Key((uint8_t)kind, to, UINT64_MAX));
+        for (auto it = order_.lower_bound(Key((uint8_t)kind, from, 0)); it != end; ++it)
+        {
+            result.push_back(entries_[slot(kind, get<2>(*it))]);
+        }
+        return result;
+    }
+
+    // All kinds; expired entries are included
+    vector<ExpiryEntry> expiring_before(uint64_t to)
+    {
+        vector<ExpiryEntry> result;
+        for (int k = 0; k < EXPIRY_KINDS; k++)
+        {
+            auto part = expiring((ExpiryKind)k, 1, to);
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
+    }
+
+    size_t size()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return order_.size();
+    }
+};
+
+// Periodically pushes alerts for entries expiring within the horizon. Each
+// entry is announced again only when it crosses into a more severe band
+// (30 / 14 / 7 days, expired) or its expiry date changes. Entries that drop
+// out of the window (renewed past the horizon, or deleted) are forgotten.
+class ExpiryScheduler
+{
+public:
+    struct Alert
+    {
+        ExpiryEntry entry;
+        int64_t days_until_expiry; // negative once expired
+        uint8_t severity;          // 1=Info, 2=Warning, 3=Critical
+    };
+
+    typedef function<void(const Alert &)> AlertCallback;
+
+    static uint8_t severity_for(int64_t days_until)
+    {
+        if (days_until <= 7)
+            return 3;
+        if (days_until <= 14)
+            return 2;
+        return 1;
+    }
+
+private:
+    ExpiryIndex &index_;
+    AlertCallback callback_;
+    uint32_t horizon_days_;
+    uint32_t interval_ms_;
+
+    // slot -> (expiry date, severity) last announced
+    unordered_map<uint64_t, pair<uint64_t, uint8_t>> announced_;
+
+    thread worker_;
+    mutex mtx_;
+    condition_variable cv_;
+    bool running_;
+
+    static constexpr uint64_t NANOS_PER_DAY = 86400ULL * 1000000000ULL;
+
+    void run()
+    {
+        unique_lock<mutex> lock(mtx_);
+        while (running_)
+        {
+            lock.unlock();
+            poll(chrono::system_clock::now().time_since_epoch().count());
+            lock.lock();
+            cv_.wait_for(lock, chrono::milliseconds(interval_ms_), [this]
+                         { return !running_; });
+        }
+    }
+
+public:
+    ExpiryScheduler(ExpiryIndex &index, uint32_t horizon_days = 30,
+                    uint32_t interval_ms = 3600 * 1000)
+        : index_(index), horizon_days_(horizon_days), interval_ms_(interval_ms), running_(false) {}
+
+    ~ExpiryScheduler()
+    {
+        stop();
+    }
+
+    void set_callback(AlertCallback callback)
+    {
+        callback_ = callback;
+    }
+
+    bool start()
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (running_)
+            return false;
+        running_ = true;
+        worker_ = thread(&ExpiryScheduler::run, this);
+        return true;
+    }
+
+    void stop()
+    {
+        {
+            lock_guard<mutex> lock(mtx_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+    // One scheduling pass at time now (ns); returns the alerts pushed.
+    // Called by the worker; call directly only while it is stopped.
+    size_t poll(uint64_t now)
+    {
+        size_t pushed = 0;
+        unordered_set<uint64_t> in_window;
+        for (const auto &entry : index_.expiring_before(now + horizon_days_ * NANOS_PER_DAY))
+        {
+            int64_t days_until = ((int64_t)entry.expiry_date - (int64_t)now) / (int64_t)NANOS_PER_DAY;
+            uint8_t severity = severity_for(days_until);
+            if (entry.expiry_date <= now)
+                severity = 4; // expired: announce once more
+
+            uint64_t key = (entry.entity_id << 2) | (uint64_t)entry.kind;
+            in_window.insert(key);
+            auto it = announced_.find(key);
+            if (it != announced_.end() && it->second.first == entry.expiry_date &&
+                it->second.second >= severity)
+                continue;
+
+            announced_[key] = make_pair(entry.expiry_date, severity);
+            if (callback_)
+                callback_({entry, days_until, (uint8_t)(severity > 3 ? 3 : severity)});
+            pushed++;
+        }
+
+        for (auto it = announced_.begin(); it != announced_.end();)
+        {
+            if (in_window.count(it->first))
+                ++it;
+            else
+                it = announced_.erase(it);
+        }
+        return pushed;
+    }
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef GPSLOG_H
+#define GPSLOG_H
+
+#include "../../include/sdm_types.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+using namespace std;
+
+// Append-only file of GPSLogEntry records. Points of many trips are
+// interleaved; TripRecord::gps_data_offset and gps_data_end_offset bound a
+// trip's entries, so reading a track only scans the span it was recorded in.
+class GPSLog
+{
+private:
+    fstream file_;
+    string filename_;
+    uint64_t entry_count_;
+    bool is_open_;
+    mutex mtx_;
+
+    static constexpr size_t READ_CHUNK = 1024;
+
+    bool open_locked()
+    {
+        if (is_open_)
+            return true;
+
+        // Create the file on first use
+        {
+            ofstream create(filename_, ios::out | ios::binary | ios::app);
+            if (!create.is_open())
+            {
+                return false;
+            }
+        }
+
+        file_.open(filename_, ios::in | ios::out | ios::binary);
+        if (!file_.is_open())
+        {
+            return false;
+        }
+
+        // A torn entry at the end is ignored and overwritten by the next append
+        file_.seekg(0, ios::end);
+        entry_count_ = static_cast<uint64_t>(file_.tellg()) / sizeof(GPSLogEntry);
+
+        is_open_ = true;
+        return true;
+    }
+
+public:
+    GPSLog(const string &filename)
+        : filename_(filename), entry_count_(0), is_open_(false) {}
+
+    ~GPSLog()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return open_locked();
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (is_open_)
+        {
+            file_.flush();
+            file_.close();
+            is_open_ = false;
+        }
+    }
+
+    // Writes the whole batch with a single write; first_offset receives the
+    // byte offset of entries[0]
+    bool append(const vector<GPSLogEntry> &entries, uint64_t &first_offset)
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (!open_locked())
+            return false;
+
+        first_offset = entry_count_ * sizeof(GPSLogEntry);
+        if (entries.empty())
+            return true;
+
+        file_.clear();
+        file_.seekp(first_offset, ios::beg);
+        file_.write(reinterpret_cast<const char *>(entries.data()),
+                    entries.size() * sizeof(GPSLogEntry));
+        file_.flush();
+
+        if (!file_.good())
+        {
+            file_.clear();
+            return false;
+        }
+
+        entry_count_ += entries.size();
+        return true;
+    }
+
+    // Collects up to count points of trip_id in [first_offset, end_offset).
+    // end_offset 0 means unknown and scans to the end of the log.
+    vector<GPSWaypoint> read_trip(uint64_t trip_id, uint64_t first_offset, uint64_t end_offset,
+                                  uint32_t count)
+    {
+        vector<GPSWaypoint> waypoints;
+
+        lock_guard<mutex> lock(mtx_);
+        if (count == 0 || !open_locked())
+            return waypoints;
+
+        waypoints.reserve(count);
+        vector<GPSLogEntry> chunk(READ_CHUNK);
+        uint64_t index = first_offset / sizeof(GPSLogEntry);
+        uint64_t end = entry_count_;
+        if (end_offset != 0 && end_offset / sizeof(GPSLogEntry) < end)
+            end = end_offset / sizeof(GPSLogEntry);
+
+        while (index < end && waypoints.size() < count)
+        {
+            size_t n = end - index < READ_CHUNK ? end - index : READ_CHUNK;
+
+            file_.clear();
+            file_.seekg(index * sizeof(GPSLogEntry), ios::beg);
+            file_.read(reinterpret_cast<char *>(chunk.data()), n * sizeof(GPSLogEntry));
+            if (!file_.good())
+            {
+                file_.clear();
+                break;
+            }
+
+            for (size_t i = 0; i < n && waypoints.size() < count; i++)
+            {
+                if (chunk[i].trip_id == trip_id)
+                {
+                    waypoints.push_back(chunk[i].waypoint);
+                }
+            }
+
+            index += n;
+        }
+
+        return waypoints;
+    }
+
+    uint64_t size()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return entry_count_;
+    }
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef GEOMATH_H
+#define GEOMATH_H
+
+#include "../../include/sdm_types.hpp"
+#include <vector>
+#include <cmath>
+#include <cstddef>
+using namespace std;
+
+// Structure-of-arrays copy of a GPS track for the batch kernels below
+struct GeoTrack
+{
+    vector<double> latitude;
+    vector<double> longitude;
+
+    GeoTrack() {}
+
+    explicit GeoTrack(const vector<GPSWaypoint> &waypoints)
+    {
+        latitude.reserve(waypoints.size());
+        longitude.reserve(waypoints.size());
+        for (const auto &wp : waypoints)
+        {
+            latitude.push_back(wp.latitude);
+            longitude.push_back(wp.longitude);
+        }
+    }
+
+    size_t size() const { return latitude.size(); }
+};
+
+// Great-circle distance and bearing.
+//
+// The scalar functions use libm and are exact to double precision. The batch
+// functions work on whole tracks with polynomial sin/atan approximations,
+// written with plain selects so the loops vectorize when built with
+// -O3 -fno-math-errno -fno-trapping-math (-march=native picks AVX2/AVX-512/NEON).
+//
+// Batch error bound against libm, for segments up to 15,000 km: central angle
+// within 5e-9 rad (about 3 cm on the Earth's surface) and bearing within 1e-5
+// degrees. Near-antipodal pairs are ill-conditioned for haversine and lose
+// accuracy in both versions.
+class GeoMath
+{
+public:
+    static constexpr double EARTH_RADIUS_KM = 6371.0;
+    static constexpr double EARTH_RADIUS_M = 6371000.0;
+    static constexpr double DEG_TO_RAD = M_PI / 180.0;
+    static constexpr double RAD_TO_DEG = 180.0 / M_PI;
+
+    // Segments per chunk when a kernel needs scratch space
+    static constexpr size_t BATCH_CHUNK = 256;
+
+    static double haversine_km(double lat1, double lon1, double lat2, double lon2)
+    {
+        double dLat = (lat2 - lat1) * DEG_TO_RAD;
+        double dLon = (lon2 - lon1) * DEG_TO_RAD;
+
+        lat1 = lat1 * DEG_TO_RAD;
+        lat2 = lat2 * DEG_TO_RAD;
+
+        double a = sin(dLat / 2) * sin(dLat / 2) +
+                   sin(dLon / 2) * sin(dLon / 2) * cos(lat1) * cos(lat2);
+        double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+
+        return EARTH_RADIUS_KM * c;
+    }
+
+    static double haversine_m(double lat1, double lon1, double lat2, double lon2)
+    {
+        return haversine_km(lat1, lon1, lat2, lon2) * 1000.0;
+    }
+
+    // Initial bearing from point 1 to point 2, in degrees (-180, 180]
+    static double bearing_deg(double lat1, double lon1, double lat2, double lon2)
+    {
+        double dLon = (lon2 - lon1) * DEG_TO_RAD;
+        lat1 = lat1 * DEG_TO_RAD;
+        lat2 = lat2 * DEG_TO_RAD;
+
+        double y = sin(dLon) * cos(lat2);
+        double x = cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(dLon);
+
+        return atan2(y, x) * RAD_TO_DEG;
+    }
+
+    // ========================================================================
+    // BATCH KERNELS
+    // ========================================================================
+
+    // out[i] = distance (km) from point i to point i + 1; writes n - 1 values
+    static void segment_distances_km(const double *__restrict lat,
+                                     const double *__restrict lon,
+                                     size_t n, double *__restrict out)
+    {
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            double phi1 = lat[i] * DEG_TO_RAD;
+            double phi2 = lat[i + 1] * DEG_TO_RAD;
+            double half_dphi = (phi2 - phi1) * 0.5;
+            double half_dlambda = wrap_pi((lon[i + 1] - lon[i]) * DEG_TO_RAD) * 0.5;
+
+            double s_phi = fast_sin(half_dphi);
+            double s_lambda = fast_sin(half_dlambda);
+            double a = s_phi * s_phi + fast_cos(phi1) * fast_cos(phi2) * s_lambda * s_lambda;
+            a = a < 0.0 ? 0.0 : (a > 1.0 ? 1.0 : a);
+
+            out[i] = EARTH_RADIUS_KM * 2.0 * fast_atan2(sqrt(a), sqrt(1.0 - a));
+        }
+    }
+
+    // out[i] = bearing (degrees) from point i to point i + 1; writes n - 1 values
+    static void segment_bearings_deg(const double *__restrict lat,
+                                     const double *__restrict lon,
+                                     size_t n, double *__restrict out)
+    {
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+            double phi1 = lat[i] * DEG_TO_RAD;
+            double phi2 = lat[i + 1] * DEG_TO_RAD;
+            double dlambda = wrap_pi((lon[i + 1] - lon[i]) * DEG_TO_RAD);
+
+            // cos(p1)sin(p2) - sin(p1)cos(p2)cos(dl) rewritten without the
+            // cancellation that ruins short segments
+            double c_phi2 = fast_cos(phi2);
+            double s_half = fast_sin(dlambda * 0.5);
+            double y = fast_sin(dlambda) * c_phi2;
+            double x = fast_sin(phi2 - phi1) +
+                       2.0 * fast_sin(phi1) * c_phi2 * s_half * s_half;
+
+            out[i] = fast_atan2(y, x) * RAD_TO_DEG;
+        }
+    }
+
+    // Total length of the polyline in km
+    static double path_length_km(const double *lat, const double *lon, size_t n)
+    {
+        double chunk[BATCH_CHUNK];
+        double total = 0;
+
+        for (size_t start = 0; start + 1 < n; start += BATCH_CHUNK)
+        {
+            size_t points = min(BATCH_CHUNK + 1, n - start);
+            segment_distances_km(lat + start, lon + start, points, chunk);
+            for (size_t i = 0; i + 1 < points; i++)
+            {
+                total += chunk[i];
+            }
+        }
+
+        return total;
+    }
+
+    static double path_length_km(const GeoTrack &track)
+    {
+        return path_length_km(track.latitude.data(), track.longitude.data(), track.size());
+    }
+
+    static vector<double> segment_distances_km(const GeoTrack &track)
+    {
+        vector<double> out(track.size() > 1 ? track.size() - 1 : 0);
+        segment_distances_km(track.latitude.data(), track.longitude.data(),
+                             track.size(), out.data());
+        return out;
+    }
+
+    static vector<double> segment_bearings_deg(const GeoTrack &track)
+    {
+        vector<double> out(track.size() > 1 ? track.size() - 1 : 0);
+        segment_bearings_deg(track.latitude.data(), track.longitude.data(),
+                             track.size(), out.data());
+        return out;
+    }
+
+    // ========================================================================
+    // POLYNOMIAL APPROXIMATIONS (branch-free, vectorizable)
+    // ========================================================================
+
+    // x in [-pi, pi]; absolute error < 7e-10
+    static inline double fast_sin(double x)
+    {
+        // Reflect into [-pi/2, pi/2]
+        x = x > M_PI_2 ? M_PI - x : x;
+        x = x < -M_PI_2 ? -M_PI - x : x;
+
+        double x2 = x * x;
+        double p = 1.0 / 6227020800.0;
+        p = p * x2 - 1.0 / 39916800.0;
+        p = p * x2 + 1.0 / 362880.0;
+        p = p * x2 - 1.0 / 5040.0;
+        p = p * x2 + 1.0 / 120.0;
+        p = p * x2 - 1.0 / 6.0;
+        p = p * x2 + 1.0;
+        return x * p;
+    }
+
+    // x in [-pi/2, pi/2]
+    static inline double fast_cos(double x)
+    {
+        return fast_sin(M_PI_2 - (x < 0 ? -x : x));
+    }
+
+    // Full-quadrant atan2; absolute error < 5e-10 rad
+    static inline double fast_atan2(double y, double x)
+    {
+        double ax = x < 0 ? -x : x;
+        double ay = y < 0 ? -y : y;
+        double hi = ax > ay ? ax : ay;
+        double lo = ax > ay ? ay : ax;
+        double z = lo / (hi > 0 ? hi : 1.0); // z in [0, 1]
+
+        // atan(z) = pi/4 + atan((z - 1) / (z + 1)) keeps the series argument
+        // small. Both sides are computed so the select stays branch-free.
+        const double TAN_PI_8 = 0.41421356237309503;
+        double t_shifted = (z - 1.0) / (z + 1.0);
+        double t = z > TAN_PI_8 ? t_shifted : z;
+        double offset = z > TAN_PI_8 ? M_PI_4 : 0.0;
+
+        double t2 = t * t;
+        double p = 1.0 / 19.0;
+        p = p * -t2 + 1.0 / 17.0;
+        p = p * -t2 + 1.0 / 15.0;
+        p = p * -t2 + 1.0 / 13.0;
+        p = p * -t2 + 1.0 / 11.0;
+        p = p * -t2 + 1.0 / 9.0;
+        p = p * -t2 + 1.0 / 7.0;
+        p = p * -t2 + 1.0 / 5.0;
+        p = p * -t2 + 1.0 / 3.0;
+        p = p * -t2 + 1.0;
+        double r = t * p + offset;
+
+        r = ay > ax ? M_PI_2 - r : r;
+        r = x < 0 ? M_PI - r : r;
+        return y < 0 ? -r : r;
+    }
+
+    // Wrap an angle difference into [-pi, pi]
+    static inline double wrap_pi(double x)
+    {
+        double over = x > M_PI ? 2.0 * M_PI : 0.0;
+        double under = x < -M_PI ? 2.0 * M_PI : 0.0;
+        return x - over + under;
+    }
+};
+
+#endif
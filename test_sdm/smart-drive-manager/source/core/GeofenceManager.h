@@ -0,0 +1,417 @@
+#ifndef GEOFENCEMANAGER_H
+#define GEOFENCEMANAGER_H
+
+#include "../../include/sdm_types.hpp"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+using namespace std;
+
+enum class GeofenceType : uint8_t
+{
+    DEPOT = 0,
+    RESTRICTED = 1,
+    CUSTOMER_SITE = 2,
+    OTHER = 3
+};
+
+struct GeofenceEvent
+{
+    uint64_t vehicle_id;
+    uint64_t fence_id;
+    GeofenceType type;
+    bool entered; // false = exited
+    double latitude;
+    double longitude;
+    uint64_t timestamp;
+};
+
+// Polygon geofences indexed by a uniform lat/lon grid. A position is tested
+// only against the fences registered in its cell (bounding box first, then
+// point-in-polygon), and each vehicle's inside set is kept to report
+// enter/exit transitions.
+class GeofenceManager
+{
+public:
+    using EventCallback = function<void(const GeofenceEvent &)>;
+
+private:
+    struct Fence
+    {
+        uint64_t fence_id;
+        GeofenceType type;
+        string name;
+        vector<double> lat;
+        vector<double> lon;
+        double min_lat, max_lat, min_lon, max_lon;
+        bool large; // kept out of the grid, see MAX_CELLS_PER_FENCE
+        bool active;
+    };
+
+    // Fences spanning more cells than this are bbox-checked for every point
+    // instead of being copied into thousands of cells
+    static constexpr uint64_t MAX_CELLS_PER_FENCE = 4096;
+
+    double cell_deg_;
+    vector<Fence> fences_;
+    unordered_map<uint64_t, uint32_t> fence_slot_;
+    unordered_map<uint64_t, vector<uint32_t>> grid_;
+    vector<uint32_t> large_fences_;
+    size_t active_count_;
+
+    // vehicle_id -> sorted ids of the fences it is inside
+    unordered_map<uint64_t, vector<uint64_t>> inside_;
+
+    EventCallback callback_;
+    mutex mtx_;
+
+    int32_t cell_row(double lat) const { return (int32_t)floor(lat / cell_deg_); }
+    int32_t cell_col(double lon) const { return (int32_t)floor(lon / cell_deg_); }
+
+    static uint64_t cell_key(int32_t row, int32_t col)
+    {
+        return ((uint64_t)(uint32_t)row << 32) | (uint32_t)col;
+    }
+
+    static bool contains(const Fence &f, double lat, double lon)
+    {
+        if (lat < f.min_lat || lat > f.max_lat || lon < f.min_lon || lon > f.max_lon)
+            return false;
+
+        // Ray casting with longitude as x
+        bool inside = false;
+        size_t n = f.lat.size();
+        for (size_t i = 0, j = n - 1; i < n; j = i++)
+        {
+            if ((f.lat[i] > lat) != (f.lat[j] > lat) &&
+                lon < (f.lon[j] - f.lon[i]) * (lat - f.lat[i]) / (f.lat[j] - f.lat[i]) + f.lon[i])
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    template <typename Fn>
+    void for_each_cell(const Fence &f, Fn fn) const
+    {
+        for (int32_t r = cell_row(f.min_lat); r <= cell_row(f.max_lat); r++)
+        {
+            for (int32_t c = cell_col(f.min_lon); c <= cell_col(f.max_lon); c++)
+            {
+                fn(cell_key(r, c));
+            }
+        }
+    }
+
+    // Caller holds mtx_; out is sorted
+    void collect_containing(double lat, double lon, vector<uint64_t> &out) const
+    {
+        out.clear();
+
+        auto it = grid_.find(cell_key(cell_row(lat), cell_col(lon)));
+        if (it != grid_.end())
+        {
+            for (uint32_t slot : it->second)
+            {
+                if (contains(fences_[slot], lat, lon))
+                    out.push_back(fences_[slot].fence_id);
+            }
+        }
+
+        for (uint32_t slot : large_fences_)
+        {
+            if (contains(fences_[slot], lat, lon))
+                out.push_back(fences_[slot].fence_id);
+        }
+
+        sort(out.begin(), out.end());
+    }
+
+    GeofenceType type_of(uint64_t fence_id) const
+    {
+        auto it = fence_slot_.find(fence_id);
+        return it != fence_slot_.end() ? fences_[it->second].type : GeofenceType::OTHER;
+    }
+
+public:
+    // cell_deg: grid resolution; 0.01 degrees is roughly 1 km
+    GeofenceManager(double cell_deg = 0.01)
+        : cell_deg_(cell_deg > 0 ? cell_deg : 0.01), active_count_(0) {}
+
+    // vertices are (latitude, longitude); at least three
+    bool add_fence(uint64_t fence_id, GeofenceType type, const string &name,
+                   const vector<pair<double, double>> &vertices)
+    {
+        if (vertices.size() < 3)
+            return false;
+
+        lock_guard<mutex> lock(mtx_);
+        if (fence_slot_.count(fence_id))
+            return false;
+
+        Fence f;
+        f.fence_id = fence_id;
+        f.type = type;
+        f.name = name;
+        f.min_lat = f.max_lat = vertices[0].first;
+        f.min_lon = f.max_lon = vertices[0].second;
+        for (const auto &v : vertices)
+        {
+            f.lat.push_back(v.first);
+            f.lon.push_back(v.second);
+            f.min_lat = min(f.min_lat, v.first);
+            f.max_lat = max(f.max_lat, v.first);
+            f.min_lon = min(f.min_lon, v.second);
+            f.max_lon = max(f.max_lon, v.second);
+        }
+        f.active = true;
+
+        uint64_t rows = (uint64_t)(cell_row(f.max_lat) - cell_row(f.min_lat) + 1);
+        uint64_t cols = (uint64_t)(cell_col(f.max_lon) - cell_col(f.min_lon) + 1);
+        f.large = rows * cols > MAX_CELLS_PER_FENCE;
+
+        uint32_t slot = (uint32_t)fences_.size();
+        fences_.push_back(f);
+        fence_slot_[fence_id] = slot;
+        active_count_++;
+
+        if (f.large)
+        {
+            large_fences_.push_back(slot);
+        }
+        else
+        {
+            for_each_cell(fences_[slot], [&](uint64_t key)
+                          { grid_[key].push_back(slot); });
+        }
+
+        return true;
+    }
+
+    // Vehicles inside the fence just stop reporting it; no exit event is sent
+    bool remove_fence(uint64_t fence_id)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = fence_slot_.find(fence_id);
+        if (it == fence_slot_.end())
+            return false;
+
+        uint32_t slot = it->second;
+        Fence &f = fences_[slot];
+
+        if (f.large)
+        {
+            large_fences_.erase(remove(large_fences_.begin(), large_fences_.end(), slot),
+                                large_fences_.end());
+        }
+        else
+        {
+            for_each_cell(f, [&](uint64_t key)
+                          {
+                auto cell = grid_.find(key);
+                if (cell == grid_.end())
+                    return;
+                cell->second.erase(remove(cell->second.begin(), cell->second.end(), slot),
+                                   cell->second.end());
+                if (cell->second.empty())
+                    grid_.erase(cell); });
+        }
+
+        for (auto &entry : inside_)
+        {
+            auto &ids = entry.second;
+            ids.erase(remove(ids.begin(), ids.end(), fence_id), ids.end());
+        }
+
+        f.active = false;
+        f.lat.clear();
+        f.lon.clear();
+        fence_slot_.erase(it);
+        active_count_--;
+        return true;
+    }
+
+    void set_event_callback(EventCallback callback)
+    {
+        lock_guard<mutex> lock(mtx_);
+        callback_ = callback;
+    }
+
+    // Evaluates one position; emits enter/exit events through the callback
+    // (outside the lock) and returns how many there were
+    size_t update_position(uint64_t vehicle_id, double latitude, double longitude,
+                           uint64_t timestamp)
+    {
+        static thread_local vector<uint64_t> current;
+        static thread_local vector<GeofenceEvent> events;
+        events.clear();
+
+        EventCallback callback;
+        {
+            lock_guard<mutex> lock(mtx_);
+            collect_containing(latitude, longitude, current);
+
+            vector<uint64_t> &previous = inside_[vehicle_id];
+            if (current == previous)
+                return 0;
+
+            // Both lists are sorted: walk them together
+            size_t i = 0, j = 0;
+            while (i < previous.size() || j < current.size())
+            {
+                GeofenceEvent ev;
+                ev.vehicle_id = vehicle_id;
+                ev.latitude = latitude;
+                ev.longitude = longitude;
+                ev.timestamp = timestamp;
+
+                if (j == current.size() || (i < previous.size() && previous[i] < current[j]))
+                {
+                    ev.fence_id = previous[i++];
+                    ev.entered = false;
+                }
+                else if (i == previous.size() || current[j] < previous[i])
+                {
+                    ev.fence_id = current[j++];
+                    ev.entered = true;
+                }
+                else
+                {
+                    i++;
+                    j++;
+                    continue;
+                }
+
+                ev.type = type_of(ev.fence_id);
+                events.push_back(ev);
+            }
+
+            previous = current;
+            callback = callback_;
+        }
+
+        if (callback)
+        {
+            for (const auto &ev : events)
+                callback(ev);
+        }
+
+        return events.size();
+    }
+
+    vector<uint64_t> fences_containing(double latitude, double longitude)
+    {
+        vector<uint64_t> out;
+        lock_guard<mutex> lock(mtx_);
+        collect_containing(latitude, longitude, out);
+        return out;
+    }
+
+    void forget_vehicle(uint64_t vehicle_id)
+    {
+        lock_guard<mutex> lock(mtx_);
+        inside_.erase(vehicle_id);
+    }
+
+    bool get_fence_name(uint64_t fence_id, string &name)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = fence_slot_.find(fence_id);
+        if (it == fence_slot_.end())
+            return false;
+        name = fences_[it->second].name;
+        return true;
+    }
+
+    size_t fence_count()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return active_count_;
+    }
+
+    // ========================================================================
+    // PERSISTENCE
+    // ========================================================================
+
+    // One fence per line: fence_id,type,name,lat lon;lat lon;...
+    bool load_from_file(const string &path)
+    {
+        ifstream file(path);
+        if (!file.is_open())
+            return false;
+
+        string line;
+        while (getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            stringstream ss(line);
+            string id_str, type_str, name, points;
+            if (!getline(ss, id_str, ',') || !getline(ss, type_str, ',') ||
+                !getline(ss, name, ',') || !getline(ss, points))
+                continue;
+
+            vector<pair<double, double>> vertices;
+            stringstream ps(points);
+            string vertex;
+            while (getline(ps, vertex, ';'))
+            {
+                stringstream vs(vertex);
+                double lat, lon;
+                if (vs >> lat >> lon)
+                    vertices.push_back(make_pair(lat, lon));
+            }
+
+            try
+            {
+                add_fence(stoull(id_str), (GeofenceType)stoi(type_str), name, vertices);
+            }
+            catch (const exception &)
+            {
+                continue;
+            }
+        }
+
+        return true;
+    }
+
+    bool save_to_file(const string &path)
+    {
+        ofstream file(path, ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        lock_guard<mutex> lock(mtx_);
+        file << "# fence_id,type,name,lat lon;lat lon;..." << endl;
+        file << fixed << setprecision(7);
+        for (const auto &f : fences_)
+        {
+            if (!f.active)
+                continue;
+
+            string name = f.name;
+            replace(name.begin(), name.end(), ',', ' ');
+
+            file << f.fence_id << ',' << (int)f.type << ',' << name << ',';
+            for (size_t i = 0; i < f.lat.size(); i++)
+            {
+                file << (i ? ";" : "") << f.lat[i] << ' ' << f.lon[i];
+            }
+            file << endl;
+        }
+
+        return file.good();
+    }
+};
+
+#endif
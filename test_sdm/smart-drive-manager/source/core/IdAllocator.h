@@ -0,0 +1,136 @@
+#ifndef IDALLOCATOR_H
+#define IDALLOCATOR_H
+
+#include "../../include/sdm_types.hpp"
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+// Hands out ids in leased blocks. Each thread keeps its own lease per IdSpace,
+// so the common path is a thread-local increment; the shared high-water mark is
+// only touched (and persisted once) when a thread runs out of its block.
+class IdAllocator
+{
+public:
+    // Called with the new high-water mark before any id of the block is used
+    using PersistFn = function<bool(IdSpace, uint64_t)>;
+
+private:
+    static constexpr size_t SPACE_COUNT = static_cast<size_t>(IdSpace::COUNT);
+
+    struct Lease
+    {
+        uint64_t next;
+        uint64_t end; // exclusive
+    };
+
+    struct ThreadLeases
+    {
+        uint64_t generation;
+        Lease leases[SPACE_COUNT];
+
+        ThreadLeases() : generation(0)
+        {
+            memset(leases, 0, sizeof(leases));
+        }
+    };
+
+    atomic<uint64_t> high_water_[SPACE_COUNT];
+    uint64_t persisted_[SPACE_COUNT];
+    mutex persist_mtx_;
+    PersistFn persist_;
+    uint32_t block_size_;
+    atomic<uint64_t> generation_; // bumped by load(), read by every next()
+
+    static atomic<uint64_t> &generation_counter()
+    {
+        static atomic<uint64_t> counter(1);
+        return counter;
+    }
+
+    static ThreadLeases &thread_leases()
+    {
+        static thread_local ThreadLeases leases;
+        return leases;
+    }
+
+    bool lease_block(IdSpace space, Lease &lease)
+    {
+        size_t s = static_cast<size_t>(space);
+        uint64_t start = high_water_[s].fetch_add(block_size_) + 1;
+        uint64_t end = start + block_size_;
+
+        {
+            lock_guard<mutex> lock(persist_mtx_);
+            if (end - 1 > persisted_[s])
+            {
+                if (persist_ && !persist_(space, end - 1))
+                {
+                    return false;
+                }
+                persisted_[s] = end - 1;
+            }
+        }
+
+        lease.next = start;
+        lease.end = end;
+        return true;
+    }
+
+public:
+    IdAllocator(uint32_t block_size = 64)
+        : block_size_(block_size > 0 ? block_size : 1), generation_(0)
+    {
+        for (size_t i = 0; i < SPACE_COUNT; i++)
+        {
+            high_water_[i].store(0);
+            persisted_[i] = 0;
+        }
+    }
+
+    // Start from the marks stored in the header. Leases handed out before a
+    // reload are dropped, which only leaves gaps in the id sequence.
+    void load(const uint64_t (&high_water)[SPACE_COUNT], PersistFn persist)
+    {
+        lock_guard<mutex> lock(persist_mtx_);
+        for (size_t i = 0; i < SPACE_COUNT; i++)
+        {
+            high_water_[i].store(high_water[i]);
+            persisted_[i] = high_water[i];
+        }
+        persist_ = persist;
+        generation_.store(generation_counter().fetch_add(1), memory_order_release);
+    }
+
+    // Returns 0 if a new block could not be made durable
+    uint64_t next(IdSpace space)
+    {
+        ThreadLeases &tl = thread_leases();
+        uint64_t generation = generation_.load(memory_order_acquire);
+        if (tl.generation != generation)
+        {
+            tl = ThreadLeases();
+            tl.generation = generation;
+        }
+
+        Lease &lease = tl.leases[static_cast<size_t>(space)];
+        if (lease.next >= lease.end && !lease_block(space, lease))
+        {
+            return 0;
+        }
+
+        return lease.next++;
+    }
+
+    uint64_t get_high_water(IdSpace space) const
+    {
+        return high_water_[static_cast<size_t>(space)].load();
+    }
+
+    uint32_t get_block_size() const { return block_size_; }
+};
+
+#endif
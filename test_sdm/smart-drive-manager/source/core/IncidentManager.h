@@ -4,25 +4,42 @@
 #include "../../include/sdm_types.hpp"
 #include "DatabaseManager.h"
 #include "CacheManager.h"
+#include "IndexManager.h"
+#include "ReverseGeocoder.h"
+#include "DriverLeaderboard.h"
 #include <vector>
 #include<iostream>
 #include <string>
+#include <mutex>
 using namespace std;
 
 class IncidentManager {
 private:
     DatabaseManager& db_;
     CacheManager& cache_;
+    IndexManager& index_;
+    ReverseGeocoder* geocoder_;
+    DriverLeaderboard* leaderboard_;
     
+    // Write-through copy of the incident table, loaded at construction.
+    // Filed from request handlers and from the crash recorder's thread.
     vector<IncidentReport> incidents_;
-    uint64_t next_incident_id_;
+    mutable mutex incidents_mtx_;
 
-    void update_driver_safety_after_incident(uint64_t driver_id, IncidentType type) {
-        DriverProfile driver;
-        if (!db_.read_driver(driver_id, driver)) {
-            return;
+    // Applies fn to the cached incident and writes it back to the table
+    template <typename Fn>
+    bool modify_incident(uint64_t incident_id, Fn fn) {
+        lock_guard<mutex> lock(incidents_mtx_);
+        for (auto& inc : incidents_) {
+            if (inc.incident_id == incident_id) {
+                fn(inc);
+                return db_.update_incident(inc);
+            }
         }
-        
+        return false;
+    }
+
+    void update_driver_safety_after_incident(uint64_t driver_id, IncidentType type) {
         uint32_t deduction = 0;
         switch(type) {
             case IncidentType::ACCIDENT:
@@ -47,21 +64,46 @@ private:
                 break;
         }
         
-        if (driver.safety_score > deduction) {
-            driver.safety_score -= deduction;
-        } else {
-            driver.safety_score = 0;
+        DriverProfile driver;
+        bool updated = db_.modify_driver(driver_id, [deduction](DriverProfile& d) {
+            d.safety_score = d.safety_score > deduction ? d.safety_score - deduction : 0;
+        }, driver);
+        if (!updated) {
+            return;
         }
         
-        db_.update_driver(driver);
         cache_.invalidate_driver(driver_id);
+        if (leaderboard_) {
+            leaderboard_->update(driver);
+        }
         
         cout << "New Safety Score: " << driver.safety_score << "/1000" << endl;
     }
 
 public:
-    IncidentManager(DatabaseManager& db, CacheManager& cache)
-        : db_(db), cache_(cache) {}
+    IncidentManager(DatabaseManager& db, CacheManager& cache, IndexManager& index)
+        : db_(db), cache_(cache), index_(index), geocoder_(nullptr), leaderboard_(nullptr) {
+        // The spatial index persists across restarts, so its INCIDENT hits
+        // must resolve against incidents filed by earlier runs
+        bool backfill = index_.spatial_index_created();
+        db_.for_each_incident([this, backfill](const IncidentReport& incident) {
+            incidents_.push_back(incident);
+            if (backfill) {
+                index_.insert_spatial(SpatialKind::INCIDENT, incident.incident_id,
+                                      incident.latitude, incident.longitude);
+            }
+        });
+    }
+
+    // Fills location_address when the reporter leaves it empty
+    void set_geocoder(ReverseGeocoder* geocoder) {
+        geocoder_ = geocoder;
+    }
+
+    // Safety deductions are applied to the driver's leaderboard position
+    void set_leaderboard(DriverLeaderboard* leaderboard) {
+        leaderboard_ = leaderboard;
+    }
     
     uint64_t report_incident(uint64_t driver_id,
                             uint64_t vehicle_id,
@@ -70,8 +112,12 @@ public:
                             double longitude,
                             const string& location_address,
                             const string& description,
-                            uint64_t trip_id = 0) {
-        uint64_t incident_id = next_incident_id_++;
+                            uint64_t trip_id = 0,
+                            uint64_t telemetry_capture_id = 0) {
+        uint64_t incident_id = db_.next_id(IdSpace::INCIDENT);
+        if (incident_id == 0) {
+            return 0;
+        }
         
         IncidentReport incident;
         incident.incident_id = incident_id;
@@ -82,13 +128,25 @@ public:
         incident.incident_time = get_current_timestamp();
         incident.latitude = latitude;
         incident.longitude = longitude;
-        strncpy(incident.location_address, location_address.c_str(), 
+        string address = location_address;
+        if (address.empty() && geocoder_) {
+            address = geocoder_->describe(latitude, longitude);
+        }
+        strncpy(incident.location_address, address.c_str(), 
                sizeof(incident.location_address) - 1);
         strncpy(incident.description, description.c_str(), 
                sizeof(incident.description) - 1);
         incident.is_resolved = 0;
+        incident.telemetry_capture_id = telemetry_capture_id;
         
-        incidents_.push_back(incident);
+        {
+            lock_guard<mutex> lock(incidents_mtx_);
+            if (!db_.create_incident(incident)) {
+                return 0;
+            }
+            incidents_.push_back(incident);
+        }
+        index_.insert_spatial(SpatialKind::INCIDENT, incident_id, latitude, longitude);
         
         
         update_driver_safety_after_incident(driver_id, type);
@@ -105,14 +163,11 @@ public:
             IncidentType::ACCIDENT, latitude, longitude, "", description);
         
         
-        for (auto& inc : incidents_) {
-            if (inc.incident_id == incident_id) {
-                strncpy(inc.other_party_info, other_party_info.c_str(), 
-                       sizeof(inc.other_party_info) - 1);
-                inc.estimated_damage = estimated_damage;
-                break;
-            }
-        }
+        modify_incident(incident_id, [&](IncidentReport& inc) {
+            strncpy(inc.other_party_info, other_party_info.c_str(), 
+                   sizeof(inc.other_party_info) - 1);
+            inc.estimated_damage = estimated_damage;
+        });
         
         return incident_id;
     }
@@ -131,48 +186,45 @@ public:
         uint64_t incident_id = report_incident(driver_id, vehicle_id,
             IncidentType::THEFT, latitude, longitude, "", description);
         
-        for (auto& inc : incidents_) {
-            if (inc.incident_id == incident_id) {
-                strncpy(inc.police_report_number, police_report_number.c_str(),
-                       sizeof(inc.police_report_number) - 1);
-                break;
-            }
-        }
+        modify_incident(incident_id, [&](IncidentReport& inc) {
+            strncpy(inc.police_report_number, police_report_number.c_str(),
+                   sizeof(inc.police_report_number) - 1);
+        });
         
         return incident_id;
     }
     
     bool add_police_report(uint64_t incident_id, const string& report_number) {
-        for (auto& inc : incidents_) {
-            if (inc.incident_id == incident_id) {
-                strncpy(inc.police_report_number, report_number.c_str(),
-                       sizeof(inc.police_report_number) - 1);
-                return true;
-            }
-        }
-        return false;
+        return modify_incident(incident_id, [&](IncidentReport& inc) {
+            strncpy(inc.police_report_number, report_number.c_str(),
+                   sizeof(inc.police_report_number) - 1);
+        });
     }
     
     bool add_insurance_claim(uint64_t incident_id,
                             const string& claim_number,
                             double payout_amount) {
-        for (auto& inc : incidents_) {
-            if (inc.incident_id == incident_id) {
-                strncpy(inc.insurance_claim_number, claim_number.c_str(),
-                       sizeof(inc.insurance_claim_number) - 1);
-                inc.insurance_payout = payout_amount;
-                return true;
-            }
-        }
-        return false;
+        return modify_incident(incident_id, [&](IncidentReport& inc) {
+            strncpy(inc.insurance_claim_number, claim_number.c_str(),
+                   sizeof(inc.insurance_claim_number) - 1);
+            inc.insurance_payout = payout_amount;
+        });
     }
     
     
     bool mark_resolved(uint64_t incident_id) {
-        for (auto& inc : incidents_) {
+        uint64_t now = get_current_timestamp();
+        return modify_incident(incident_id, [now](IncidentReport& inc) {
+            inc.is_resolved = 1;
+            inc.resolved_date = now;
+        });
+    }
+    
+    bool get_incident(uint64_t incident_id, IncidentReport& incident) {
+        lock_guard<mutex> lock(incidents_mtx_);
+        for (const auto& inc : incidents_) {
             if (inc.incident_id == incident_id) {
-                inc.is_resolved = 1;
-                inc.resolved_date = get_current_timestamp();
+                incident = inc;
                 return true;
             }
         }
@@ -181,6 +233,7 @@ public:
     
     vector<IncidentReport> get_driver_incidents(uint64_t driver_id) {
         vector<IncidentReport> result;
+        lock_guard<mutex> lock(incidents_mtx_);
         for (const auto& inc : incidents_) {
             if (inc.driver_id == driver_id) {
                 result.push_back(inc);
@@ -189,8 +242,38 @@ public:
         return result;
     }
     
+    // k closest incidents, nearest first
+    vector<IncidentReport> get_incidents_near(double latitude, double longitude, size_t k) {
+        vector<IncidentReport> result;
+        auto hits = index_.spatial_nearest(latitude, longitude, k,
+                                           spatial_mask(SpatialKind::INCIDENT));
+        for (const auto& hit : hits) {
+            IncidentReport incident;
+            if (get_incident(hit.entity_id, incident)) {
+                result.push_back(incident);
+            }
+        }
+        return result;
+    }
+    
+    vector<IncidentReport> get_incidents_in_area(double min_lat, double min_lon,
+                                                 double max_lat, double max_lon,
+                                                 size_t limit = 0) {
+        vector<IncidentReport> result;
+        auto hits = index_.spatial_bbox_query(min_lat, min_lon, max_lat, max_lon,
+                                              spatial_mask(SpatialKind::INCIDENT), limit);
+        for (const auto& hit : hits) {
+            IncidentReport incident;
+            if (get_incident(hit.entity_id, incident)) {
+                result.push_back(incident);
+            }
+        }
+        return result;
+    }
+    
     vector<IncidentReport> get_vehicle_incidents(uint64_t vehicle_id) {
         vector<IncidentReport> result;
+        lock_guard<mutex> lock(incidents_mtx_);
         for (const auto& inc : incidents_) {
             if (inc.vehicle_id == vehicle_id) {
                 result.push_back(inc);
@@ -201,6 +284,7 @@ public:
     
     vector<IncidentReport> get_unresolved_incidents(uint64_t driver_id) {
         vector<IncidentReport> result;
+        lock_guard<mutex> lock(incidents_mtx_);
         for (const auto& inc : incidents_) {
             if (inc.driver_id == driver_id && inc.is_resolved == 0) {
                 result.push_back(inc);
@@ -212,6 +296,7 @@ public:
     vector<IncidentReport> get_incidents_by_type(uint64_t driver_id,
                                                       IncidentType type) {
         vector<IncidentReport> result;
+        lock_guard<mutex> lock(incidents_mtx_);
         for (const auto& inc : incidents_) {
             if (inc.driver_id == driver_id && inc.type == type) {
                 result.push_back(inc);
@@ -3,6 +3,7 @@
 
 #include "../../source/data_structures/BTree.h"
 #include "../../source/data_structures/BPlusTree.h"
+#include "SpatialIndex.h"
 #include "../../include/sdm_types.hpp"
 #include <memory>
 #include <string>
@@ -19,6 +20,9 @@ private:
     unique_ptr<BPlusTree> driver_email_index_;
     unique_ptr<BPlusTree> vehicle_plate_index_;
     unique_ptr<BPlusTree> driver_username_index_;
+    unique_ptr<SpatialIndex> spatial_index_;
+    // Set when spatial.idx was created empty this run and needs backfilling
+    bool spatial_created_;
 
     string index_dir_;
 
@@ -36,7 +40,7 @@ private:
     }
 
 public:
-    IndexManager(const string &index_dir) : index_dir_(index_dir) {}
+    IndexManager(const string &index_dir) : spatial_created_(false), index_dir_(index_dir) {}
 
     ~IndexManager()
     {
@@ -96,6 +100,15 @@ public:
         }
         cout << " ✓" << endl;
 
+        cout << "      Creating spatial B+ Tree..." << flush;
+        spatial_index_ = make_unique<SpatialIndex>(index_dir_ + "/spatial.idx");
+        if (!spatial_index_->create()) {
+            cerr << endl << "      ERROR: Failed to create spatial index!" << endl;
+            return false;
+        }
+        spatial_created_ = true;
+        cout << " ✓" << endl;
+
         return true;
     }
 
@@ -136,6 +149,18 @@ public:
         }
         cout << " ✓" << endl;
 
+        // Added later than the others: create it on its own rather than
+        // failing, which would make the caller recreate every index
+        cout << "      Opening spatial index..." << flush;
+        spatial_index_ = make_unique<SpatialIndex>(index_dir_ + "/spatial.idx");
+        if (!spatial_index_->open()) {
+            cout << " NOT FOUND, creating" << endl;
+            if (!spatial_index_->create())
+                return false;
+            spatial_created_ = true;
+        }
+        cout << " ✓" << endl;
+
         return true;
     }
 
@@ -149,6 +174,8 @@ public:
             vehicle_plate_index_->close();
         if (driver_username_index_)
             driver_username_index_->close();
+        if (spatial_index_)
+            spatial_index_->close();
     }
 
     bool insert_primary(uint8_t entity_type, uint64_t entity_id,
@@ -181,6 +208,15 @@ public:
         return false;
     }
 
+    bool remove_primary(uint8_t entity_type, uint64_t entity_id, uint64_t timestamp)
+    {
+        if (!primary_index_)
+            return false;
+
+        CompositeKey key(entity_type, entity_id, timestamp, 0);
+        return primary_index_->remove(key);
+    }
+
     vector<uint64_t> range_query_primary(uint8_t entity_type, uint64_t entity_id,
                                               uint64_t start_time, uint64_t end_time)
     {
@@ -284,6 +320,41 @@ public:
         return false;
     }
 
+    bool insert_spatial(SpatialKind kind, uint64_t entity_id,
+                        double latitude, double longitude)
+    {
+        if (!spatial_index_)
+            return false;
+
+        return spatial_index_->insert(kind, entity_id, latitude, longitude);
+    }
+
+    // The trip and incident managers refill a new index from their tables
+    bool spatial_index_created() const
+    {
+        return spatial_created_;
+    }
+
+    vector<SpatialHit> spatial_bbox_query(double min_lat, double min_lon,
+                                          double max_lat, double max_lon,
+                                          uint32_t kinds = SPATIAL_ALL,
+                                          size_t limit = 0)
+    {
+        if (!spatial_index_)
+            return vector<SpatialHit>();
+
+        return spatial_index_->query_bbox(min_lat, min_lon, max_lat, max_lon, kinds, limit);
+    }
+
+    vector<SpatialHit> spatial_nearest(double latitude, double longitude, size_t k,
+                                       uint32_t kinds = SPATIAL_ALL)
+    {
+        if (!spatial_index_)
+            return vector<SpatialHit>();
+
+        return spatial_index_->nearest(latitude, longitude, k, kinds);
+    }
+
     bool rebuild_driver_indexes(const vector<DriverProfile> &drivers)
     {
         for (const auto &driver : drivers)
@@ -317,6 +388,11 @@ public:
     {
         return vehicle_plate_index_ ? vehicle_plate_index_->get_total_entries() : 0;
     }
+
+    uint64_t get_spatial_count() const
+    {
+        return spatial_index_ ? spatial_index_->get_total_entries() : 0;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef LASTSERVICETABLE_H
+#define LASTSERVICETABLE_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/DatabaseManager.h"
+#include <unordered_map>
+using namespace std;
+
+static const int MAINTENANCE_TYPES = 6; // MaintenanceType::OIL_CHANGE .. GENERAL_SERVICE
+
+// The fields of a vehicle's most recent service of one type that due-date
+// checks need. maintenance_id 0 means no service of that type yet.
+struct LastService
+{
+    uint64_t maintenance_id;
+    uint64_t service_date;
+    uint64_t next_service_date;
+    double next_service_odometer;
+
+    LastService() : maintenance_id(0), service_date(0), next_service_date(0),
+                    next_service_odometer(0) {}
+};
+
+struct VehicleServices
+{
+    LastService by_type[MAINTENANCE_TYPES];
+};
+
+// Latest service per (vehicle, maintenance type), loaded with one pass over
+// the maintenance table and updated as records are added, so due checks no
+// longer scan the table per vehicle. Not synchronized; the owner guards it
+// with a reader/writer lock.
+class LastServiceTable
+{
+private:
+    unordered_map<uint64_t, VehicleServices> vehicles_;
+
+public:
+    void rebuild(DatabaseManager &db)
+    {
+        vehicles_.clear();
+        db.for_each_maintenance([this](const MaintenanceRecord &record)
+                                { record_service(record); });
+    }
+
+    // Keeps the record if it is the newest of its type for the vehicle
+    void record_service(const MaintenanceRecord &record)
+    {
+        int type = (int)record.type;
+        if (type >= MAINTENANCE_TYPES)
+            return;
+
+        LastService &last = vehicles_[record.vehicle_id].by_type[type];
+        if (last.maintenance_id != 0 && record.service_date < last.service_date)
+            return;
+
+        last.maintenance_id = record.maintenance_id;
+        last.service_date = record.service_date;
+        last.next_service_date = record.next_service_date;
+        last.next_service_odometer = record.next_service_odometer;
+    }
+
+    // nullptr if the vehicle has never been serviced
+    const VehicleServices *find(uint64_t vehicle_id) const
+    {
+        auto it = vehicles_.find(vehicle_id);
+        return it == vehicles_.end() ? nullptr : &it->second;
+    }
+
+    void forget(uint64_t vehicle_id)
+    {
+        vehicles_.erase(vehicle_id);
+    }
+
+    size_t vehicle_count() const
+    {
+        return vehicles_.size();
+    }
+};
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef REVERSEGEOCODER_H
+#define REVERSEGEOCODER_H
+
+#include "../../source/data_structures/HashTable.h"
+#include "GeoMath.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+#pragma pack(push, 1)
+
+struct GeoIndexHeader
+{
+    char magic[8]; // "SDMGEO1"
+    uint32_t version;
+    uint32_t place_count;
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+// One k-d tree node. Points are unit vectors on the sphere, so the chord
+// distance orders places the same way as great-circle distance and there is
+// no special case at the poles or the antimeridian.
+struct GeoPlaceRecord
+{
+    float x, y, z;
+    float latitude;
+    float longitude;
+    uint32_t name_offset; // into the string table
+    uint32_t population;
+    uint8_t axis; // split axis of this node: 0 = x, 1 = y, 2 = z
+    char country[3];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(GeoIndexHeader) == 32, "GeoIndexHeader must be 32 bytes");
+static_assert(sizeof(GeoPlaceRecord) == 32, "GeoPlaceRecord must be 32 bytes");
+
+struct ReverseGeocodeResult
+{
+    string name;
+    string country;
+    double latitude;
+    double longitude;
+    double distance_km;
+};
+
+// Offline reverse geocoding. build() turns a place list into a file holding
+// an implicit k-d tree (node of [lo, hi) at (lo + hi) / 2, children in the two
+// halves) followed by a string table; open() maps it read-only and lookups
+// walk the mapping directly. Results are cached per ~100 m cell.
+class ReverseGeocoder
+{
+private:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr double CACHE_CELL_DEG = 0.001;
+
+    int fd_;
+    const uint8_t *map_;
+    size_t map_size_;
+    const GeoPlaceRecord *places_;
+    const char *names_;
+    uint32_t place_count_;
+
+    // quantised (lat, lon) -> place index
+    LRUCache<uint64_t, uint32_t> cache_;
+    mutex cache_mtx_;
+
+    atomic<uint64_t> lookups_;
+    atomic<uint64_t> cache_hits_;
+
+    static void to_unit(double lat, double lon, double v[3])
+    {
+        double phi = lat * GeoMath::DEG_TO_RAD;
+        double lambda = lon * GeoMath::DEG_TO_RAD;
+        v[0] = cos(phi) * cos(lambda);
+        v[1] = cos(phi) * sin(lambda);
+        v[2] = sin(phi);
+    }
+
+    static double chord_to_km(double chord_sq)
+    {
+        double half = sqrt(chord_sq) / 2;
+        return 2 * GeoMath::EARTH_RADIUS_KM * asin(half < 1 ? half : 1);
+    }
+
+    static uint64_t cache_key(double lat, double lon)
+    {
+        uint32_t row = (uint32_t)llround((lat + 90) / CACHE_CELL_DEG);
+        uint32_t col = (uint32_t)llround((lon + 180) / CACHE_CELL_DEG);
+        return ((uint64_t)row << 32) | col;
+    }
+
+    void search(uint32_t lo, uint32_t hi, const double q[3],
+                uint32_t &best, double &best_sq) const
+    {
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            const GeoPlaceRecord &node = places_[mid];
+
+            double dx = q[0] - node.x, dy = q[1] - node.y, dz = q[2] - node.z;
+            double d_sq = dx * dx + dy * dy + dz * dz;
+            if (d_sq < best_sq)
+            {
+                best_sq = d_sq;
+                best = mid;
+            }
+
+            double diff = q[node.axis] - (node.axis == 0 ? node.x : node.axis == 1 ? node.y : node.z);
+            uint32_t near_lo = diff < 0 ? lo : mid + 1;
+            uint32_t near_hi = diff < 0 ? mid : hi;
+            uint32_t far_lo = diff < 0 ? mid + 1 : lo;
+            uint32_t far_hi = diff < 0 ? hi : mid;
+
+            search(near_lo, near_hi, q, best, best_sq);
+            if (diff * diff >= best_sq)
+                return;
+
+            // Tail-iterate into the far side
+            lo = far_lo;
+            hi = far_hi;
+        }
+    }
+
+    static void build_tree(vector<GeoPlaceRecord> &places, size_t lo, size_t hi)
+    {
+        if (hi <= lo)
+            return;
+
+        float min_v[3] = {2, 2, 2}, max_v[3] = {-2, -2, -2};
+        for (size_t i = lo; i < hi; i++)
+        {
+            const float v[3] = {places[i].x, places[i].y, places[i].z};
+            for (int a = 0; a < 3; a++)
+            {
+                min_v[a] = min(min_v[a], v[a]);
+                max_v[a] = max(max_v[a], v[a]);
+            }
+        }
+
+        uint8_t axis = 0;
+        for (uint8_t a = 1; a < 3; a++)
+        {
+            if (max_v[a] - min_v[a] > max_v[axis] - min_v[axis])
+                axis = a;
+        }
+
+        size_t mid = lo + (hi - lo) / 2;
+        auto coord = [axis](const GeoPlaceRecord &p)
+        { return axis == 0 ? p.x : axis == 1 ? p.y : p.z; };
+        nth_element(places.begin() + lo, places.begin() + mid, places.begin() + hi,
+                    [&](const GeoPlaceRecord &a, const GeoPlaceRecord &b)
+                    { return coord(a) < coord(b); });
+        places[mid].axis = axis;
+
+        build_tree(places, lo, mid);
+        build_tree(places, mid + 1, hi);
+    }
+
+    static bool parse_place(const string &line, string &name, double &lat, double &lon,
+                            string &country, uint32_t &population)
+    {
+        vector<string> fields;
+        char sep = line.find('\t') != string::npos ? '\t' : ',';
+        stringstream ss(line);
+        string field;
+        while (getline(ss, field, sep))
+            fields.push_back(field);
+
+        try
+        {
+            if (sep == '\t')
+            {
+                // GeoNames dump: id, name, asciiname, alternates, lat, lon,
+                // class, code, country, cc2, admin1..4, population, ...
+                if (fields.size() < 9)
+                    return false;
+                name = fields[1];
+                lat = stod(fields[4]);
+                lon = stod(fields[5]);
+                country = fields[8];
+                population = fields.size() > 14 && !fields[14].empty()
+                                 ? (uint32_t)min(stoull(fields[14]), (unsigned long long)UINT32_MAX)
+                                 : 0;
+            }
+            else
+            {
+                // name,lat,lon[,country[,population]]
+                if (fields.size() < 3)
+                    return false;
+                name = fields[0];
+                lat = stod(fields[1]);
+                lon = stod(fields[2]);
+                country = fields.size() > 3 ? fields[3] : "";
+                population = fields.size() > 4 && !fields[4].empty() ? (uint32_t)stoul(fields[4]) : 0;
+            }
+        }
+        catch (const exception &)
+        {
+            return false;
+        }
+
+        return !name.empty() && lat >= -90 && lat <= 90 && lon >= -180 && lon <= 180;
+    }
+
+public:
+    ReverseGeocoder(size_t cache_capacity = 4096)
+        : fd_(-1), map_(nullptr), map_size_(0), places_(nullptr), names_(nullptr),
+          place_count_(0), cache_(cache_capacity), lookups_(0), cache_hits_(0) {}
+
+    ~ReverseGeocoder()
+    {
+        close();
+    }
+
+    // Converts a GeoNames dump (cities500.txt, allCountries.txt, ...) or a
+    // name,lat,lon[,country[,population]] CSV into an index file. Lines that
+    // do not parse are skipped; places is set to the number written.
+    static bool build(const string &input_path, const string &output_path, size_t &places)
+    {
+        places = 0;
+        ifstream in(input_path);
+        if (!in.is_open())
+            return false;
+
+        vector<GeoPlaceRecord> records;
+        string names;
+        string line, name, country;
+        double lat, lon;
+        uint32_t population;
+
+        while (getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (!parse_place(line, name, lat, lon, country, population))
+                continue;
+            if (names.size() + name.size() + 1 > UINT32_MAX)
+                break;
+
+            GeoPlaceRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            double v[3];
+            to_unit(lat, lon, v);
+            rec.x = (float)v[0];
+            rec.y = (float)v[1];
+            rec.z = (float)v[2];
+            rec.latitude = (float)lat;
+            rec.longitude = (float)lon;
+            rec.population = population;
+            rec.name_offset = (uint32_t)names.size();
+            strncpy(rec.country, country.c_str(), 2);
+
+            names.append(name);
+            names.push_back('\0');
+            records.push_back(rec);
+        }
+
+        if (records.empty() || records.size() > UINT32_MAX)
+            return false;
+
+        build_tree(records, 0, records.size());
+
+        GeoIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "SDMGEO1", 8);
+        header.version = FORMAT_VERSION;
+        header.place_count = (uint32_t)records.size();
+        header.names_offset = sizeof(GeoIndexHeader) + records.size() * sizeof(GeoPlaceRecord);
+        header.names_size = names.size();
+
+        ofstream out(output_path, ios::binary | ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(records.data()),
+                  records.size() * sizeof(GeoPlaceRecord));
+        out.write(names.data(), names.size());
+        out.close();
+
+        if (!out.good())
+            return false;
+
+        places = records.size();
+        return true;
+    }
+
+    bool open(const string &path)
+    {
+        close();
+
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || (size_t)st.st_size < sizeof(GeoIndexHeader))
+        {
+            close();
+            return false;
+        }
+
+        map_size_ = (size_t)st.st_size;
+        void *map = mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED)
+        {
+            map_size_ = 0;
+            close();
+            return false;
+        }
+        map_ = static_cast<const uint8_t *>(map);
+        madvise(map, map_size_, MADV_RANDOM);
+
+        const GeoIndexHeader *header = reinterpret_cast<const GeoIndexHeader *>(map_);
+        uint64_t records_end = sizeof(GeoIndexHeader) +
+                               (uint64_t)header->place_count * sizeof(GeoPlaceRecord);
+        if (memcmp(header->magic, "SDMGEO1", 8) != 0 || header->version != FORMAT_VERSION ||
+            header->names_offset != records_end || header->names_offset > map_size_ ||
+            header->names_size > map_size_ - header->names_offset ||
+            header->names_size == 0 || map_[header->names_offset + header->names_size - 1] != '\0')
+        {
+            close();
+            return false;
+        }
+
+        // The table ends in a NUL, so an in-range offset always reads a
+        // terminated name; a bad axis would index past the query vector
+        const GeoPlaceRecord *places = reinterpret_cast<const GeoPlaceRecord *>(map_ + sizeof(GeoIndexHeader));
+        for (uint32_t i = 0; i < header->place_count; i++)
+        {
+            if (places[i].name_offset >= header->names_size || places[i].axis > 2)
+            {
+                close();
+                return false;
+            }
+        }
+
+        places_ = places;
+        names_ = reinterpret_cast<const char *>(map_ + header->names_offset);
+        place_count_ = header->place_count;
+
+        lock_guard<mutex> lock(cache_mtx_);
+        cache_.clear();
+        return true;
+    }
+
+    void close()
+    {
+        if (map_)
+            munmap(const_cast<uint8_t *>(map_), map_size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+
+        fd_ = -1;
+        map_ = nullptr;
+        map_size_ = 0;
+        places_ = nullptr;
+        names_ = nullptr;
+        place_count_ = 0;
+    }
+
+    bool is_open() const { return map_ != nullptr; }
+    uint32_t place_count() const { return place_count_; }
+
+    // Nearest place within max_km. Positions in the same cache cell share
+    // one answer; distance_km is always measured from the given position.
+    bool lookup(double latitude, double longitude, ReverseGeocodeResult &result,
+                double max_km = 50.0)
+    {
+        if (!map_ || place_count_ == 0 || latitude < -90 || latitude > 90 ||
+            longitude < -180 || longitude > 180)
+            return false;
+
+        lookups_++;
+        uint64_t key = cache_key(latitude, longitude);
+        uint32_t best = 0;
+        bool cached;
+        {
+            lock_guard<mutex> lock(cache_mtx_);
+            cached = cache_.get(key, best);
+        }
+
+        double q[3];
+        to_unit(latitude, longitude, q);
+
+        if (cached)
+        {
+            cache_hits_++;
+        }
+        else
+        {
+            double best_sq = 5.0; // above the largest possible chord (2^2)
+            search(0, place_count_, q, best, best_sq);
+
+            lock_guard<mutex> lock(cache_mtx_);
+            cache_.put(key, best);
+        }
+
+        const GeoPlaceRecord &place = places_[best];
+        double dx = q[0] - place.x, dy = q[1] - place.y, dz = q[2] - place.z;
+        double distance_km = chord_to_km(dx * dx + dy * dy + dz * dz);
+        if (distance_km > max_km)
+            return false;
+
+        result.name = names_ + place.name_offset;
+        result.country.assign(place.country, strnlen(place.country, sizeof(place.country)));
+        result.latitude = place.latitude;
+        result.longitude = place.longitude;
+        result.distance_km = distance_km;
+        return true;
+    }
+
+    // "Locality, CC", or empty when nothing is within max_km
+    string describe(double latitude, double longitude, double max_km = 50.0)
+    {
+        ReverseGeocodeResult result;
+        if (!lookup(latitude, longitude, result, max_km))
+            return "";
+        return result.country.empty() ? result.name : result.name + ", " + result.country;
+    }
+
+    uint64_t get_lookups() const { return lookups_.load(); }
+    uint64_t get_cache_hits() const { return cache_hits_.load(); }
+};
+
+#endif
@@ -0,0 +1,474 @@
+#ifndef ROLLUPMANAGER_H
+#define ROLLUPMANAGER_H
+
+#include "../../include/sdm_types.hpp"
+#include "../../source/core/DatabaseManager.h"
+#include "../../source/data_structures/SegmentTree.h"
+#include "../../source/data_structures/Sketches.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+enum class RollupOwner : uint8_t
+{
+    DRIVER = 1,
+    VEHICLE = 2
+};
+
+#pragma pack(push, 1)
+
+// One logged change to an owner's day. Replaying the log rebuilds the rollups.
+struct RollupDelta
+{
+    uint64_t owner_id;
+    uint8_t owner_type; // RollupOwner
+    uint8_t reserved[3];
+    int32_t day; // days since 1970-01-01 UTC
+
+    double distance;
+    double duration;
+    double fuel;
+    double expenses;
+    double avg_speed; // weighted by trip_count when merged
+    double max_speed;
+    double min_speed;
+    int32_t trip_count;
+    int32_t harsh_braking;
+    int32_t rapid_acceleration;
+    int32_t speeding;
+    int32_t sharp_turns;
+    int32_t expense_count;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(RollupDelta) == 96, "RollupDelta must be 96 bytes");
+
+// Fleet-wide trip distributions for a set of days: per-trip average speed
+// (km/h) and duration (s) quantiles, and distinct drivers and vehicles
+struct FleetSketch
+{
+    QuantileSketch speed;
+    QuantileSketch duration;
+    HyperLogLog<> drivers;
+    HyperLogLog<> vehicles;
+
+    void add(uint64_t driver_id, uint64_t vehicle_id, uint32_t seconds, double distance)
+    {
+        if (seconds > 0)
+            speed.add(distance / seconds * 3600);
+        duration.add(seconds);
+        drivers.add(driver_id);
+        vehicles.add(vehicle_id);
+    }
+
+    void merge(const FleetSketch &other)
+    {
+        speed.merge(other.speed);
+        duration.merge(other.duration);
+        drivers.merge(other.drivers);
+        vehicles.merge(other.vehicles);
+    }
+};
+
+// Per-driver and per-vehicle daily totals. Each owner has one SegmentStats per
+// day and a SegmentTree over them, so any date range is an O(log days) query.
+// Updates are appended to <db>.rollup and applied in place; the log is
+// rewritten as one record per (owner, day) when it grows too long.
+//
+// Alongside, a fleet-wide FleetSketch per day sits in a SketchTree for
+// quantile and distinct-count queries over any date range. The sketches are
+// not logged; they are refilled from the trip columns on open.
+class RollupManager
+{
+private:
+    struct OwnerRollup
+    {
+        int32_t base_day;
+        vector<SegmentStats> days;
+        SegmentTree tree;
+
+        OwnerRollup() : base_day(0), tree(1, 0) {}
+    };
+
+    string filename_;
+    ofstream log_;
+    unordered_map<uint64_t, unique_ptr<OwnerRollup>> owners_;
+    uint64_t log_records_;
+    uint64_t day_slots_; // days with data, across owners
+    SketchTree<FleetSketch> fleet_;
+    mutex mtx_;
+
+    static constexpr uint64_t NANOS_PER_DAY = 86400ULL * 1000000000ULL;
+    static constexpr uint64_t COMPACT_MIN_RECORDS = 100000;
+
+    static uint64_t owner_key(RollupOwner type, uint64_t owner_id)
+    {
+        return (owner_id << 2) | (uint64_t)type;
+    }
+
+    static SegmentStats to_stats(const RollupDelta &d)
+    {
+        SegmentStats s;
+        s.total_distance = d.distance;
+        s.total_duration = d.duration;
+        s.total_fuel = d.fuel;
+        s.total_expenses = d.expenses;
+        s.avg_speed = d.avg_speed;
+        s.max_speed = d.max_speed;
+        s.min_speed = d.min_speed;
+        s.trip_count = d.trip_count;
+        s.harsh_braking_events = d.harsh_braking;
+        s.rapid_acceleration_events = d.rapid_acceleration;
+        s.speeding_violations = d.speeding;
+        s.sharp_turn_events = d.sharp_turns;
+        s.expense_count = d.expense_count;
+        return s;
+    }
+
+    static RollupDelta to_delta(RollupOwner type, uint64_t owner_id, int32_t day,
+                                const SegmentStats &s)
+    {
+        RollupDelta d;
+        memset(&d, 0, sizeof(d));
+        d.owner_id = owner_id;
+        d.owner_type = (uint8_t)type;
+        d.day = day;
+        d.distance = s.total_distance;
+        d.duration = s.total_duration;
+        d.fuel = s.total_fuel;
+        d.expenses = s.total_expenses;
+        d.avg_speed = s.avg_speed;
+        d.max_speed = s.max_speed;
+        d.min_speed = s.min_speed;
+        d.trip_count = s.trip_count;
+        d.harsh_braking = s.harsh_braking_events;
+        d.rapid_acceleration = s.rapid_acceleration_events;
+        d.speeding = s.speeding_violations;
+        d.sharp_turns = s.sharp_turn_events;
+        d.expense_count = s.expense_count;
+        return d;
+    }
+
+    // Caller holds mtx_. Grows the day range by doubling, so rebuilding the
+    // tree is amortised over many updates.
+    void apply_locked(const RollupDelta &delta)
+    {
+        auto &slot = owners_[owner_key((RollupOwner)delta.owner_type, delta.owner_id)];
+        if (!slot)
+        {
+            slot.reset(new OwnerRollup());
+            slot->base_day = delta.day;
+        }
+        OwnerRollup &owner = *slot;
+
+        int32_t first = owner.days.empty() ? delta.day : min(owner.base_day, delta.day);
+        int32_t last = owner.days.empty() ? delta.day
+                                          : max(owner.base_day + (int32_t)owner.days.size() - 1, delta.day);
+
+        if (owner.days.empty() || first < owner.base_day ||
+            last >= owner.base_day + (int32_t)owner.days.size())
+        {
+            size_t span = (size_t)(last - first + 1);
+            size_t capacity = max<size_t>(owner.days.size(), 64);
+            while (capacity < span)
+                capacity *= 2;
+
+            // Leave room on the side that grew
+            int32_t new_base = !owner.days.empty() && first < owner.base_day
+                                   ? last - (int32_t)capacity + 1
+                                   : first;
+
+            vector<SegmentStats> days(capacity);
+            for (size_t i = 0; i < owner.days.size(); i++)
+            {
+                days[owner.base_day - new_base + i] = owner.days[i];
+            }
+            owner.days.swap(days);
+            owner.base_day = new_base;
+            owner.tree = SegmentTree((int)capacity, (uint64_t)new_base * 86400ULL);
+            owner.tree.build(owner.days);
+        }
+
+        SegmentStats &leaf = owner.days[delta.day - owner.base_day];
+        if (leaf.days_covered == 0)
+            day_slots_++;
+        leaf = SegmentStats::merge(leaf, to_stats(delta));
+        leaf.days_covered = 1;
+        owner.tree.update_day(delta.day - owner.base_day, leaf);
+    }
+
+    // Caller holds mtx_
+    bool log_locked(const RollupDelta &delta)
+    {
+        if (!log_.is_open())
+            return false;
+
+        log_.write(reinterpret_cast<const char *>(&delta), sizeof(delta));
+        log_.flush();
+        log_records_++;
+
+        if (log_records_ > COMPACT_MIN_RECORDS && log_records_ > 4 * day_slots_)
+            compact_locked();
+
+        return log_.good();
+    }
+
+    // Caller holds mtx_
+    bool record_locked(const RollupDelta &delta)
+    {
+        apply_locked(delta);
+        return log_locked(delta);
+    }
+
+    // Caller holds mtx_. Writes one record per (owner, day) and swaps it in.
+    bool compact_locked()
+    {
+        string tmp = filename_ + ".tmp";
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        uint64_t records = 0;
+        for (const auto &entry : owners_)
+        {
+            RollupOwner type = (RollupOwner)(entry.first & 3);
+            uint64_t owner_id = entry.first >> 2;
+            const OwnerRollup &owner = *entry.second;
+
+            for (size_t i = 0; i < owner.days.size(); i++)
+            {
+                if (owner.days[i].days_covered == 0)
+                    continue;
+                RollupDelta d = to_delta(type, owner_id, owner.base_day + (int32_t)i, owner.days[i]);
+                out.write(reinterpret_cast<const char *>(&d), sizeof(d));
+                records++;
+            }
+        }
+        out.close();
+        if (!out.good())
+            return false;
+
+        log_.close();
+        if (rename(tmp.c_str(), filename_.c_str()) != 0)
+        {
+            log_.open(filename_, ios::binary | ios::app);
+            return false;
+        }
+
+        log_.open(filename_, ios::binary | ios::app);
+        log_records_ = records;
+        return log_.is_open();
+    }
+
+    static void add_trip_delta(vector<RollupDelta> &out, const TripRecord &trip)
+    {
+        SegmentStats s;
+        s.total_distance = trip.distance;
+        s.total_duration = (double)trip.duration;
+        s.total_fuel = trip.fuel_consumed;
+        s.avg_speed = trip.avg_speed;
+        s.max_speed = trip.max_speed;
+        s.min_speed = trip.avg_speed; // slowest trip average
+        s.trip_count = 1;
+        s.harsh_braking_events = trip.harsh_braking_count;
+        s.rapid_acceleration_events = trip.rapid_acceleration_count;
+        s.speeding_violations = trip.speeding_count;
+        s.sharp_turn_events = trip.sharp_turn_count;
+
+        int32_t day = day_of(trip.start_time);
+        out.push_back(to_delta(RollupOwner::DRIVER, trip.driver_id, day, s));
+        out.push_back(to_delta(RollupOwner::VEHICLE, trip.vehicle_id, day, s));
+    }
+
+    // Caller holds mtx_
+    void sketch_trip_locked(uint64_t driver_id, uint64_t vehicle_id, uint64_t start_time,
+                            uint32_t duration, double distance)
+    {
+        fleet_.add(day_of(start_time), [&](FleetSketch &sketch)
+                   { sketch.add(driver_id, vehicle_id, duration, distance); });
+    }
+
+    static void add_expense_delta(vector<RollupDelta> &out, const ExpenseRecord &expense)
+    {
+        SegmentStats s;
+        s.min_speed = 999999;
+        s.total_expenses = expense.amount;
+        s.expense_count = 1;
+
+        int32_t day = day_of(expense.expense_date);
+        out.push_back(to_delta(RollupOwner::DRIVER, expense.driver_id, day, s));
+        out.push_back(to_delta(RollupOwner::VEHICLE, expense.vehicle_id, day, s));
+    }
+
+public:
+    RollupManager(const string &filename)
+        : filename_(filename), log_records_(0), day_slots_(0) {}
+
+    ~RollupManager()
+    {
+        close();
+    }
+
+    // Replays the log. existed is false when there was none, in which case
+    // the caller should backfill with rebuild(); otherwise rebuild_sketches().
+    bool open(bool &existed)
+    {
+        lock_guard<mutex> lock(mtx_);
+        owners_.clear();
+        log_records_ = 0;
+        day_slots_ = 0;
+        fleet_.clear();
+
+        ifstream in(filename_, ios::binary);
+        existed = in.is_open();
+        if (existed)
+        {
+            RollupDelta delta;
+            while (in.read(reinterpret_cast<char *>(&delta), sizeof(delta)))
+            {
+                apply_locked(delta);
+                log_records_++;
+            }
+        }
+        in.close();
+
+        log_.open(filename_, ios::binary | ios::app);
+        return log_.is_open();
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (log_.is_open())
+            log_.close();
+    }
+
+    // Recomputes everything from the trip and expense tables
+    bool rebuild(DatabaseManager &db)
+    {
+        auto append = [](vector<RollupDelta> &into, vector<RollupDelta> &part)
+        { into.insert(into.end(), part.begin(), part.end()); };
+
+        vector<RollupDelta> deltas = db.scanner().reduce<TripRecord>(
+            vector<RollupDelta>(),
+            [](vector<RollupDelta> &out, const TripRecord &trip)
+            {
+                if (trip.end_time != 0)
+                    add_trip_delta(out, trip);
+            },
+            append);
+        vector<RollupDelta> expense_deltas = db.scanner().reduce<ExpenseRecord>(
+            vector<RollupDelta>(), add_expense_delta, append);
+        append(deltas, expense_deltas);
+
+        {
+            lock_guard<mutex> lock(mtx_);
+            owners_.clear();
+            day_slots_ = 0;
+            for (const auto &delta : deltas)
+                apply_locked(delta);
+            if (!compact_locked())
+                return false;
+        }
+        rebuild_sketches(db);
+        return true;
+    }
+
+    // Refills the fleet sketches from the trip columns
+    void rebuild_sketches(DatabaseManager &db)
+    {
+        lock_guard<mutex> lock(mtx_);
+        fleet_.clear();
+        db.columns().trips().for_each_finished(
+            [this](uint64_t driver_id, uint64_t vehicle_id, uint64_t start_time,
+                   uint32_t duration, double distance)
+            { sketch_trip_locked(driver_id, vehicle_id, start_time, duration, distance); });
+    }
+
+    // A finished trip counts on the day it started
+    bool record_trip(const TripRecord &trip)
+    {
+        vector<RollupDelta> deltas;
+        add_trip_delta(deltas, trip);
+
+        lock_guard<mutex> lock(mtx_);
+        sketch_trip_locked(trip.driver_id, trip.vehicle_id, trip.start_time,
+                           trip.duration, trip.distance);
+        bool ok = true;
+        for (const auto &delta : deltas)
+            ok = record_locked(delta) && ok;
+        return ok;
+    }
+
+    // sign = -1 backs an expense out (deletes, or the old side of an edit)
+    bool record_expense(const ExpenseRecord &expense, int sign = 1)
+    {
+        vector<RollupDelta> deltas;
+        add_expense_delta(deltas, expense);
+
+        lock_guard<mutex> lock(mtx_);
+        bool ok = true;
+        for (auto &delta : deltas)
+        {
+            delta.expenses *= sign;
+            delta.expense_count *= sign;
+            ok = record_locked(delta) && ok;
+        }
+        return ok;
+    }
+
+    // Inclusive day range; days with no data contribute nothing
+    SegmentStats query_days(RollupOwner type, uint64_t owner_id, int32_t first_day, int32_t last_day)
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = owners_.find(owner_key(type, owner_id));
+        if (it == owners_.end() || first_day > last_day)
+            return SegmentStats();
+
+        OwnerRollup &owner = *it->second;
+        int64_t lo = max<int64_t>((int64_t)first_day - owner.base_day, 0);
+        int64_t hi = min<int64_t>((int64_t)last_day - owner.base_day, (int64_t)owner.days.size() - 1);
+        if (lo > hi)
+            return SegmentStats();
+        return owner.tree.query_range((int)lo, (int)hi);
+    }
+
+    // Nanosecond timestamps, both ends inclusive at day granularity
+    SegmentStats query(RollupOwner type, uint64_t owner_id, uint64_t start_time, uint64_t end_time)
+    {
+        return query_days(type, owner_id, day_of(start_time), day_of(end_time));
+    }
+
+    SegmentStats query_all(RollupOwner type, uint64_t owner_id)
+    {
+        return query_days(type, owner_id, INT32_MIN, INT32_MAX);
+    }
+
+    // Fleet distributions of trips started between the two timestamps (ns),
+    // both ends inclusive at day granularity
+    FleetSketch query_fleet(uint64_t start_time, uint64_t end_time)
+    {
+        lock_guard<mutex> lock(mtx_);
+        return fleet_.query(day_of(start_time), day_of(end_time));
+    }
+
+    static int32_t day_of(uint64_t timestamp_ns)
+    {
+        return (int32_t)(timestamp_ns / NANOS_PER_DAY);
+    }
+
+    size_t owner_count()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return owners_.size();
+    }
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include "SecurityManager.h"
 #include "CacheManager.h"
 #include "DatabaseManager.h"
+#include "DriverLeaderboard.h"
 #include "../../source/data_structures/Map.h"
 #include <string>
 #include <chrono>
@@ -19,11 +20,19 @@ private:
     DatabaseManager& db_;
     uint32_t session_timeout_;
     Map<uint64_t, vector<string>> driver_sessions_;
+    DriverLeaderboard* leaderboard_;
     
 public:
     SessionManager(SecurityManager& security, CacheManager& cache, 
                    DatabaseManager& db, uint32_t timeout = 1800)
-        : security_(security), cache_(cache), db_(db), session_timeout_(timeout) {}
+        : security_(security), cache_(cache), db_(db), session_timeout_(timeout),
+          leaderboard_(nullptr) {}
+    
+    // Every profile this class writes back is mirrored on the leaderboard,
+    // new accounts included
+    void set_leaderboard(DriverLeaderboard* leaderboard) {
+        leaderboard_ = leaderboard;
+    }
     
     bool login(const string& username, const string& password, 
                string& session_id, DriverProfile& driver) {
@@ -59,8 +68,12 @@ public:
         
         cache_.put_session(session_id, session);
         
-        found_driver.last_login = session.login_time;
-        db_.update_driver(found_driver);
+        uint64_t login_time = session.login_time;
+        if (db_.modify_driver(found_driver.driver_id,
+                              [login_time](DriverProfile& d) { d.last_login = login_time; },
+                              found_driver) && leaderboard_) {
+            leaderboard_->update(found_driver);
+        }
         
         cache_.put_driver(found_driver.driver_id, found_driver);
         
@@ -181,7 +194,13 @@ public:
         new_driver.created_time = chrono::system_clock::now().time_since_epoch().count();
         new_driver.safety_score = 1000;
         
-        return db_.create_driver(new_driver);
+        if (!db_.create_driver(new_driver)) {
+            return false;
+        }
+        if (leaderboard_) {
+            leaderboard_->update(new_driver);
+        }
+        return true;
     }
     
     bool change_password(const string& session_id, 
@@ -198,12 +217,15 @@ public:
         }
         
         string new_hash = security_.hash_password(new_password);
-        strncpy(driver.password_hash, new_hash.c_str(), sizeof(driver.password_hash) - 1);
-        
-        bool success = db_.update_driver(driver);
+        bool success = db_.modify_driver(driver.driver_id, [&new_hash](DriverProfile& d) {
+            strncpy(d.password_hash, new_hash.c_str(), sizeof(d.password_hash) - 1);
+        }, driver);
         
         if (success) {
             cache_.put_driver(driver.driver_id, driver, true);
+            if (leaderboard_) {
+                leaderboard_->update(driver);
+            }
         }
         
         return success;
@@ -215,18 +237,17 @@ public:
             return false;
         }
         
-        DriverProfile driver;
-        if (!db_.read_driver(driver_id, driver)) {
-            return false;
-        }
-        
         string new_hash = security_.hash_password(new_password);
-        strncpy(driver.password_hash, new_hash.c_str(), sizeof(driver.password_hash) - 1);
-        
-        bool success = db_.update_driver(driver);
+        DriverProfile driver;
+        bool success = db_.modify_driver(driver_id, [&new_hash](DriverProfile& d) {
+            strncpy(d.password_hash, new_hash.c_str(), sizeof(d.password_hash) - 1);
+        }, driver);
         
         if (success) {
             cache_.invalidate_driver(driver_id);
+            if (leaderboard_) {
+                leaderboard_->update(driver);
+            }
         }
         
         return success;
@@ -0,0 +1,349 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "../../source/data_structures/BPlusTree.h"
+#include "GeoMath.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+using namespace std;
+
+enum class SpatialKind : uint8_t
+{
+    TRIP_START = 1,
+    TRIP_END = 2,
+    INCIDENT = 3,
+    HARSH_EVENT = 4 // entity id is the trip id
+};
+
+// Bit masks for filtering queries by kind
+constexpr uint32_t spatial_mask(SpatialKind kind) { return 1u << (uint8_t)kind; }
+constexpr uint32_t SPATIAL_ALL = 0xFFFFFFFFu;
+
+struct SpatialHit
+{
+    SpatialKind kind;
+    uint64_t entity_id;
+    double latitude;
+    double longitude;
+    double distance_km; // set by nearest()
+};
+
+class Geohash
+{
+public:
+    static constexpr int MAX_PRECISION = 12;
+
+    static string encode(double lat, double lon, int precision = MAX_PRECISION)
+    {
+        static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+        double lat_lo = -90, lat_hi = 90, lon_lo = -180, lon_hi = 180;
+        string hash;
+        bool even = true;
+        int bit = 0, ch = 0;
+
+        while ((int)hash.size() < precision)
+        {
+            if (even)
+            {
+                double mid = (lon_lo + lon_hi) / 2;
+                if (lon >= mid) { ch = (ch << 1) | 1; lon_lo = mid; }
+                else { ch <<= 1; lon_hi = mid; }
+            }
+            else
+            {
+                double mid = (lat_lo + lat_hi) / 2;
+                if (lat >= mid) { ch = (ch << 1) | 1; lat_lo = mid; }
+                else { ch <<= 1; lat_hi = mid; }
+            }
+            even = !even;
+
+            if (++bit == 5)
+            {
+                hash += BASE32[ch];
+                bit = 0;
+                ch = 0;
+            }
+        }
+
+        return hash;
+    }
+
+    // Centre of the cell
+    static bool decode(const char *hash, int length, double &lat, double &lon)
+    {
+        double lat_lo = -90, lat_hi = 90, lon_lo = -180, lon_hi = 180;
+        bool even = true;
+
+        for (int i = 0; i < length; i++)
+        {
+            int value = base32_value(hash[i]);
+            if (value < 0)
+                return false;
+
+            for (int b = 4; b >= 0; b--)
+            {
+                int bit = (value >> b) & 1;
+                if (even)
+                {
+                    double mid = (lon_lo + lon_hi) / 2;
+                    if (bit) lon_lo = mid; else lon_hi = mid;
+                }
+                else
+                {
+                    double mid = (lat_lo + lat_hi) / 2;
+                    if (bit) lat_lo = mid; else lat_hi = mid;
+                }
+                even = !even;
+            }
+        }
+
+        lat = (lat_lo + lat_hi) / 2;
+        lon = (lon_lo + lon_hi) / 2;
+        return true;
+    }
+
+    static void cell_size(int precision, double &lat_deg, double &lon_deg)
+    {
+        int bits = precision * 5;
+        lon_deg = 360.0 / pow(2.0, (bits + 1) / 2);
+        lat_deg = 180.0 / pow(2.0, bits / 2);
+    }
+
+private:
+    static int base32_value(char c)
+    {
+        static const char BASE32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+        const char *p = strchr(BASE32, c);
+        return (p && c) ? (int)(p - BASE32) : -1;
+    }
+};
+
+// Points keyed "<12-char geohash><kind><id hex>" in a B+ tree, so nearby
+// points share key prefixes and a map window becomes a few prefix range scans
+class SpatialIndex
+{
+private:
+    BPlusTree tree_;
+    mutex mtx_;
+
+    // Upper bound on prefix scans per bounding-box query
+    static constexpr int MAX_COVER_CELLS = 16;
+    static constexpr double MAX_SEARCH_KM = 20040.0; // half the circumference
+
+    static string make_key(SpatialKind kind, uint64_t entity_id, double lat, double lon)
+    {
+        char suffix[24];
+        snprintf(suffix, sizeof(suffix), "%u%016llx", (unsigned)kind,
+                 (unsigned long long)entity_id);
+        return Geohash::encode(lat, lon) + suffix;
+    }
+
+    static bool parse_key(const BPlusKey &key, const BPlusValue &value, SpatialHit &hit)
+    {
+        if (!Geohash::decode(key.data, Geohash::MAX_PRECISION, hit.latitude, hit.longitude))
+            return false;
+        hit.kind = (SpatialKind)value.entity_type;
+        hit.entity_id = value.primary_id;
+        hit.distance_km = 0;
+        return true;
+    }
+
+    // Geohash cells (at one precision) covering the box
+    static vector<string> cover(double min_lat, double min_lon, double max_lat, double max_lon)
+    {
+        int precision = Geohash::MAX_PRECISION;
+        double h = 0, w = 0;
+        for (; precision > 1; precision--)
+        {
+            Geohash::cell_size(precision, h, w);
+            double rows = floor((max_lat + 90) / h) - floor((min_lat + 90) / h) + 1;
+            double cols = floor((max_lon + 180) / w) - floor((min_lon + 180) / w) + 1;
+            if (rows * cols <= MAX_COVER_CELLS)
+                break;
+        }
+        Geohash::cell_size(precision, h, w);
+
+        vector<string> cells;
+        for (double r = floor((min_lat + 90) / h); r <= floor((max_lat + 90) / h); r++)
+        {
+            for (double c = floor((min_lon + 180) / w); c <= floor((max_lon + 180) / w); c++)
+            {
+                double lat = -90 + (r + 0.5) * h;
+                double lon = -180 + (c + 0.5) * w;
+                if (lat > 90 || lon > 180)
+                    continue;
+                cells.push_back(Geohash::encode(lat, lon, precision));
+            }
+        }
+
+        sort(cells.begin(), cells.end());
+        cells.erase(unique(cells.begin(), cells.end()), cells.end());
+        return cells;
+    }
+
+    struct SearchBox
+    {
+        double min_lat, min_lon, max_lat, max_lon;
+    };
+
+    // Boxes covering every point within radius_km of (lat, lon) on the
+    // GeoMath sphere. The longitude span comes from the cap's tangent
+    // meridians; a cap holding a pole takes every longitude, and one
+    // crossing the antimeridian is split in two.
+    static vector<SearchBox> search_boxes(double lat, double lon, double radius_km)
+    {
+        double d = radius_km / GeoMath::EARTH_RADIUS_KM; // angular radius
+        double dlat = d * GeoMath::RAD_TO_DEG;
+        double min_lat = lat - dlat, max_lat = lat + dlat;
+
+        vector<SearchBox> boxes;
+        if (d >= M_PI || min_lat <= -90 || max_lat >= 90)
+        {
+            boxes.push_back({max(-90.0, min_lat), -180, min(90.0, max_lat), 180});
+            return boxes;
+        }
+
+        double ratio = sin(d) / cos(lat * GeoMath::DEG_TO_RAD);
+        if (ratio >= 1)
+        {
+            boxes.push_back({min_lat, -180, max_lat, 180});
+            return boxes;
+        }
+
+        double dlon = asin(ratio) * GeoMath::RAD_TO_DEG;
+        double min_lon = lon - dlon, max_lon = lon + dlon;
+        if (min_lon < -180)
+        {
+            boxes.push_back({min_lat, min_lon + 360, max_lat, 180});
+            boxes.push_back({min_lat, -180, max_lat, max_lon});
+        }
+        else if (max_lon > 180)
+        {
+            boxes.push_back({min_lat, min_lon, max_lat, 180});
+            boxes.push_back({min_lat, -180, max_lat, max_lon - 360});
+        }
+        else
+        {
+            boxes.push_back({min_lat, min_lon, max_lat, max_lon});
+        }
+        return boxes;
+    }
+
+    // Caller holds mtx_. Stops after limit hits; 0 means no limit.
+    vector<SpatialHit> bbox_locked(double min_lat, double min_lon, double max_lat,
+                                   double max_lon, uint32_t kinds, size_t limit = 0)
+    {
+        vector<SpatialHit> hits;
+
+        for (const string &prefix : cover(min_lat, min_lon, max_lat, max_lon))
+        {
+            // Key characters are all below '~'
+            auto entries = tree_.range_scan(BPlusKey(prefix), BPlusKey(prefix + "~"));
+            for (const auto &entry : entries)
+            {
+                SpatialHit hit;
+                if (!parse_key(entry.first, entry.second, hit))
+                    continue;
+                if (!(kinds & spatial_mask(hit.kind)))
+                    continue;
+                if (hit.latitude < min_lat || hit.latitude > max_lat ||
+                    hit.longitude < min_lon || hit.longitude > max_lon)
+                    continue;
+                hits.push_back(hit);
+                if (limit && hits.size() >= limit)
+                    return hits;
+            }
+        }
+
+        return hits;
+    }
+
+public:
+    SpatialIndex(const string &filename) : tree_(filename, "spatial") {}
+
+    bool create()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return tree_.create() && tree_.open();
+    }
+
+    bool open()
+    {
+        lock_guard<mutex> lock(mtx_);
+        return tree_.open();
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(mtx_);
+        tree_.close();
+    }
+
+    bool insert(SpatialKind kind, uint64_t entity_id, double latitude, double longitude)
+    {
+        if (latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180)
+            return false;
+
+        lock_guard<mutex> lock(mtx_);
+        return tree_.insert(BPlusKey(make_key(kind, entity_id, latitude, longitude)),
+                            BPlusValue(entity_id, (uint8_t)kind));
+    }
+
+    // Boxes crossing the antimeridian must be split by the caller. At most
+    // limit hits, in key order; 0 returns them all.
+    vector<SpatialHit> query_bbox(double min_lat, double min_lon, double max_lat,
+                                  double max_lon, uint32_t kinds = SPATIAL_ALL,
+                                  size_t limit = 0)
+    {
+        lock_guard<mutex> lock(mtx_);
+        return bbox_locked(min_lat, min_lon, max_lat, max_lon, kinds, limit);
+    }
+
+    // k closest points, nearest first. Searches boxes that grow until they
+    // hold k points within the search radius; each box covers the whole
+    // spherical cap of that radius, so the result is exact.
+    vector<SpatialHit> nearest(double latitude, double longitude, size_t k,
+                               uint32_t kinds = SPATIAL_ALL)
+    {
+        vector<SpatialHit> result;
+        if (k == 0)
+            return result;
+
+        lock_guard<mutex> lock(mtx_);
+
+        for (double radius_km = 1.0;; radius_km *= 4)
+        {
+            bool last = radius_km >= MAX_SEARCH_KM;
+
+            result.clear();
+            for (const SearchBox &box : search_boxes(latitude, longitude, radius_km))
+            {
+                for (auto &hit : bbox_locked(box.min_lat, box.min_lon, box.max_lat,
+                                             box.max_lon, kinds))
+                {
+                    hit.distance_km = GeoMath::haversine_km(latitude, longitude,
+                                                            hit.latitude, hit.longitude);
+                    if (last || hit.distance_km <= radius_km)
+                        result.push_back(hit);
+                }
+            }
+
+            if (result.size() >= k || last)
+                break;
+        }
+
+        sort(result.begin(), result.end(), [](const SpatialHit &a, const SpatialHit &b)
+             { return a.distance_km < b.distance_km; });
+        if (result.size() > k)
+            result.resize(k);
+        return result;
+    }
+
+    uint64_t get_total_entries() const { return tree_.get_total_entries(); }
+};
+
+#endif
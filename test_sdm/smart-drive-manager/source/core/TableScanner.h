@@ -0,0 +1,378 @@
+#ifndef TABLESCANNER_H
+#define TABLESCANNER_H
+
+#include "../../include/sdm_types.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+using namespace std;
+
+// Where each fixed-size table lives in the database file and which of its
+// slots hold a record
+template <typename Record>
+struct ScanTable;
+
+template <>
+struct ScanTable<DriverProfile>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.driver_table_offset; }
+    static uint64_t slots(const SDMHeader &h) { return h.max_drivers; }
+    static bool live(const DriverProfile &r) { return r.is_active == 1; }
+};
+
+template <>
+struct ScanTable<VehicleInfo>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.vehicle_table_offset; }
+    static uint64_t slots(const SDMHeader &h) { return h.max_vehicles; }
+    static bool live(const VehicleInfo &r) { return r.is_active == 1; }
+};
+
+template <>
+struct ScanTable<TripRecord>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.trip_table_offset; }
+    static uint64_t slots(const SDMHeader &h) { return h.max_trips; }
+    static bool live(const TripRecord &r) { return r.trip_id != 0; }
+};
+
+template <>
+struct ScanTable<MaintenanceRecord>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.maintenance_table_offset; }
+    static uint64_t slots(const SDMHeader &) { return 100000; }
+    static bool live(const MaintenanceRecord &r) { return r.maintenance_id != 0; }
+};
+
+template <>
+struct ScanTable<ExpenseRecord>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.expense_table_offset; }
+    static uint64_t slots(const SDMHeader &) { return 500000; }
+    static bool live(const ExpenseRecord &r) { return r.expense_id != 0; }
+};
+
+template <>
+struct ScanTable<DocumentMetadata>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.document_table_offset; }
+    static uint64_t slots(const SDMHeader &) { return 100000; }
+    static bool live(const DocumentMetadata &r) { return r.document_id != 0; }
+};
+
+template <>
+struct ScanTable<IncidentReport>
+{
+    static uint64_t offset(const SDMHeader &h) { return h.incident_table_offset; }
+    static uint64_t slots(const SDMHeader &) { return 50000; }
+    static bool live(const IncidentReport &r) { return r.incident_id != 0; }
+};
+
+// Parallel full-table scans. A table's slot range is cut into ~1 MB chunks
+// that a fixed pool of threads claims one at a time and reads with pread()
+// on a private read-only descriptor, so scans never move the shared stream
+// position. Each chunk folds its live records into its own partial, and the
+// partials are merged in slot order, so results match a sequential scan.
+//
+// Only one scan runs at a time. Fold and predicate callbacks are invoked
+// concurrently and must not touch shared state.
+class TableScanner
+{
+private:
+    static constexpr size_t CHUNK_BYTES = 1 << 20;
+
+    int fd_;
+    SDMHeader header_;
+    unsigned threads_;
+    vector<vector<char>> buffers_; // one chunk buffer per thread; 0 is the caller's
+
+    vector<thread> workers_;
+    mutex mtx_;
+    condition_variable work_cv_;
+    condition_variable done_cv_;
+    const function<void(size_t, unsigned)> *job_;
+    size_t job_parts_;
+    atomic<size_t> next_part_;
+    size_t busy_workers_;
+    uint64_t generation_;
+    bool stopping_;
+
+    mutex scan_mtx_;
+
+    void drain(unsigned worker)
+    {
+        size_t part;
+        while ((part = next_part_.fetch_add(1)) < job_parts_)
+        {
+            (*job_)(part, worker);
+        }
+    }
+
+    // seen is the generation current when the worker was started
+    void worker_loop(unsigned worker, uint64_t seen)
+    {
+        unique_lock<mutex> lock(mtx_);
+        while (true)
+        {
+            work_cv_.wait(lock, [&]
+                          { return stopping_ || generation_ != seen; });
+            if (stopping_)
+                return;
+            seen = generation_;
+
+            lock.unlock();
+            drain(worker);
+            lock.lock();
+
+            if (--busy_workers_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+
+    // Runs fn(part, worker) for every part, the calling thread included
+    void run_parts(size_t parts, const function<void(size_t, unsigned)> &fn)
+    {
+        if (workers_.empty() || parts < 2)
+        {
+            for (size_t part = 0; part < parts; part++)
+                fn(part, 0);
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(mtx_);
+            job_ = &fn;
+            job_parts_ = parts;
+            next_part_ = 0;
+            busy_workers_ = workers_.size();
+            generation_++;
+        }
+        work_cv_.notify_all();
+
+        drain(0);
+
+        unique_lock<mutex> lock(mtx_);
+        done_cv_.wait(lock, [this]
+                      { return busy_workers_ == 0; });
+        job_ = nullptr;
+    }
+
+    bool read_at(uint64_t offset, char *buffer, size_t bytes)
+    {
+        while (bytes > 0)
+        {
+            ssize_t n = pread(fd_, buffer, bytes, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            buffer += n;
+            offset += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    void stop_workers()
+    {
+        {
+            lock_guard<mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto &worker : workers_)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+        workers_.clear();
+        stopping_ = false;
+    }
+
+    template <typename Record>
+    static size_t records_per_part()
+    {
+        return max<size_t>(1, CHUNK_BYTES / sizeof(Record));
+    }
+
+    // Caller holds scan_mtx_
+    template <typename Record>
+    size_t part_count() const
+    {
+        if (fd_ < 0)
+            return 0;
+        uint64_t slots = ScanTable<Record>::slots(header_);
+        return (size_t)((slots + records_per_part<Record>() - 1) / records_per_part<Record>());
+    }
+
+    // Caller holds scan_mtx_. Reads each part into the running thread's
+    // buffer and hands it to on_part(part, first slot, records, count).
+    template <typename Record, typename OnPart>
+    void scan_parts(size_t parts, OnPart on_part)
+    {
+        uint64_t slots = ScanTable<Record>::slots(header_);
+        uint64_t base = ScanTable<Record>::offset(header_);
+        size_t per_part = records_per_part<Record>();
+
+        function<void(size_t, unsigned)> scan_part = [&](size_t part, unsigned worker)
+        {
+            uint64_t first = (uint64_t)part * per_part;
+            size_t n = (size_t)min<uint64_t>(per_part, slots - first);
+            char *buffer = buffers_[worker].data();
+            if (!read_at(base + first * sizeof(Record), buffer, n * sizeof(Record)))
+                return;
+
+            on_part(part, first, reinterpret_cast<const Record *>(buffer), n);
+        };
+        run_parts(parts, scan_part);
+    }
+
+public:
+    // threads = 0 uses the hardware concurrency
+    TableScanner(unsigned threads = 0)
+        : fd_(-1), threads_(threads), job_(nullptr), job_parts_(0), next_part_(0),
+          busy_workers_(0), generation_(0), stopping_(false)
+    {
+        header_ = SDMHeader();
+    }
+
+    ~TableScanner()
+    {
+        close();
+    }
+
+    TableScanner(const TableScanner &) = delete;
+    TableScanner &operator=(const TableScanner &) = delete;
+
+    bool open(const string &filename, const SDMHeader &header)
+    {
+        close();
+
+        lock_guard<mutex> lock(scan_mtx_);
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            return false;
+        header_ = header;
+
+        unsigned threads = threads_ ? threads_ : thread::hardware_concurrency();
+        threads = max(1u, threads);
+        buffers_.assign(threads, vector<char>(CHUNK_BYTES));
+        for (unsigned i = 1; i < threads; i++)
+        {
+            workers_.emplace_back(&TableScanner::worker_loop, this, i, generation_);
+        }
+        return true;
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(scan_mtx_);
+        stop_workers();
+        buffers_.clear();
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool is_open() const { return fd_ >= 0; }
+    unsigned thread_count() const { return (unsigned)buffers_.size(); }
+
+    // Folds every live record into a per-chunk copy of init with
+    // fold(Acc &, const Record &), then combines the chunks in slot order
+    // with merge(Acc &into, Acc &part). init must be an identity for merge.
+    // Chunks that fail to read contribute nothing.
+    template <typename Record, typename Acc, typename Fold, typename Merge>
+    Acc reduce(const Acc &init, Fold fold, Merge merge)
+    {
+        lock_guard<mutex> lock(scan_mtx_);
+        size_t parts = part_count<Record>();
+        if (parts == 0)
+            return init;
+
+        vector<Acc> partial(parts, init);
+        scan_parts<Record>(parts, [&](size_t part, uint64_t, const Record *records, size_t n)
+                           {
+            Acc &acc = partial[part];
+            for (size_t i = 0; i < n; i++)
+            {
+                if (ScanTable<Record>::live(records[i]))
+                    fold(acc, records[i]);
+            } });
+
+        Acc result = move(partial[0]);
+        for (size_t part = 1; part < parts; part++)
+        {
+            merge(result, partial[part]);
+        }
+        return result;
+    }
+
+    // fn(slot, record) for every slot, used or not, called from several
+    // threads at once in no particular order
+    template <typename Record, typename Fn>
+    void for_each_slot(Fn fn)
+    {
+        lock_guard<mutex> lock(scan_mtx_);
+        scan_parts<Record>(part_count<Record>(),
+                           [&](size_t, uint64_t first, const Record *records, size_t n)
+                           {
+            for (size_t i = 0; i < n; i++)
+                fn(first + i, records[i]); });
+    }
+
+    // project(record) for every live record matching pred, in slot order
+    template <typename Record, typename Pred, typename Project>
+    auto select(Pred pred, Project project)
+        -> vector<typename decay<decltype(project(declval<const Record &>()))>::type>
+    {
+        typedef typename decay<decltype(project(declval<const Record &>()))>::type Out;
+
+        return reduce<Record>(
+            vector<Out>(),
+            [&](vector<Out> &out, const Record &record)
+            {
+                if (pred(record))
+                    out.push_back(project(record));
+            },
+            [](vector<Out> &into, vector<Out> &part)
+            {
+                into.insert(into.end(), make_move_iterator(part.begin()),
+                            make_move_iterator(part.end()));
+            });
+    }
+
+    template <typename Record, typename Pred>
+    vector<Record> filter(Pred pred)
+    {
+        return select<Record>(pred, [](const Record &record)
+                              { return record; });
+    }
+
+    template <typename Record, typename Pred>
+    uint64_t count(Pred pred)
+    {
+        return reduce<Record>(
+            (uint64_t)0,
+            [&](uint64_t &n, const Record &record)
+            {
+                if (pred(record))
+                    n++;
+            },
+            [](uint64_t &into, uint64_t &part)
+            { into += part; });
+    }
+};
+
+#endif
@@ -8,11 +8,21 @@
 #include "../../source/core/DatabaseManager.h"
 #include "../../source/core/CacheManager.h"
 #include "../../source/core/IndexManager.h"
+#include "../../source/core/GeoMath.h"
+#include "../../source/core/GPSLog.h"
+#include "../../source/core/GeofenceManager.h"
+#include "../../source/core/ReverseGeocoder.h"
+#include "../../source/core/RollupManager.h"
+#include "../../source/core/DriverLeaderboard.h"
 #include "../../source/data_structures/CircularQueue.h"
 #include "../../source/data_structures/DoublyLinkedList.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
 
 class TripManager
 {
@@ -20,8 +30,13 @@ private:
     DatabaseManager &db_;
     CacheManager &cache_;
     IndexManager &index_;
-    // GPS data buffer
-    CircularQueue<GPSWaypoint> gps_buffer_;
+    // GPS data buffer, drained in batches by the ingest stage
+    GPSBuffer gps_buffer_;
+    GPSLog gps_log_;
+    GeofenceManager *geofences_;
+    ReverseGeocoder *geocoder_;
+    RollupManager *rollups_;
+    DriverLeaderboard *leaderboard_;
 
     // Active trips
     struct ActiveTrip
@@ -33,37 +48,106 @@ private:
         bool vision_active;
     };
 
-    std::vector<ActiveTrip> active_trips_;
+    std::unordered_map<uint64_t, ActiveTrip> active_trips_;
+    std::mutex trips_mtx_;
+
+    // Held for a whole batch so batches are applied in queue order
+    std::mutex ingest_mtx_;
+    std::thread ingest_thread_;
+    std::atomic<bool> ingest_running_;
+
+    // Reused across batches (guarded by ingest_mtx_)
+    std::vector<GPSDataPoint> batch_;
+    std::vector<GPSLogEntry> log_entries_;
+    std::vector<double> batch_lat_;
+    std::vector<double> batch_lon_;
+    std::vector<double> batch_bearing_;
+    std::vector<uint64_t> batch_vehicle_;
+    std::vector<GPSLogEntry> harsh_points_;
+
+    std::atomic<uint64_t> points_ingested_;
+    std::atomic<uint64_t> points_dropped_;
+    std::atomic<uint64_t> batches_written_;
+    std::atomic<uint64_t> largest_batch_;
+    std::atomic<uint64_t> queue_high_water_;
+    std::atomic<uint64_t> latency_sum_ns_;
+    std::atomic<uint64_t> latency_max_ns_;
 
     // Constants
-    static constexpr double EARTH_RADIUS_KM = 6371.0;
     static constexpr double HARSH_BRAKING_THRESHOLD = -3.0;     // m/s²
     static constexpr double RAPID_ACCELERATION_THRESHOLD = 3.0; // m/s²
     static constexpr double SPEEDING_THRESHOLD = 120.0;         // km/h
+    static constexpr size_t GPS_BATCH_SIZE = 8192;
+    static constexpr int GPS_FLUSH_INTERVAL_MS = 50;
+
     void update_driver_safety_score(uint64_t driver_id, int delta)
     {
         DriverProfile driver;
-        if (db_.read_driver(driver_id, driver))
-        {
-            int new_score = (int)driver.safety_score + delta;
+        bool updated = db_.modify_driver(driver_id, [delta](DriverProfile &d)
+                                         {
+            int new_score = (int)d.safety_score + delta;
 
             if (new_score < 0)
                 new_score = 0;
             if (new_score > 1000)
                 new_score = 1000;
 
-            driver.safety_score = (uint32_t)new_score;
+            d.safety_score = (uint32_t)new_score; }, driver);
 
-            db_.update_driver(driver);
+        if (updated)
+        {
             cache_.invalidate_driver(driver_id);
+            if (leaderboard_)
+            {
+                leaderboard_->update(driver);
+            }
         }
     }
 
 public:
+    struct GPSIngestStats
+    {
+        uint64_t points_ingested;
+        uint64_t points_dropped; // buffer full, unknown trip or write failure
+        uint64_t batches_written;
+        uint64_t largest_batch;
+        uint64_t queue_high_water;
+        uint64_t queue_depth;
+        uint64_t latency_sum_ns; // queued -> applied, over ingested points
+        uint64_t latency_max_ns;
+    };
+
     TripManager(DatabaseManager &db, CacheManager &cache, IndexManager &index,
                 size_t gps_buffer_size = 50000)
         : db_(db), cache_(cache), index_(index),
-          gps_buffer_(gps_buffer_size) {}
+          gps_buffer_(gps_buffer_size), gps_log_(db.get_filename() + ".gps"),
+          geofences_(nullptr), geocoder_(nullptr), rollups_(nullptr),
+          leaderboard_(nullptr),
+          ingest_running_(false), points_ingested_(0), points_dropped_(0),
+          batches_written_(0), largest_batch_(0), queue_high_water_(0),
+          latency_sum_ns_(0), latency_max_ns_(0)
+    {
+        // A new spatial index gets the endpoints of stored trips; harsh-event
+        // points are not kept in the trip table and start over empty
+        if (index_.spatial_index_created())
+        {
+            db_.for_each_trip([this](const TripRecord &trip)
+                              {
+                index_.insert_spatial(SpatialKind::TRIP_START, trip.trip_id,
+                                      trip.start_latitude, trip.start_longitude);
+                if (trip.end_time != 0)
+                {
+                    index_.insert_spatial(SpatialKind::TRIP_END, trip.trip_id,
+                                          trip.end_latitude, trip.end_longitude);
+                } });
+        }
+    }
+
+    ~TripManager()
+    {
+        stop_gps_ingest();
+        flush_gps_buffer();
+    }
 
     // ========================================================================
     // TRIP LIFECYCLE
@@ -75,6 +159,10 @@ public:
     {
         // Generate trip ID
         uint64_t trip_id = generate_trip_id();
+        if (trip_id == 0)
+        {
+            return 0;
+        }
 
         // Create trip record
         TripRecord trip;
@@ -84,7 +172,12 @@ public:
         trip.start_time = get_current_timestamp();
         trip.start_latitude = start_lat;
         trip.start_longitude = start_lon;
-        strncpy(trip.start_address, start_address.c_str(), sizeof(trip.start_address) - 1);
+        std::string address = start_address;
+        if (address.empty() && geocoder_)
+        {
+            address = geocoder_->describe(start_lat, start_lon);
+        }
+        strncpy(trip.start_address, address.c_str(), sizeof(trip.start_address) - 1);
 
         // Save to database
         if (!db_.create_trip(trip))
@@ -94,6 +187,7 @@ public:
 
         // Add to index
         index_.insert_primary(3, trip_id, trip.start_time, 0); // entity_type=3 for Trip
+        index_.insert_spatial(SpatialKind::TRIP_START, trip_id, start_lat, start_lon);
 
         // Create active trip
         ActiveTrip active;
@@ -101,58 +195,62 @@ public:
         active.record = trip;
         active.start_time = trip.start_time;
         active.vision_active = false;
-        active_trips_.push_back(active);
+
+        std::lock_guard<std::mutex> lock(trips_mtx_);
+        active_trips_[trip_id] = active;
 
         return trip_id;
     }
 
+    // Only queues the point; detection and storage happen in the ingest stage
     bool log_gps_point(uint64_t trip_id, double latitude, double longitude,
                        float speed, float altitude = 0, float accuracy = 0)
     {
-        // Create waypoint
-        GPSWaypoint waypoint;
-        waypoint.timestamp = get_current_timestamp();
-        waypoint.latitude = latitude;
-        waypoint.longitude = longitude;
-        waypoint.speed = speed;
-        waypoint.altitude = altitude;
-        waypoint.accuracy = accuracy;
-
-        // Add to buffer
-        if (!gps_buffer_.try_enqueue(waypoint))
         {
-            return false; // Buffer full
+            std::lock_guard<std::mutex> lock(trips_mtx_);
+            if (active_trips_.find(trip_id) == active_trips_.end())
+            {
+                return false;
+            }
         }
 
-        // Find active trip and add waypoint
-        for (auto &active : active_trips_)
+        GPSDataPoint point(trip_id, get_current_timestamp(), latitude, longitude, speed);
+        point.altitude = altitude;
+        point.accuracy = accuracy;
+
+        if (!gps_buffer_.try_enqueue(point))
         {
-            if (active.trip_id == trip_id)
+            // No ingest thread, or it has fallen behind: drain inline and retry
+            flush_gps_buffer();
+            if (!gps_buffer_.try_enqueue(point))
             {
-                active.waypoints.push_back(waypoint);
-
-                // Detect driving events
-                detect_driving_events(active, waypoint);
-
-                return true;
+                points_dropped_++;
+                return false; // Buffer full
             }
         }
 
-        return false;
+        return true;
     }
+
     bool end_trip(uint64_t trip_id, double end_lat, double end_lon,
                   const std::string &end_address = "")
     {
-        auto it = std::find_if(active_trips_.begin(), active_trips_.end(),
-                               [trip_id](const ActiveTrip &t)
-                               { return t.trip_id == trip_id; });
-
-        if (it == active_trips_.end())
+        ActiveTrip active;
         {
-            return false;
-        }
+            // Apply every queued point before the trip is closed
+            std::lock_guard<std::mutex> ingest_lock(ingest_mtx_);
+            drain_gps_buffer();
 
-        ActiveTrip &active = *it;
+            std::lock_guard<std::mutex> lock(trips_mtx_);
+            auto it = active_trips_.find(trip_id);
+            if (it == active_trips_.end())
+            {
+                return false;
+            }
+
+            active = std::move(it->second);
+            active_trips_.erase(it);
+        }
 
         // Stop vision processing and update safety score
 
@@ -161,60 +259,125 @@ public:
         active.record.end_time = get_current_timestamp();
         active.record.end_latitude = end_lat;
         active.record.end_longitude = end_lon;
-        strncpy(active.record.end_address, end_address.c_str(), sizeof(active.record.end_address) - 1);
+        std::string address = end_address;
+        if (address.empty() && geocoder_)
+        {
+            address = geocoder_->describe(end_lat, end_lon);
+        }
+        strncpy(active.record.end_address, address.c_str(), sizeof(active.record.end_address) - 1);
         active.record.duration = (active.record.end_time - active.record.start_time) / 1000000000;
         active.record.gps_data_count = active.waypoints.size();
 
         if (!db_.update_trip(active.record))
         {
-            return false; // Database update failed
+            // Database update failed; keep the trip open so it can be retried
+            std::lock_guard<std::mutex> lock(trips_mtx_);
+            active_trips_[trip_id] = std::move(active);
+            return false;
         }
-        
-        update_driver_stats(active.record);
 
-        active_trips_.erase(it);
+        index_.insert_spatial(SpatialKind::TRIP_END, trip_id, end_lat, end_lon);
+        update_driver_stats(active.record);
+        if (rollups_)
+        {
+            rollups_->record_trip(active.record);
+        }
 
         return true;
     }
 
-    void detect_driving_events(ActiveTrip &trip, const GPSWaypoint &current)
-    {
-        if (trip.waypoints.size() < 2)
-            return;
+    // ========================================================================
+    // GPS INGEST
+    // ========================================================================
 
-        const GPSWaypoint &previous = trip.waypoints[trip.waypoints.size() - 2];
+    // Background thread that drains the GPS buffer every GPS_FLUSH_INTERVAL_MS.
+    // Without it, points are drained when the buffer fills or a trip ends.
+    bool start_gps_ingest()
+    {
+        if (ingest_running_.exchange(true))
+        {
+            return false;
+        }
 
-        double time_diff = (current.timestamp - previous.timestamp) / 1000000000.0;
-        if (time_diff <= 0)
-            return;
+        ingest_thread_ = std::thread([this]()
+                                     {
+            while (ingest_running_)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(GPS_FLUSH_INTERVAL_MS));
+                flush_gps_buffer();
+            }
+            flush_gps_buffer(); });
 
-        double speed_diff = current.speed - previous.speed;
-        double acceleration = (speed_diff / 3.6) / time_diff;
+        return true;
+    }
 
-        if (acceleration < HARSH_BRAKING_THRESHOLD)
+    void stop_gps_ingest()
+    {
+        ingest_running_ = false;
+        if (ingest_thread_.joinable())
         {
-            trip.record.harsh_braking_count++;
-            update_driver_safety_score(trip.record.driver_id, -5);
+            ingest_thread_.join();
         }
+    }
 
-        if (acceleration > RAPID_ACCELERATION_THRESHOLD)
-        {
-            trip.record.rapid_acceleration_count++;
-            update_driver_safety_score(trip.record.driver_id, -3);
-        }
+    // Processes everything queued so far; returns the number of points taken
+    size_t flush_gps_buffer()
+    {
+        std::lock_guard<std::mutex> lock(ingest_mtx_);
+        return drain_gps_buffer();
+    }
 
-        if (current.speed > SPEEDING_THRESHOLD)
-        {
-            trip.record.speeding_count++;
-            update_driver_safety_score(trip.record.driver_id, -10);
-        }
+    // Positions are checked against these fences as batches are applied;
+    // pass nullptr to stop
+    void set_geofences(GeofenceManager *geofences)
+    {
+        std::lock_guard<std::mutex> lock(ingest_mtx_);
+        geofences_ = geofences;
+    }
+
+    // Fills start/end addresses the caller leaves empty; pass nullptr to stop
+    void set_geocoder(ReverseGeocoder *geocoder)
+    {
+        geocoder_ = geocoder;
+    }
 
-        double heading_change = calculate_heading_change(previous, current);
-        if (abs(heading_change) > 30 && current.speed > 20)
+    // Finished trips are added to these daily rollups, and statistics are
+    // answered from them instead of rescanning the trip table
+    void set_rollups(RollupManager *rollups)
+    {
+        rollups_ = rollups;
+    }
+
+    void set_leaderboard(DriverLeaderboard *leaderboard)
+    {
+        leaderboard_ = leaderboard;
+    }
+
+    GPSIngestStats get_ingest_stats() const
+    {
+        GPSIngestStats stats;
+        stats.points_ingested = points_ingested_.load();
+        stats.points_dropped = points_dropped_.load();
+        stats.batches_written = batches_written_.load();
+        stats.largest_batch = largest_batch_.load();
+        stats.queue_high_water = queue_high_water_.load();
+        stats.queue_depth = gps_buffer_.size();
+        stats.latency_sum_ns = latency_sum_ns_.load();
+        stats.latency_max_ns = latency_max_ns_.load();
+        return stats;
+    }
+
+    // Stored track of a finished trip, read back from the GPS log
+    std::vector<GPSWaypoint> get_trip_waypoints(uint64_t trip_id)
+    {
+        TripRecord trip;
+        if (!get_trip_details(trip_id, trip))
         {
-            trip.record.sharp_turn_count++;
-            update_driver_safety_score(trip.record.driver_id, -2);
+            return std::vector<GPSWaypoint>();
         }
+
+        return gps_log_.read_trip(trip_id, trip.gps_data_offset, trip.gps_data_end_offset,
+                                  trip.gps_data_count);
     }
 
     void calculate_trip_metrics(ActiveTrip &trip)
@@ -222,14 +385,8 @@ public:
         if (trip.waypoints.empty())
             return;
 
-        // Calculate total distance
-        double total_distance = 0;
-        for (size_t i = 1; i < trip.waypoints.size(); i++)
-        {
-            total_distance += calculate_distance(
-                trip.waypoints[i - 1].latitude, trip.waypoints[i - 1].longitude,
-                trip.waypoints[i].latitude, trip.waypoints[i].longitude);
-        }
+        // Calculate total distance over the whole track in one batch
+        double total_distance = GeoMath::path_length_km(GeoTrack(trip.waypoints));
         trip.record.distance = total_distance;
 
         // Calculate average speed
@@ -262,6 +419,22 @@ public:
     // TRIP QUERIES
     // ========================================================================
 
+    // The vehicle's trip in progress, if any
+    bool get_active_trip(uint64_t vehicle_id, uint64_t &trip_id, uint64_t &driver_id)
+    {
+        std::lock_guard<std::mutex> lock(trips_mtx_);
+        for (const auto &entry : active_trips_)
+        {
+            if (entry.second.record.vehicle_id == vehicle_id)
+            {
+                trip_id = entry.first;
+                driver_id = entry.second.record.driver_id;
+                return true;
+            }
+        }
+        return false;
+    }
+
     std::vector<TripRecord> get_driver_trips(uint64_t driver_id, int limit = 100)
     {
         // Check cache first
@@ -343,6 +516,19 @@ public:
         return false;
     }
 
+    // Trip endpoints and harsh-event points inside the box, for map views.
+    // kinds is a mask of spatial_mask(SpatialKind::...) values; limit 0
+    // returns every point.
+    std::vector<SpatialHit> get_trip_points_in_area(double min_lat, double min_lon,
+                                                    double max_lat, double max_lon,
+                                                    size_t limit = 0,
+                                                    uint32_t kinds = spatial_mask(SpatialKind::TRIP_START) |
+                                                                     spatial_mask(SpatialKind::TRIP_END) |
+                                                                     spatial_mask(SpatialKind::HARSH_EVENT))
+    {
+        return index_.spatial_bbox_query(min_lat, min_lon, max_lat, max_lon, kinds, limit);
+    }
+
     // ========================================================================
     // ANALYTICS
     // ========================================================================
@@ -362,28 +548,125 @@ public:
 
     TripStatistics get_driver_statistics(uint64_t driver_id)
     {
-        TripStatistics stats = {};
+        if (rollups_)
+        {
+            return to_trip_statistics(rollups_->query_all(RollupOwner::DRIVER, driver_id));
+        }
 
-        auto trips = db_.get_trips_by_driver(driver_id, 10000);
+        return to_trip_statistics(db_.columns().trips().totals(driver_id, 0, 0, UINT64_MAX));
+    }
 
-        for (const auto &trip : trips)
+    // Trips started between the two timestamps (ns). Rollups answer at day
+    // granularity; without them the trip columns are scanned exactly.
+    TripStatistics get_driver_statistics(uint64_t driver_id, uint64_t start_time, uint64_t end_time)
+    {
+        if (!rollups_)
         {
-            stats.total_trips++;
-            stats.total_distance += trip.distance;
-            stats.total_duration += trip.duration;
-            stats.total_fuel += trip.fuel_consumed;
+            return to_trip_statistics(db_.columns().trips().totals(driver_id, 0, start_time, end_time));
+        }
+        return to_trip_statistics(rollups_->query(RollupOwner::DRIVER, driver_id, start_time, end_time));
+    }
 
-            if (trip.max_speed > stats.max_speed)
-            {
-                stats.max_speed = trip.max_speed;
-            }
+    TripStatistics get_vehicle_statistics(uint64_t vehicle_id, uint64_t start_time, uint64_t end_time)
+    {
+        if (!rollups_)
+        {
+            return to_trip_statistics(db_.columns().trips().totals(0, vehicle_id, start_time, end_time));
+        }
+        return to_trip_statistics(rollups_->query(RollupOwner::VEHICLE, vehicle_id, start_time, end_time));
+    }
+
+    // Every finished trip in the fleet started between the two timestamps (ns)
+    TripStatistics get_fleet_statistics(uint64_t start_time = 0, uint64_t end_time = UINT64_MAX)
+    {
+        return to_trip_statistics(db_.columns().trips().totals(0, 0, start_time, end_time));
+    }
+
+    // Approximate: quantiles within 2%, distinct counts within a few percent
+    struct TripDistribution
+    {
+        uint64_t total_trips;
+        double speed_p50; // km/h, per-trip average
+        double speed_p95;
+        double duration_p50; // seconds
+        double duration_p95;
+        uint64_t active_drivers;
+        uint64_t active_vehicles;
+    };
 
-            stats.total_harsh_events += trip.harsh_braking_count +
-                                        trip.rapid_acceleration_count +
-                                        trip.speeding_count +
-                                        trip.sharp_turn_count;
+    // Fleet-wide, over trips started between the two timestamps (ns). Rollup
+    // sketches answer at day granularity; without them the trip columns are
+    // sketched on the spot.
+    TripDistribution get_fleet_distribution(uint64_t start_time = 0, uint64_t end_time = UINT64_MAX)
+    {
+        if (rollups_)
+        {
+            return to_trip_distribution(rollups_->query_fleet(start_time, end_time));
         }
 
+        FleetSketch sketch;
+        db_.columns().trips().for_each_finished(
+            [&](uint64_t driver_id, uint64_t vehicle_id, uint64_t start, uint32_t duration, double distance)
+            {
+                if (start >= start_time && start <= end_time)
+                    sketch.add(driver_id, vehicle_id, duration, distance);
+            });
+        return to_trip_distribution(sketch);
+    }
+
+    // ========================================================================
+    // HELPER FUNCTIONS
+    // ========================================================================
+
+private:
+    TripStatistics to_trip_statistics(const SegmentStats &rollup)
+    {
+        TripStatistics stats = {};
+        stats.total_trips = rollup.trip_count;
+        stats.total_distance = rollup.total_distance;
+        stats.total_duration = rollup.total_duration;
+        stats.max_speed = rollup.max_speed;
+        stats.total_fuel = rollup.total_fuel;
+        stats.total_harsh_events = rollup.harsh_braking_events +
+                                   rollup.rapid_acceleration_events +
+                                   rollup.speeding_violations +
+                                   rollup.sharp_turn_events;
+        finish_statistics(stats);
+        return stats;
+    }
+
+    TripStatistics to_trip_statistics(const TripColumnTotals &totals)
+    {
+        TripStatistics stats = {};
+        stats.total_trips = totals.trips;
+        stats.total_distance = totals.distance;
+        stats.total_duration = totals.duration;
+        stats.max_speed = totals.max_speed;
+        stats.total_fuel = totals.fuel;
+        stats.total_harsh_events = totals.harsh_braking + totals.rapid_acceleration +
+                                   totals.speeding + totals.sharp_turns;
+        finish_statistics(stats);
+        return stats;
+    }
+
+    TripDistribution to_trip_distribution(const FleetSketch &sketch)
+    {
+        TripDistribution dist = {};
+        dist.total_trips = sketch.duration.count();
+        if (dist.total_trips == 0)
+            return dist;
+
+        dist.speed_p50 = sketch.speed.quantile(0.50);
+        dist.speed_p95 = sketch.speed.quantile(0.95);
+        dist.duration_p50 = sketch.duration.quantile(0.50);
+        dist.duration_p95 = sketch.duration.quantile(0.95);
+        dist.active_drivers = (uint64_t)llround(sketch.drivers.estimate());
+        dist.active_vehicles = (uint64_t)llround(sketch.vehicles.estimate());
+        return dist;
+    }
+
+    void finish_statistics(TripStatistics &stats)
+    {
         if (stats.total_trips > 0 && stats.total_duration > 0)
         {
             stats.avg_speed = (stats.total_distance / stats.total_duration) * 3600;
@@ -404,52 +687,271 @@ public:
 
         // Calculate safety score (0-1000)
         stats.safety_score = calculate_safety_score(stats);
-
-        return stats;
     }
 
-    // ========================================================================
-    // HELPER FUNCTIONS
-    // ========================================================================
+    // Caller holds ingest_mtx_
+    size_t drain_gps_buffer()
+    {
+        size_t total = 0;
 
-private:
-    uint64_t generate_trip_id()
+        uint64_t depth = gps_buffer_.size();
+        if (depth > queue_high_water_.load())
+        {
+            queue_high_water_ = depth;
+        }
+
+        while (true)
+        {
+            batch_.clear();
+            if (gps_buffer_.try_dequeue_batch(batch_, GPS_BATCH_SIZE) == 0)
+            {
+                break;
+            }
+
+            total += batch_.size();
+            process_gps_batch();
+        }
+
+        return total;
+    }
+
+    // Groups batch_ by trip, appends it to the GPS log with one write, then
+    // runs event detection per trip, applies safety score changes once per
+    // driver and feeds the positions to the geofences
+    void process_gps_batch()
     {
-        static uint64_t counter = 1;
-        return counter++;
+        // Points for trips that are no longer active are dropped before they
+        // reach the log. Trips only end under ingest_mtx_, which the caller
+        // holds, so none can end while the batch is applied.
+        size_t queued = batch_.size();
+        {
+            std::lock_guard<std::mutex> lock(trips_mtx_);
+            batch_.erase(std::remove_if(batch_.begin(), batch_.end(),
+                                        [this](const GPSDataPoint &point)
+                                        { return active_trips_.find(point.trip_id) == active_trips_.end(); }),
+                         batch_.end());
+        }
+        points_dropped_ += queued - batch_.size();
+        if (batch_.empty())
+        {
+            return;
+        }
+
+        // Stable sort keeps each trip's points in arrival order
+        std::stable_sort(batch_.begin(), batch_.end(),
+                         [](const GPSDataPoint &a, const GPSDataPoint &b)
+                         { return a.trip_id < b.trip_id; });
+
+        log_entries_.resize(batch_.size());
+        for (size_t i = 0; i < batch_.size(); i++)
+        {
+            GPSLogEntry &entry = log_entries_[i];
+            entry.trip_id = batch_[i].trip_id;
+            entry.waypoint.timestamp = batch_[i].timestamp;
+            entry.waypoint.latitude = batch_[i].latitude;
+            entry.waypoint.longitude = batch_[i].longitude;
+            entry.waypoint.speed = batch_[i].speed;
+            entry.waypoint.altitude = batch_[i].altitude;
+            entry.waypoint.accuracy = batch_[i].accuracy;
+            entry.waypoint.satellites = batch_[i].satellites;
+        }
+
+        uint64_t first_offset = 0;
+        if (!gps_log_.append(log_entries_, first_offset))
+        {
+            points_dropped_ += batch_.size();
+            return;
+        }
+
+        std::unordered_map<uint64_t, int> score_deltas;
+        batch_vehicle_.assign(batch_.size(), 0);
+        harsh_points_.clear();
+        size_t applied = 0;
+        uint64_t latency_sum = 0;
+        uint64_t latency_max = 0;
+        uint64_t now = get_current_timestamp();
+        {
+            std::lock_guard<std::mutex> lock(trips_mtx_);
+
+            size_t run_start = 0;
+            while (run_start < batch_.size())
+            {
+                uint64_t trip_id = batch_[run_start].trip_id;
+                size_t run_end = run_start + 1;
+                while (run_end < batch_.size() && batch_[run_end].trip_id == trip_id)
+                {
+                    run_end++;
+                }
+
+                auto it = active_trips_.find(trip_id);
+                if (it != active_trips_.end())
+                {
+                    ActiveTrip &trip = it->second;
+                    if (trip.waypoints.empty())
+                    {
+                        trip.record.gps_data_offset = first_offset + run_start * sizeof(GPSLogEntry);
+                    }
+                    trip.record.gps_data_end_offset = first_offset + run_end * sizeof(GPSLogEntry);
+
+                    int delta = apply_gps_run(trip, run_start, run_end);
+                    if (delta != 0)
+                    {
+                        score_deltas[trip.record.driver_id] += delta;
+                    }
+                    applied += run_end - run_start;
+                    std::fill(batch_vehicle_.begin() + run_start, batch_vehicle_.begin() + run_end,
+                              trip.record.vehicle_id);
+
+                    for (size_t i = run_start; i < run_end; i++)
+                    {
+                        uint64_t latency = now > batch_[i].timestamp ? now - batch_[i].timestamp : 0;
+                        latency_sum += latency;
+                        if (latency > latency_max)
+                            latency_max = latency;
+                    }
+                }
+
+                run_start = run_end;
+            }
+        }
+
+        for (const auto &entry : score_deltas)
+        {
+            update_driver_safety_score(entry.first, entry.second);
+        }
+
+        for (const auto &point : harsh_points_)
+        {
+            index_.insert_spatial(SpatialKind::HARSH_EVENT, point.trip_id,
+                                  point.waypoint.latitude, point.waypoint.longitude);
+        }
+
+        if (geofences_)
+        {
+            for (size_t i = 0; i < batch_.size(); i++)
+            {
+                if (batch_vehicle_[i] != 0)
+                {
+                    const GPSWaypoint &wp = log_entries_[i].waypoint;
+                    geofences_->update_position(batch_vehicle_[i], wp.latitude, wp.longitude,
+                                                wp.timestamp);
+                }
+            }
+        }
+
+        points_ingested_ += applied;
+        latency_sum_ns_ += latency_sum;
+        if (latency_max > latency_max_ns_.load())
+        {
+            latency_max_ns_ = latency_max;
+        }
+        points_dropped_ += batch_.size() - applied;
+        batches_written_++;
+        if (batch_.size() > largest_batch_.load())
+        {
+            largest_batch_ = batch_.size();
+        }
     }
 
-    uint64_t get_current_timestamp()
+    // Appends log_entries_[begin, end) to the trip and detects driving events
+    // across them; returns the safety score change
+    int apply_gps_run(ActiveTrip &trip, size_t begin, size_t end)
     {
-        return std::chrono::system_clock::now().time_since_epoch().count();
+        // Bearings for the run (plus the segment from the previous point) in
+        // one kernel call
+        bool has_previous = !trip.waypoints.empty();
+        batch_lat_.clear();
+        batch_lon_.clear();
+        if (has_previous)
+        {
+            batch_lat_.push_back(trip.waypoints.back().latitude);
+            batch_lon_.push_back(trip.waypoints.back().longitude);
+        }
+        for (size_t i = begin; i < end; i++)
+        {
+            batch_lat_.push_back(log_entries_[i].waypoint.latitude);
+            batch_lon_.push_back(log_entries_[i].waypoint.longitude);
+        }
+        batch_bearing_.resize(batch_lat_.size());
+        GeoMath::segment_bearings_deg(batch_lat_.data(), batch_lon_.data(),
+                                      batch_lat_.size(), batch_bearing_.data());
+
+        int delta = 0;
+        size_t segment = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            const GPSWaypoint &current = log_entries_[i].waypoint;
+            if (!trip.waypoints.empty())
+            {
+                delta += detect_driving_events(trip, trip.waypoints.back(), current,
+                                               batch_bearing_[segment++]);
+            }
+            trip.waypoints.push_back(current);
+        }
+
+        return delta;
     }
 
-    // Haversine formula for distance calculation
-    double calculate_distance(double lat1, double lon1, double lat2, double lon2)
+    int detect_driving_events(ActiveTrip &trip, const GPSWaypoint &previous,
+                              const GPSWaypoint &current, double heading)
     {
-        double dLat = (lat2 - lat1) * M_PI / 180.0;
-        double dLon = (lon2 - lon1) * M_PI / 180.0;
+        int delta = 0;
+        bool harsh = false;
+
+        double time_diff = (current.timestamp - previous.timestamp) / 1000000000.0;
+        if (time_diff <= 0)
+            return 0;
 
-        lat1 = lat1 * M_PI / 180.0;
-        lat2 = lat2 * M_PI / 180.0;
+        double speed_diff = current.speed - previous.speed;
+        double acceleration = (speed_diff / 3.6) / time_diff;
 
-        double a = sin(dLat / 2) * sin(dLat / 2) +
-                   sin(dLon / 2) * sin(dLon / 2) * cos(lat1) * cos(lat2);
-        double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+        if (acceleration < HARSH_BRAKING_THRESHOLD)
+        {
+            trip.record.harsh_braking_count++;
+            delta -= 5;
+            harsh = true;
+        }
 
-        return EARTH_RADIUS_KM * c;
+        if (acceleration > RAPID_ACCELERATION_THRESHOLD)
+        {
+            trip.record.rapid_acceleration_count++;
+            delta -= 3;
+            harsh = true;
+        }
+
+        if (current.speed > SPEEDING_THRESHOLD)
+        {
+            trip.record.speeding_count++;
+            delta -= 10;
+            harsh = true;
+        }
+
+        if (abs(heading) > 30 && current.speed > 20)
+        {
+            trip.record.sharp_turn_count++;
+            delta -= 2;
+        }
+
+        // Located for hotspot queries (sharp turns are not counted as harsh)
+        if (harsh)
+        {
+            GPSLogEntry point;
+            point.trip_id = trip.trip_id;
+            point.waypoint = current;
+            harsh_points_.push_back(point);
+        }
+
+        return delta;
     }
 
-    double calculate_heading_change(const GPSWaypoint &p1, const GPSWaypoint &p2)
+    uint64_t generate_trip_id()
     {
-        double dLon = (p2.longitude - p1.longitude) * M_PI / 180.0;
-        double lat1 = p1.latitude * M_PI / 180.0;
-        double lat2 = p2.latitude * M_PI / 180.0;
-
-        double y = sin(dLon) * cos(lat2);
-        double x = cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(dLon);
+        return db_.next_id(IdSpace::TRIP);
+    }
 
-        return atan2(y, x) * 180.0 / M_PI;
+    uint64_t get_current_timestamp()
+    {
+        return std::chrono::system_clock::now().time_since_epoch().count();
     }
 
     double estimate_fuel_consumption(const TripRecord &trip)
@@ -487,24 +989,29 @@ private:
     void update_driver_stats(const TripRecord &trip)
     {
         DriverProfile driver;
-        if (db_.read_driver(trip.driver_id, driver))
-        {
-            driver.total_trips++;
-            driver.total_distance += trip.distance;
-            driver.total_fuel_consumed += trip.fuel_consumed;
-            driver.harsh_events_count += trip.harsh_braking_count +
-                                         trip.rapid_acceleration_count +
-                                         trip.speeding_count;
+        bool updated = db_.modify_driver(trip.driver_id, [&](DriverProfile &d)
+                                         {
+            d.total_trips++;
+            d.total_distance += trip.distance;
+            d.total_fuel_consumed += trip.fuel_consumed;
+            d.harsh_events_count += trip.harsh_braking_count +
+                                    trip.rapid_acceleration_count +
+                                    trip.speeding_count;
 
             // Recalculate safety score
             TripStatistics stats;
-            stats.total_trips = driver.total_trips;
-            stats.total_distance = driver.total_distance;
-            stats.total_harsh_events = driver.harsh_events_count;
-            driver.safety_score = calculate_safety_score(stats);
+            stats.total_trips = d.total_trips;
+            stats.total_distance = d.total_distance;
+            stats.total_harsh_events = d.harsh_events_count;
+            d.safety_score = calculate_safety_score(stats); }, driver);
 
-            db_.update_driver(driver);
+        if (updated)
+        {
             cache_.invalidate_driver(trip.driver_id);
+            if (leaderboard_)
+            {
+                leaderboard_->update(driver);
+            }
         }
     }
 };
@@ -5,10 +5,19 @@
 #include "../../source/core/DatabaseManager.h"
 #include "../../source/core/CacheManager.h"
 #include "../../source/core/IndexManager.h"
+#include "../../source/core/ExpiryIndex.h"
+#include "../../source/core/LastServiceTable.h"
 #include "../../source/data_structures/MinHeap.h"
+#include "../../source/data_structures/IndexedDaryHeap.h"
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <algorithm>
 
 class VehicleManager
 {
@@ -16,16 +25,52 @@ private:
     DatabaseManager &db_;
     CacheManager &cache_;
     IndexManager &index_;
-    set<string> processed_alerts_;
-    // Maintenance alert priority queue
-    MaintenanceAlertQueue alert_queue_;
+    ExpiryIndex *expiry_;
+    LastServiceTable last_service_;
+    // Shared while vehicles are evaluated, exclusive to record or forget
+    std::shared_timed_mutex last_service_mtx_;
+    // Alerts keyed by alert_key(vehicle, type), so one can be re-prioritised
+    // or dropped without draining the queue
+    IndexedDaryHeap<uint64_t, MaintenanceAlert> alert_queue_;
+    unordered_map<uint64_t, uint64_t> alert_keys_; // alert_id -> key
+    // Keys raised since the last refresh, including acknowledged ones
+    unordered_set<uint64_t> processed_alerts_;
+
+    static constexpr uint64_t INITIAL_ALERT = 15; // type slot of the first-service alert
+
+    static uint64_t alert_key(uint64_t vehicle_id, uint64_t type_slot)
+    {
+        return (vehicle_id << 4) | type_slot;
+    }
+
+    static uint64_t alert_key(uint64_t vehicle_id, MaintenanceType type)
+    {
+        return alert_key(vehicle_id, static_cast<uint64_t>(type));
+    }
+
+    void raise_alert(uint64_t key, const MaintenanceAlert &alert)
+    {
+        alert_queue_.push(key, alert);
+        alert_keys_[alert.alert_id] = key;
+        processed_alerts_.insert(key);
+    }
+
+    void drop_alert(uint64_t key)
+    {
+        const MaintenanceAlert *alert = alert_queue_.find(key);
+        if (alert)
+        {
+            alert_keys_.erase(alert->alert_id);
+            alert_queue_.remove(key);
+        }
+    }
 
     // Alert priority calculation
     uint32_t calculate_alert_priority(const VehicleInfo &vehicle,
-                                      const MaintenanceRecord &last_service,
-                                      MaintenanceType type)
+                                      const LastService &last_service,
+                                      MaintenanceType type,
+                                      uint64_t current_time)
     {
-        uint64_t current_time = get_current_timestamp();
 
         // Days since last service
         uint64_t days_overdue = 0;
@@ -67,106 +112,232 @@ private:
     }
     void clear_maintenance_alerts_for_vehicle_and_type(uint64_t vehicle_id, MaintenanceType type)
     {
-        std::string alert_key = std::to_string(vehicle_id) + "_" +
-                                std::to_string(static_cast<int>(type));
-        processed_alerts_.erase(alert_key);
+        uint64_t key = alert_key(vehicle_id, type);
+        processed_alerts_.erase(key);
+        drop_alert(key);
+    }
 
-        // Rebuild alert queue without this type
-        auto all_alerts = alert_queue_.get_top_k(1000);
+public:
+    struct MaintenanceDue
+    {
+        enum State : uint8_t
+        {
+            OK = 0,
+            DUE_SOON = 1, // within a week or 500 km
+            OVERDUE = 2
+        };
+
+        uint64_t vehicle_id;
+        MaintenanceType type;
+        bool initial; // never serviced; type is meaningless
+        State state;
+        int64_t days_until_due; // negative when overdue
+        double km_until_due;
+        uint64_t next_service_date;
+        uint32_t priority; // alert priority when overdue (lower = more urgent)
+    };
 
-        while (!alert_queue_.empty())
+private:
+    static constexpr uint64_t NANOS_PER_DAY = 86400ULL * 1000000000ULL;
+    static constexpr uint64_t DUE_SOON_DAYS = 7;
+    static constexpr double DUE_SOON_KM = 500;
+
+    // Due status of each tracked type, or a single `initial` entry if the
+    // vehicle was never serviced. Reads only; safe to run in parallel.
+    void evaluate_vehicle(const VehicleInfo &vehicle, uint64_t current_time,
+                          std::vector<MaintenanceDue> &out)
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(last_service_mtx_);
+        const VehicleServices *services = last_service_.find(vehicle.vehicle_id);
+        if (!services)
         {
-            alert_queue_.extract_min();
+            MaintenanceDue due = {};
+            due.vehicle_id = vehicle.vehicle_id;
+            due.initial = true;
+            due.state = MaintenanceDue::OVERDUE;
+            due.priority = 500;
+            out.push_back(due);
+            return;
         }
 
-        std::string type_string = get_maintenance_type_string(type);
-        for (const auto &alert : all_alerts)
+        MaintenanceType types[] = {
+            MaintenanceType::OIL_CHANGE,
+            MaintenanceType::BRAKE_SERVICE,
+            MaintenanceType::TIRE_ROTATION,
+            MaintenanceType::ENGINE_CHECK};
+
+        for (auto type : types)
         {
-            if (!(alert.vehicle_id == vehicle_id &&
-                  std::string(alert.description).find(type_string) != std::string::npos))
+            const LastService &last = services->by_type[(int)type];
+
+            MaintenanceDue due = {};
+            due.vehicle_id = vehicle.vehicle_id;
+            due.type = type;
+            due.next_service_date = last.next_service_date;
+            due.state = MaintenanceDue::OK;
+
+            if (last.maintenance_id != 0 && last.next_service_date > 0)
             {
-                alert_queue_.insert(alert);
+                due.days_until_due = ((int64_t)last.next_service_date - (int64_t)current_time) / (int64_t)NANOS_PER_DAY;
+                due.km_until_due = last.next_service_odometer - vehicle.current_odometer;
+
+                if (current_time >= last.next_service_date || due.km_until_due <= 0)
+                {
+                    due.state = MaintenanceDue::OVERDUE;
+                    due.priority = calculate_alert_priority(vehicle, last, type, current_time);
+                }
+                else if (due.days_until_due < (int64_t)DUE_SOON_DAYS || due.km_until_due < DUE_SOON_KM)
+                {
+                    due.state = MaintenanceDue::DUE_SOON;
+                }
             }
+
+            out.push_back(due);
         }
     }
 
-public:
-    void check_maintenance_alerts(const VehicleInfo &vehicle)
+    // Raises, re-prioritises or drops the alert for one evaluated entry
+    void apply_due(const MaintenanceDue &due, uint64_t current_time)
     {
-        auto maintenance_history = get_vehicle_maintenance_history(vehicle.vehicle_id);
-
-        if (maintenance_history.empty())
+        if (due.initial)
         {
-            std::string alert_key = std::to_string(vehicle.vehicle_id) + "_initial";
-
-            if (processed_alerts_.find(alert_key) == processed_alerts_.end())
+            uint64_t key = alert_key(due.vehicle_id, INITIAL_ALERT);
+            if (processed_alerts_.find(key) == processed_alerts_.end())
             {
                 MaintenanceAlert alert(
-                    vehicle.vehicle_id,
+                    due.vehicle_id,
                     generate_alert_id(),
-                    500,
-                    get_current_timestamp(),
+                    due.priority,
+                    current_time,
                     "Initial maintenance check required",
                     2);
-                alert_queue_.insert(alert);
-                processed_alerts_.insert(alert_key);
+                raise_alert(key, alert);
             }
             return;
         }
 
-        MaintenanceType types[] = {
-            MaintenanceType::OIL_CHANGE,
-            MaintenanceType::BRAKE_SERVICE,
-            MaintenanceType::TIRE_ROTATION,
-            MaintenanceType::ENGINE_CHECK};
+        uint64_t key = alert_key(due.vehicle_id, due.type);
+        if (due.state != MaintenanceDue::OVERDUE)
+        {
+            drop_alert(key);
+            return;
+        }
 
-        for (auto type : types)
+        // Still pending: only its urgency can have changed
+        const MaintenanceAlert *pending = alert_queue_.find(key);
+        if (pending)
         {
-            MaintenanceRecord *last_service = nullptr;
-            for (auto &record : maintenance_history)
+            if (pending->priority != due.priority)
             {
-                if (record.type == type)
-                {
-                    if (!last_service || record.service_date > last_service->service_date)
-                    {
-                        last_service = &record;
-                    }
-                }
+                MaintenanceAlert updated = *pending;
+                updated.priority = due.priority;
+                alert_queue_.push(key, updated);
             }
+            return;
+        }
 
-            if (last_service && last_service->next_service_date > 0)
-            {
-                uint64_t current_time = get_current_timestamp();
+        if (processed_alerts_.find(key) == processed_alerts_.end())
+        {
+            std::string desc = get_maintenance_type_string(due.type) + " is due";
 
-                if (current_time >= last_service->next_service_date ||
-                    vehicle.current_odometer >= last_service->next_service_odometer)
+            MaintenanceAlert alert(
+                due.vehicle_id,
+                generate_alert_id(),
+                due.priority,
+                due.next_service_date,
+                desc,
+                get_maintenance_severity(due.type));
+
+            raise_alert(key, alert);
+        }
+    }
+
+public:
+    void check_maintenance_alerts(const VehicleInfo &vehicle)
+    {
+        uint64_t current_time = get_current_timestamp();
+
+        std::vector<MaintenanceDue> statuses;
+        evaluate_vehicle(vehicle, current_time, statuses);
+
+        if (!statuses.empty() && !statuses[0].initial)
+        {
+            drop_alert(alert_key(vehicle.vehicle_id, INITIAL_ALERT));
+        }
+        for (const auto &due : statuses)
+        {
+            apply_due(due, current_time);
+        }
+    }
+
+    // Due status for the whole fleet: one sequential read of the vehicle
+    // table, then vehicle ranges evaluated in parallel against the
+    // last-service table. threads = 0 uses the hardware concurrency.
+    std::vector<MaintenanceDue> compute_fleet_maintenance_due(unsigned threads = 0)
+    {
+        std::vector<VehicleInfo> vehicles;
+        db_.for_each_vehicle([&](const VehicleInfo &vehicle)
+                             { vehicles.push_back(vehicle); });
+
+        uint64_t current_time = get_current_timestamp();
+
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t per_thread = 4096;
+        threads = (unsigned)std::min<size_t>(threads, (vehicles.size() + per_thread - 1) / per_thread);
+        threads = std::max(1u, threads);
+
+        std::vector<std::vector<MaintenanceDue>> parts(threads);
+        std::vector<std::thread> workers;
+        size_t chunk = (vehicles.size() + threads - 1) / threads;
+
+        for (unsigned t = 0; t < threads; t++)
+        {
+            size_t first = t * chunk;
+            size_t last = std::min(vehicles.size(), first + chunk);
+            auto work = [&, t, first, last]()
+            {
+                for (size_t i = first; i < last; i++)
                 {
-                    std::string alert_key = std::to_string(vehicle.vehicle_id) + "_" +
-                                            std::to_string(static_cast<int>(type));
-
-                    if (processed_alerts_.find(alert_key) == processed_alerts_.end())
-                    {
-                        uint32_t priority = calculate_alert_priority(vehicle, *last_service, type);
-                        std::string desc = get_maintenance_type_string(type) + " is due";
-
-                        MaintenanceAlert alert(
-                            vehicle.vehicle_id,
-                            generate_alert_id(),
-                            priority,
-                            last_service->next_service_date,
-                            desc,
-                            get_maintenance_severity(type));
-
-                        alert_queue_.insert(alert);
-                        processed_alerts_.insert(alert_key);
-                    }
+                    evaluate_vehicle(vehicles[i], current_time, parts[t]);
                 }
+            };
+
+            if (t + 1 == threads)
+            {
+                work(); // the caller takes the last range
             }
+            else
+            {
+                workers.emplace_back(work);
+            }
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
         }
+
+        std::vector<MaintenanceDue> result;
+        for (const auto &part : parts)
+        {
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
     }
 
     VehicleManager(DatabaseManager &db, CacheManager &cache, IndexManager &index)
-        : db_(db), cache_(cache), index_(index) {}
+        : db_(db), cache_(cache), index_(index), expiry_(nullptr)
+    {
+        last_service_.rebuild(db_);
+    }
+
+    // Insurance and registration dates are written through to this index
+    void set_expiry_index(ExpiryIndex *expiry)
+    {
+        expiry_ = expiry;
+    }
 
     // ========================================================================
     // VEHICLE OPERATIONS
@@ -189,6 +360,10 @@ public:
 
         // Generate vehicle ID
         uint64_t vehicle_id = generate_vehicle_id();
+        if (vehicle_id == 0)
+        {
+            return 0;
+        }
 
         // Create vehicle
         VehicleInfo vehicle;
@@ -215,6 +390,10 @@ public:
 
         // Cache it
         cache_.put_vehicle(vehicle_id, vehicle);
+        if (expiry_)
+        {
+            expiry_->set_vehicle(vehicle);
+        }
 
         return vehicle_id;
     }
@@ -227,6 +406,10 @@ public:
         }
 
         cache_.put_vehicle(vehicle.vehicle_id, vehicle, true);
+        if (expiry_)
+        {
+            expiry_->set_vehicle(vehicle);
+        }
         return true;
     }
 
@@ -238,6 +421,14 @@ public:
         }
 
         cache_.invalidate_vehicle(vehicle_id);
+        if (expiry_)
+        {
+            expiry_->remove_vehicle(vehicle_id);
+        }
+        {
+            std::lock_guard<std::shared_timed_mutex> lock(last_service_mtx_);
+            last_service_.forget(vehicle_id);
+        }
         return true;
     }
 
@@ -303,11 +494,8 @@ public:
     void refresh_all_alerts()
     {
         processed_alerts_.clear();
-
-        while (!alert_queue_.empty())
-        {
-            alert_queue_.extract_min();
-        }
+        alert_queue_.clear();
+        alert_keys_.clear();
     }
     uint64_t add_maintenance_record(uint64_t vehicle_id,
                                     uint64_t driver_id,
@@ -318,6 +506,10 @@ public:
                                     double total_cost)
     {
         uint64_t maintenance_id = generate_maintenance_id();
+        if (maintenance_id == 0)
+        {
+            return 0;
+        }
 
         MaintenanceRecord record;
         record.maintenance_id = maintenance_id;
@@ -336,6 +528,10 @@ public:
         {
             return 0;
         }
+        {
+            std::lock_guard<std::shared_timed_mutex> lock(last_service_mtx_);
+            last_service_.record_service(record);
+        }
 
         VehicleInfo vehicle;
         if (get_vehicle(vehicle_id, vehicle))
@@ -362,20 +558,18 @@ public:
     // MAINTENANCE ALERTS
     // ========================================================================
 
+    // Re-evaluates every vehicle in place: pending alerts are re-prioritised
+    // or dropped, new ones raised, acknowledged ones stay quiet
     void refresh_maintenance_alerts()
     {
-        alert_queue_.clear();
-
-        // Get all vehicles
-        auto all_drivers = db_.get_all_drivers();
-        for (const auto &driver : all_drivers)
+        uint64_t current_time = get_current_timestamp();
+        for (const auto &due : compute_fleet_maintenance_due())
         {
-            auto vehicles = get_driver_vehicles(driver.driver_id);
-
-            for (const auto &vehicle : vehicles)
+            if (!due.initial)
             {
-                check_maintenance_alerts(vehicle);
+                drop_alert(alert_key(due.vehicle_id, INITIAL_ALERT));
             }
+            apply_due(due, current_time);
         }
     }
 
@@ -393,17 +587,14 @@ public:
         return alert_queue_.peek();
     }
 
+    // Removes the alert; it is not raised again until the next full refresh
+    // or a new service record for that type
     void acknowledge_alert(uint64_t alert_id)
     {
-        // Would remove from queue by ID
-        // Simplified: just extract if it's at top
-        if (!alert_queue_.empty())
+        auto it = alert_keys_.find(alert_id);
+        if (it != alert_keys_.end())
         {
-            auto top = alert_queue_.peek();
-            if (top.alert_id == alert_id)
-            {
-                alert_queue_.extract_min();
-            }
+            drop_alert(it->second);
         }
     }
 
@@ -414,20 +605,17 @@ public:
 private:
     uint64_t generate_vehicle_id()
     {
-        static uint64_t counter = 1;
-        return counter++;
+        return db_.next_id(IdSpace::VEHICLE);
     }
 
     uint64_t generate_maintenance_id()
     {
-        static uint64_t counter = 1;
-        return counter++;
+        return db_.next_id(IdSpace::MAINTENANCE);
     }
 
     uint64_t generate_alert_id()
     {
-        static uint64_t counter = 1;
-        return counter++;
+        return db_.next_id(IdSpace::ALERT);
     }
 
     uint64_t get_current_timestamp()
@@ -217,7 +217,8 @@ private:
             }
         }
 
-        child.key_count = BPlusNode::MIN_KEYS;
+        // A leaf keeps the separator key; only internal nodes move it up
+        child.key_count = child.is_leaf() ? BPlusNode::MIN_KEYS + 1 : BPlusNode::MIN_KEYS;
 
         for (int i = parent.key_count; i > index; i--)
         {
@@ -353,6 +354,9 @@ public:
         file_.write(reinterpret_cast<char *>(&metadata_), sizeof(BPlusMetadata));
         file_.flush();
 
+        // Opened write-only above; open() reopens it for reading and writing
+        file_.close();
+
         cout << "          Created successfully" << endl;
         return true;
     }
@@ -440,6 +444,38 @@ public:
         return search_recursive(metadata_.root_offset, key, result);
     }
 
+    // Entries with lo <= key < hi, in key order
+    vector<pair<BPlusKey, BPlusValue>> range_scan(const BPlusKey &lo, const BPlusKey &hi)
+    {
+        vector<pair<BPlusKey, BPlusValue>> results;
+
+        uint64_t current = metadata_.root_offset;
+        BPlusNode node;
+        while (read_node(current, node) && !node.is_leaf())
+        {
+            current = node.child_offsets[find_key_position(node, lo)];
+        }
+
+        while (current != 0)
+        {
+            if (!read_node(current, node))
+                break;
+
+            for (int i = 0; i < node.key_count; i++)
+            {
+                if (node.keys[i] < lo)
+                    continue;
+                if (node.keys[i] >= hi)
+                    return results;
+                results.push_back({node.keys[i], node.values[i]});
+            }
+
+            current = node.next_leaf;
+        }
+
+        return results;
+    }
+
     vector<pair<BPlusKey, BPlusValue>> scan_all()
     {
         vector<pair<BPlusKey, BPlusValue>> results;
@@ -403,6 +403,40 @@ private:
     }
 
     
+    // Leaves are not merged on underflow; an emptied leaf stays in the
+    // sibling chain and range queries step over it
+    bool remove_recursive(uint64_t node_offset, const CompositeKey &key)
+    {
+        if (node_offset == 0)
+            return false;
+
+        BTreeNode node;
+        if (!read_node(node_offset, node))
+            return false;
+
+        int pos = find_key_position(node, key);
+
+        if (!node.is_leaf())
+        {
+            if (pos < node.key_count && node.keys[pos] == key)
+                pos++;
+            return remove_recursive(node.child_offsets[pos], key);
+        }
+
+        if (pos >= node.key_count || !(node.keys[pos] == key))
+            return false;
+
+        for (int i = pos; i < node.key_count - 1; i++)
+        {
+            node.keys[i] = node.keys[i + 1];
+            node.values[i] = node.values[i + 1];
+        }
+        node.key_count--;
+
+        return write_node(node_offset, node);
+    }
+
+    
     void range_query_recursive(uint64_t node_offset,
                                const CompositeKey &start_key,
                                const CompositeKey &end_key,
@@ -427,7 +461,7 @@ private:
             }
 
             
-            if (node.key_count > 0 && node.keys[node.key_count - 1] < end_key && node.next_leaf != 0)
+            if ((node.key_count == 0 || node.keys[node.key_count - 1] < end_key) && node.next_leaf != 0)
             {
                 range_query_recursive(node.next_leaf, start_key, end_key, results);
             }
@@ -513,6 +547,8 @@ public:
         file_.write(reinterpret_cast<char *>(&metadata_), sizeof(BTreeMetadata));
         file_.flush();
 
+        // Opened write-only above; open() reopens it for reading and writing
+        file_.close();
 
         cout << "        BTree file created successfully" << endl;
         return true;
@@ -621,6 +657,15 @@ public:
         return search_recursive(metadata_.root_offset, key, result);
     }
 
+    bool remove(const CompositeKey &key)
+    {
+        if (!remove_recursive(metadata_.root_offset, key))
+            return false;
+
+        metadata_.total_records--;
+        return true;
+    }
+
     vector<pair<CompositeKey, BTreeValue>> range_query(
         const CompositeKey &start_key, const CompositeKey &end_key)
     {
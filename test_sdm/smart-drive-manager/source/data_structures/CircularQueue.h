@@ -126,6 +126,31 @@ public:
         return true;
     }
 
+    // Moves up to max_items onto the end of out under a single lock
+    size_t try_dequeue_batch(vector<T> &out, size_t max_items)
+    {
+        unique_lock<mutex> lock(mtx_);
+
+        size_t count = (size_t)size_.load();
+        if (count > max_items)
+        {
+            count = max_items;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            out.push_back(buffer_[head_]);
+            head_ = (head_ + 1) % capacity_;
+        }
+        size_ -= (int)count;
+
+        if (count > 0)
+        {
+            not_full_.notify_all();
+        }
+        return count;
+    }
+
     bool peek(T &item) const
     {
         unique_lock<mutex> lock(mtx_);
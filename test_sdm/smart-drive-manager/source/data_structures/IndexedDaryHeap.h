@@ -0,0 +1,230 @@
+#ifndef INDEXEDDARYHEAP_H
+#define INDEXEDDARYHEAP_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+using namespace std;
+
+// d-ary min-heap whose entries are addressed by a unique key. A handle map
+// (key -> heap position) makes update, decrease-key and remove O(log n)
+// instead of a drain and rebuild. A fan-out of 4 keeps sift-down shallow and
+// the children of a node on one cache line for small values.
+template <typename Key, typename T, int D = 4, typename Compare = less<T>>
+class IndexedDaryHeap
+{
+private:
+    vector<pair<Key, T>> heap_;
+    unordered_map<Key, size_t> position_;
+    Compare comp_;
+
+    static size_t parent(size_t i) { return (i - 1) / D; }
+    static size_t first_child(size_t i) { return D * i + 1; }
+
+    void place(size_t index, pair<Key, T> &&entry)
+    {
+        position_[entry.first] = index;
+        heap_[index] = move(entry);
+    }
+
+    void sift_up(size_t index)
+    {
+        pair<Key, T> entry = move(heap_[index]);
+        while (index > 0 && comp_(entry.second, heap_[parent(index)].second))
+        {
+            size_t up = parent(index);
+            place(index, move(heap_[up]));
+            index = up;
+        }
+        place(index, move(entry));
+    }
+
+    void sift_down(size_t index)
+    {
+        size_t size = heap_.size();
+        pair<Key, T> entry = move(heap_[index]);
+
+        while (true)
+        {
+            size_t child = first_child(index);
+            if (child >= size)
+                break;
+
+            size_t last = child + D < size ? child + D : size;
+            size_t best = child;
+            for (size_t c = child + 1; c < last; c++)
+            {
+                if (comp_(heap_[c].second, heap_[best].second))
+                    best = c;
+            }
+
+            if (!comp_(heap_[best].second, entry.second))
+                break;
+
+            place(index, move(heap_[best]));
+            index = best;
+        }
+        place(index, move(entry));
+    }
+
+    // Removes the entry at index, filling the hole with the last entry
+    void remove_at(size_t index)
+    {
+        position_.erase(heap_[index].first);
+
+        if (index == heap_.size() - 1)
+        {
+            heap_.pop_back();
+            return;
+        }
+
+        heap_[index] = move(heap_.back());
+        heap_.pop_back();
+        position_[heap_[index].first] = index;
+
+        if (index > 0 && comp_(heap_[index].second, heap_[parent(index)].second))
+            sift_up(index);
+        else
+            sift_down(index);
+    }
+
+public:
+    IndexedDaryHeap() = default;
+
+    // Inserts, or replaces the value of an existing key and restores order
+    // in whichever direction it moved
+    void push(const Key &key, const T &value)
+    {
+        auto it = position_.find(key);
+        if (it == position_.end())
+        {
+            heap_.emplace_back(key, value);
+            position_[key] = heap_.size() - 1;
+            sift_up(heap_.size() - 1);
+            return;
+        }
+
+        size_t index = it->second;
+        bool moved_up = comp_(value, heap_[index].second);
+        heap_[index].second = value;
+        if (moved_up)
+            sift_up(index);
+        else
+            sift_down(index);
+    }
+
+    // Only applies the new value if it orders before the current one
+    bool decrease_key(const Key &key, const T &value)
+    {
+        auto it = position_.find(key);
+        if (it == position_.end() || !comp_(value, heap_[it->second].second))
+            return false;
+
+        heap_[it->second].second = value;
+        sift_up(it->second);
+        return true;
+    }
+
+    bool remove(const Key &key)
+    {
+        auto it = position_.find(key);
+        if (it == position_.end())
+            return false;
+
+        remove_at(it->second);
+        return true;
+    }
+
+    bool contains(const Key &key) const
+    {
+        return position_.find(key) != position_.end();
+    }
+
+    const T *find(const Key &key) const
+    {
+        auto it = position_.find(key);
+        return it == position_.end() ? nullptr : &heap_[it->second].second;
+    }
+
+    const T &peek() const
+    {
+        if (heap_.empty())
+        {
+            throw underflow_error("Heap is empty");
+        }
+        return heap_[0].second;
+    }
+
+    const Key &peek_key() const
+    {
+        if (heap_.empty())
+        {
+            throw underflow_error("Heap is empty");
+        }
+        return heap_[0].first;
+    }
+
+    T extract_min()
+    {
+        if (heap_.empty())
+        {
+            throw underflow_error("Heap is empty");
+        }
+
+        T min_val = heap_[0].second;
+        remove_at(0);
+        return min_val;
+    }
+
+    // The k smallest values in order, in O(k log k) without touching the heap:
+    // a frontier of candidate positions is expanded from the root
+    vector<T> get_top_k(int k) const
+    {
+        vector<T> result;
+        if (k <= 0 || heap_.empty())
+            return result;
+
+        auto later = [this](size_t a, size_t b)
+        { return comp_(heap_[b].second, heap_[a].second); };
+        vector<size_t> frontier(1, 0);
+
+        while (!frontier.empty() && (int)result.size() < k)
+        {
+            pop_heap(frontier.begin(), frontier.end(), later);
+            size_t index = frontier.back();
+            frontier.pop_back();
+            result.push_back(heap_[index].second);
+
+            size_t child = first_child(index);
+            for (size_t c = child; c < child + D && c < heap_.size(); c++)
+            {
+                frontier.push_back(c);
+                push_heap(frontier.begin(), frontier.end(), later);
+            }
+        }
+
+        return result;
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (const auto &entry : heap_)
+            fn(entry.first, entry.second);
+    }
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+
+    void clear()
+    {
+        heap_.clear();
+        position_.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef RANKEDSKIPLIST_H
+#define RANKEDSKIPLIST_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Indexable skip list: an ordered set that also answers "position of key"
+// and "key at position" in O(log n). Every forward link stores its span, the
+// number of bottom-level steps it skips, so ranks are summed on the way down.
+// Keys must be unique under Compare.
+template <typename K, typename Compare = less<K>>
+class RankedSkipList {
+private:
+    static const int MAX_LEVEL = 32;
+
+    struct Node {
+        K key;
+        vector<Node*> next;
+        vector<size_t> span;
+
+        Node(const K& k, int level) : key(k), next(level, nullptr), span(level, 0) {}
+    };
+
+    Node* head_;
+    int level_;
+    size_t size_;
+    uint64_t rng_state_;
+    Compare comp_;
+
+    bool equal(const K& a, const K& b) const {
+        return !comp_(a, b) && !comp_(b, a);
+    }
+
+    // Geometric with p = 1/4
+    int random_level() {
+        rng_state_ ^= rng_state_ << 13;
+        rng_state_ ^= rng_state_ >> 7;
+        rng_state_ ^= rng_state_ << 17;
+        uint64_t bits = rng_state_;
+        int level = 1;
+        while (level < MAX_LEVEL && (bits & 3) == 0) {
+            level++;
+            bits >>= 2;
+        }
+        return level;
+    }
+
+    Node* node_at(size_t index) const {
+        if (index >= size_) return nullptr;
+
+        size_t traversed = 0;
+        Node* x = head_;
+        for (int i = level_ - 1; i >= 0; i--) {
+            while (x->next[i] && traversed + x->span[i] <= index + 1) {
+                traversed += x->span[i];
+                x = x->next[i];
+            }
+            if (traversed == index + 1) return x;
+        }
+        return nullptr;
+    }
+
+public:
+    RankedSkipList() : head_(new Node(K(), MAX_LEVEL)), level_(1), size_(0),
+                       rng_state_(0x9E3779B97F4A7C15ULL) {}
+
+    ~RankedSkipList() {
+        clear();
+        delete head_;
+    }
+
+    RankedSkipList(const RankedSkipList&) = delete;
+    RankedSkipList& operator=(const RankedSkipList&) = delete;
+
+    // False if an equal key is already present
+    bool insert(const K& key) {
+        Node* update[MAX_LEVEL];
+        size_t rank[MAX_LEVEL];
+
+        Node* x = head_;
+        for (int i = level_ - 1; i >= 0; i--) {
+            rank[i] = (i == level_ - 1) ? 0 : rank[i + 1];
+            while (x->next[i] && comp_(x->next[i]->key, key)) {
+                rank[i] += x->span[i];
+                x = x->next[i];
+            }
+            update[i] = x;
+        }
+
+        if (x->next[0] && equal(x->next[0]->key, key)) return false;
+
+        int level = random_level();
+        if (level > level_) {
+            for (int i = level_; i < level; i++) {
+                rank[i] = 0;
+                update[i] = head_;
+                head_->span[i] = size_;
+            }
+            level_ = level;
+        }
+
+        Node* node = new Node(key, level);
+        for (int i = 0; i < level; i++) {
+            node->next[i] = update[i]->next[i];
+            update[i]->next[i] = node;
+            node->span[i] = update[i]->span[i] - (rank[0] - rank[i]);
+            update[i]->span[i] = (rank[0] - rank[i]) + 1;
+        }
+        for (int i = level; i < level_; i++) {
+            update[i]->span[i]++;
+        }
+
+        size_++;
+        return true;
+    }
+
+    bool erase(const K& key) {
+        Node* update[MAX_LEVEL];
+
+        Node* x = head_;
+        for (int i = level_ - 1; i >= 0; i--) {
+            while (x->next[i] && comp_(x->next[i]->key, key)) {
+                x = x->next[i];
+            }
+            update[i] = x;
+        }
+
+        x = x->next[0];
+        if (!x || !equal(x->key, key)) return false;
+
+        for (int i = 0; i < level_; i++) {
+            if (update[i]->next[i] == x) {
+                update[i]->span[i] += x->span[i] - 1;
+                update[i]->next[i] = x->next[i];
+            } else {
+                update[i]->span[i]--;
+            }
+        }
+        while (level_ > 1 && head_->next[level_ - 1] == nullptr) {
+            level_--;
+        }
+
+        delete x;
+        size_--;
+        return true;
+    }
+
+    // 0-based position of key, or -1 if absent
+    long long rank(const K& key) const {
+        size_t traversed = 0;
+        Node* x = head_;
+        for (int i = level_ - 1; i >= 0; i--) {
+            while (x->next[i] && !comp_(key, x->next[i]->key)) {
+                traversed += x->span[i];
+                x = x->next[i];
+            }
+            if (x != head_ && equal(x->key, key)) return (long long)traversed - 1;
+        }
+        return -1;
+    }
+
+    bool at(size_t index, K& key) const {
+        Node* x = node_at(index);
+        if (!x) return false;
+        key = x->key;
+        return true;
+    }
+
+    // Calls fn(key) for up to count keys starting at position first
+    template <typename Fn>
+    void for_range(size_t first, size_t count, Fn fn) const {
+        Node* x = node_at(first);
+        while (x && count > 0) {
+            fn(x->key);
+            x = x->next[0];
+            count--;
+        }
+    }
+
+    void clear() {
+        Node* x = head_->next[0];
+        while (x) {
+            Node* next = x->next[0];
+            delete x;
+            x = next;
+        }
+        for (int i = 0; i < MAX_LEVEL; i++) {
+            head_->next[i] = nullptr;
+            head_->span[i] = 0;
+        }
+        level_ = 1;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+};
+
+#endif
@@ -18,11 +18,17 @@ struct SegmentStats {
     int harsh_braking_events;
     int speeding_violations;
     int days_covered;           
+    double total_duration;      // seconds
+    int rapid_acceleration_events;
+    int sharp_turn_events;
+    int expense_count;
     
     SegmentStats() : total_distance(0), total_fuel(0), total_expenses(0),
                      avg_speed(0), trip_count(0), max_speed(0), 
                      min_speed(999999), harsh_braking_events(0),
-                     speeding_violations(0), days_covered(0) {}
+                     speeding_violations(0), days_covered(0), total_duration(0),
+                     rapid_acceleration_events(0), sharp_turn_events(0),
+                     expense_count(0) {}
     
     
     static SegmentStats merge(const SegmentStats& left, const SegmentStats& right) {
@@ -35,6 +41,10 @@ struct SegmentStats {
         result.harsh_braking_events = left.harsh_braking_events + right.harsh_braking_events;
         result.speeding_violations = left.speeding_violations + right.speeding_violations;
         result.days_covered = left.days_covered + right.days_covered;
+        result.total_duration = left.total_duration + right.total_duration;
+        result.rapid_acceleration_events = left.rapid_acceleration_events + right.rapid_acceleration_events;
+        result.sharp_turn_events = left.sharp_turn_events + right.sharp_turn_events;
+        result.expense_count = left.expense_count + right.expense_count;
         
         
         if (result.trip_count > 0) {
@@ -74,7 +84,7 @@ private:
         
         if (start == end) {
             
-            if (start < daily_stats.size()) {
+            if ((size_t)start < daily_stats.size()) {
                 tree_[node_idx].stats = daily_stats[start];
             }
         } else {
@@ -0,0 +1,228 @@
+#ifndef SKETCHES_H
+#define SKETCHES_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <memory>
+using namespace std;
+
+// Quantiles with bounded relative error (DDSketch-style). Positive values are
+// counted in logarithmic bins of ratio GAMMA, so any reported quantile is
+// within ACCURACY of a true sample value at that rank. Merging adds counts,
+// which makes it exact to combine sketches along segment-tree paths.
+// Values below MIN_VALUE share one bin; values past the last bin are clamped.
+class QuantileSketch {
+public:
+    static constexpr double ACCURACY = 0.02;
+    static constexpr double GAMMA = (1 + ACCURACY) / (1 - ACCURACY);
+    static constexpr double MIN_VALUE = 0.1;
+    static constexpr int BINS = 512; // covers MIN_VALUE .. ~1e8
+
+private:
+    uint32_t low_;          // values below MIN_VALUE
+    uint32_t bins_[BINS];
+    uint64_t count_;
+
+    static int bin_of(double value) {
+        static const double inv_log_gamma = 1.0 / log(GAMMA);
+        int bin = (int)ceil(log(value / MIN_VALUE) * inv_log_gamma);
+        return min(max(bin, 0), BINS - 1);
+    }
+
+    // Midpoint (in relative terms) of the bin's value range
+    static double value_of(int bin) {
+        return MIN_VALUE * pow(GAMMA, bin) * 2.0 / (GAMMA + 1.0);
+    }
+
+public:
+    QuantileSketch() { clear(); }
+
+    void clear() {
+        low_ = 0;
+        memset(bins_, 0, sizeof(bins_));
+        count_ = 0;
+    }
+
+    void add(double value) {
+        if (!(value >= MIN_VALUE)) low_++;
+        else bins_[bin_of(value)]++;
+        count_++;
+    }
+
+    void merge(const QuantileSketch& other) {
+        low_ += other.low_;
+        for (int i = 0; i < BINS; i++) bins_[i] += other.bins_[i];
+        count_ += other.count_;
+    }
+
+    // q in [0, 1]; 0 when empty
+    double quantile(double q) const {
+        if (count_ == 0) return 0;
+
+        uint64_t rank = (uint64_t)(min(max(q, 0.0), 1.0) * (double)(count_ - 1));
+        if (rank < low_) return 0;
+
+        uint64_t seen = low_;
+        for (int i = 0; i < BINS; i++) {
+            seen += bins_[i];
+            if (seen > rank) return value_of(i);
+        }
+        return value_of(BINS - 1);
+    }
+
+    uint64_t count() const { return count_; }
+};
+
+// Distinct counts in 2^P one-byte registers; standard error 1.04 / sqrt(2^P)
+// (2.3% for P = 11). Merging takes the register-wise maximum.
+template <int P = 11>
+class HyperLogLog {
+public:
+    static constexpr int REGISTERS = 1 << P;
+
+private:
+    uint8_t registers_[REGISTERS];
+
+    // SplitMix64 finaliser: ids are small sequential integers
+    static uint64_t hash(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+public:
+    HyperLogLog() { clear(); }
+
+    void clear() { memset(registers_, 0, sizeof(registers_)); }
+
+    void add(uint64_t id) {
+        uint64_t h = hash(id);
+        uint32_t index = (uint32_t)(h >> (64 - P));
+        uint64_t rest = (h << P) | (1ULL << (P - 1)); // guard bit bounds the run
+        uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+        if (rank > registers_[index]) registers_[index] = rank;
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (int i = 0; i < REGISTERS; i++)
+            registers_[i] = max(registers_[i], other.registers_[i]);
+    }
+
+    double estimate() const {
+        double sum = 0;
+        int zeros = 0;
+        for (int i = 0; i < REGISTERS; i++) {
+            sum += ldexp(1.0, -registers_[i]);
+            if (registers_[i] == 0) zeros++;
+        }
+
+        double m = REGISTERS;
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double raw = alpha * m * m / sum;
+
+        // Linear counting is more accurate while many registers are empty
+        if (raw <= 2.5 * m && zeros > 0) return m * log(m / zeros);
+        return raw;
+    }
+};
+
+// Segment tree over days for add-only mergeable summaries (T needs
+// merge(const T&) and a default constructor that is the empty summary).
+// Because merges only accumulate, an insert updates the leaf and each
+// ancestor in place; a range query merges O(log days) nodes. Nodes are
+// allocated on first use, so empty stretches of the calendar cost a pointer
+// each. The covered range grows by doubling around the days seen.
+template <typename T>
+class SketchTree {
+private:
+    vector<unique_ptr<T>> nodes_; // 1-based heap layout; leaves start at size_
+    int32_t base_day_;
+    int size_;
+
+    T& node(int i) {
+        if (!nodes_[i]) nodes_[i].reset(new T());
+        return *nodes_[i];
+    }
+
+    void build() {
+        for (int i = size_ - 1; i >= 1; i--) {
+            const unique_ptr<T>& left = nodes_[2 * i];
+            const unique_ptr<T>& right = nodes_[2 * i + 1];
+            if (!left && !right) {
+                nodes_[i].reset();
+                continue;
+            }
+            nodes_[i].reset(new T(left ? *left : *right));
+            if (left && right) nodes_[i]->merge(*right);
+        }
+    }
+
+    void cover(int32_t day) {
+        if (size_ == 0) {
+            size_ = 64;
+            base_day_ = day;
+            nodes_.resize(2 * size_);
+            return;
+        }
+        if (day >= base_day_ && day < base_day_ + size_) return;
+
+        int32_t first = min(base_day_, day);
+        int32_t last = max(base_day_ + size_ - 1, day);
+        int size = size_;
+        while (size < last - first + 1) size *= 2;
+
+        // Leave room on the side that grew
+        int32_t base_day = day < base_day_ ? last - size + 1 : first;
+
+        vector<unique_ptr<T>> nodes(2 * size);
+        for (int i = 0; i < size_; i++)
+            nodes[size + base_day_ - base_day + i] = move(nodes_[size_ + i]);
+        nodes_.swap(nodes);
+        base_day_ = base_day;
+        size_ = size;
+        build();
+    }
+
+public:
+    SketchTree() : base_day_(0), size_(0) {}
+
+    void clear() {
+        nodes_.clear();
+        base_day_ = 0;
+        size_ = 0;
+    }
+
+    // fn(T&) is applied to the day's leaf and all of its ancestors
+    template <typename Fn>
+    void add(int32_t day, Fn fn) {
+        cover(day);
+        for (int i = day - base_day_ + size_; i >= 1; i /= 2) fn(node(i));
+    }
+
+    // Inclusive day range
+    T query(int32_t first_day, int32_t last_day) const {
+        T result;
+        if (size_ == 0) return result;
+
+        int64_t first = max<int64_t>((int64_t)first_day - base_day_, 0);
+        int64_t last = min<int64_t>((int64_t)last_day - base_day_, size_ - 1);
+        if (first > last) return result;
+
+        for (int l = (int)first + size_, r = (int)last + size_ + 1; l < r; l /= 2, r /= 2) {
+            if ((l & 1) && nodes_[l]) result.merge(*nodes_[l]);
+            if (l & 1) l++;
+            if (r & 1) {
+                r--;
+                if (nodes_[r]) result.merge(*nodes_[r]);
+            }
+        }
+        return result;
+    }
+};
+
+#endif
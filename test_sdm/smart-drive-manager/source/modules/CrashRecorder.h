@@ -0,0 +1,430 @@
+#ifndef CRASH_RECORDER_H
+#define CRASH_RECORDER_H
+
+#include "ImuEventDetector.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+// Keeps the last few seconds of ADAS samples per vehicle and, when an impact
+// is flagged, saves the window around it and hands it to an incident filer.
+//
+// The ingest thread only writes into its vehicle's ring and flips an atomic
+// flag; everything else (waiting for the post-event window, compression,
+// file I/O, filing the incident) happens on the recorder's own thread.
+//
+// Captures are appended to one file: an 8-byte file magic, then per capture
+// a CrashCaptureHeader and the delta/varint-encoded samples. A capture's id
+// is the byte offset of its header, stored in
+// IncidentReport::telemetry_capture_id.
+
+#pragma pack(push, 1)
+struct CrashCaptureHeader {
+    char magic[4];             // "SDMC"
+    uint32_t payload_size;     // encoded bytes after the header
+    uint64_t vehicle_id;
+    uint64_t driver_id;
+    uint64_t trip_id;
+    uint64_t incident_id;      // 0 when no incident was filed
+    uint64_t event_timestamp;  // ms
+    uint32_t sample_count;
+    uint32_t pre_samples;      // samples before the event
+    float peak;                // m/s²
+    uint8_t event_type;        // ImuEventType
+    uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CrashCaptureHeader) == 64, "CrashCaptureHeader must be 64 bytes");
+
+// Single-producer ring that overwrites its oldest samples. The recorder
+// thread copies out of it and discards anything the producer may have
+// overwritten during the copy.
+class TelemetryRing {
+private:
+    friend class CrashRecorder;
+
+    uint64_t vehicle_id_;
+    vector<AdasData> slots_;
+    uint64_t mask_;
+    atomic<uint64_t> head_;            // samples written so far
+    atomic<uint64_t> last_timestamp_;
+    atomic<uint64_t> driver_id_;
+    atomic<uint64_t> trip_id_;
+
+    // Producer fills event_ while armed_ is false, then sets it; the
+    // recorder clears it once the capture is taken
+    ImuEvent event_;
+    atomic<bool> armed_;
+    chrono::steady_clock::time_point seen_armed_;   // recorder thread only
+    bool seen_;
+
+    void snapshot(uint64_t from_ts, uint64_t to_ts, vector<AdasData>& out) const {
+        uint64_t capacity = mask_ + 1;
+        uint64_t end = head_.load(memory_order_acquire);
+        uint64_t begin = end > capacity ? end - capacity : 0;
+
+        out.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            out.push_back(slots_[i & mask_]);
+        }
+
+        // Slot after & mask_ may be mid-write, so the oldest intact sample
+        // is after - capacity + 1
+        uint64_t after = head_.load(memory_order_acquire);
+        uint64_t safe = after + 1 > capacity ? after + 1 - capacity : 0;
+        if (safe > begin) {
+            out.erase(out.begin(), out.begin() + min<uint64_t>(safe - begin, out.size()));
+        }
+
+        size_t keep = 0;
+        for (size_t i = 0; i < out.size(); i++) {
+            if (out[i].timestamp >= from_ts && out[i].timestamp <= to_ts) out[keep++] = out[i];
+        }
+        out.resize(keep);
+    }
+
+public:
+    TelemetryRing(uint64_t vehicle_id, size_t capacity)
+        : vehicle_id_(vehicle_id), head_(0), last_timestamp_(0), driver_id_(0),
+          trip_id_(0), armed_(false), seen_(false) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // Ingest thread only
+    void push(const AdasData& sample) {
+        uint64_t h = head_.load(memory_order_relaxed);
+        slots_[h & mask_] = sample;
+        last_timestamp_.store(sample.timestamp, memory_order_relaxed);
+        head_.store(h + 1, memory_order_release);
+    }
+
+    // Ingest thread only. False while a capture is already pending; later
+    // impacts fall inside its window.
+    bool trigger(const ImuEvent& event) {
+        if (armed_.load(memory_order_acquire)) return false;
+        event_ = event;
+        armed_.store(true, memory_order_release);
+        return true;
+    }
+
+    void set_context(uint64_t driver_id, uint64_t trip_id) {
+        driver_id_ = driver_id;
+        trip_id_ = trip_id;
+    }
+
+    uint64_t vehicle_id() const { return vehicle_id_; }
+    size_t capacity() const { return slots_.size(); }
+};
+
+class CrashRecorder {
+public:
+    struct Config {
+        uint32_t pre_ms;
+        uint32_t post_ms;
+        uint32_t max_rate_hz;    // sizes the rings
+        uint32_t stall_ms;       // capture anyway if samples stop after the event
+        uint32_t poll_ms;
+
+        Config() : pre_ms(10000), post_ms(5000), max_rate_hz(200), stall_ms(2000), poll_ms(50) {}
+    };
+
+    using CaptureCallback = function<void(uint64_t capture_id, const CrashCaptureHeader&)>;
+    // Files the incident for a saved capture; returns its id, 0 on failure
+    using IncidentFiler = function<uint64_t(uint64_t capture_id, const CrashCaptureHeader&,
+                                            double latitude, double longitude,
+                                            const string& description)>;
+
+private:
+    static const int FIELDS = 11;
+
+    string path_;
+    IncidentFiler filer_;
+    Config config_;
+
+    mutex rings_mtx_;
+    unordered_map<uint64_t, unique_ptr<TelemetryRing>> rings_;
+
+    thread writer_;
+    atomic<bool> running_;
+    CaptureCallback callback_;
+
+    atomic<uint64_t> captures_;
+    atomic<uint64_t> raw_bytes_;
+    atomic<uint64_t> encoded_bytes_;
+
+    // Fixed-point units: ms, 1e-7 deg, cm/s, mm/s², 1e-4 rad/s
+    static void quantize(const AdasData& s, int64_t q[FIELDS]) {
+        q[0] = (int64_t)s.timestamp;
+        q[1] = llround(s.latitude * 1e7);
+        q[2] = llround(s.longitude * 1e7);
+        q[3] = llround(s.kalman_speed * 100.0);
+        q[4] = llround(s.gps_speed * 100.0);
+        q[5] = llround(s.accel_x * 1000.0);
+        q[6] = llround(s.accel_y * 1000.0);
+        q[7] = llround(s.accel_z * 1000.0);
+        q[8] = llround(s.gyro_x * 10000.0);
+        q[9] = llround(s.gyro_y * 10000.0);
+        q[10] = llround(s.gyro_z * 10000.0);
+    }
+
+    static void dequantize(const int64_t q[FIELDS], AdasData& s) {
+        s.timestamp = (uint64_t)q[0];
+        s.latitude = q[1] / 1e7;
+        s.longitude = q[2] / 1e7;
+        s.kalman_speed = q[3] / 100.0f;
+        s.gps_speed = q[4] / 100.0f;
+        s.accel_x = q[5] / 1000.0f;
+        s.accel_y = q[6] / 1000.0f;
+        s.accel_z = q[7] / 1000.0f;
+        s.gyro_x = q[8] / 10000.0f;
+        s.gyro_y = q[9] / 10000.0f;
+        s.gyro_z = q[10] / 10000.0f;
+    }
+
+    void writer_loop() {
+        vector<TelemetryRing*> rings;
+        vector<AdasData> samples;
+        string payload;
+
+        while (running_) {
+            this_thread::sleep_for(chrono::milliseconds(config_.poll_ms));
+
+            rings.clear();
+            {
+                lock_guard<mutex> lock(rings_mtx_);
+                for (auto& entry : rings_) rings.push_back(entry.second.get());
+            }
+
+            auto now = chrono::steady_clock::now();
+            for (TelemetryRing* ring : rings) {
+                if (!ring->armed_.load(memory_order_acquire)) continue;
+
+                if (!ring->seen_) {
+                    ring->seen_ = true;
+                    ring->seen_armed_ = now;
+                }
+
+                const ImuEvent& event = ring->event_;
+                bool window_done = ring->last_timestamp_.load() >= event.timestamp + config_.post_ms;
+                bool stalled = now - ring->seen_armed_ >=
+                               chrono::milliseconds(config_.post_ms + config_.stall_ms);
+                if (!window_done && !stalled) continue;
+
+                ImuEvent captured = event;
+                ring->snapshot(event.timestamp > config_.pre_ms ? event.timestamp - config_.pre_ms : 0,
+                               event.timestamp + config_.post_ms, samples);
+                ring->seen_ = false;
+                ring->armed_.store(false, memory_order_release);
+
+                save_capture(*ring, captured, samples, payload);
+            }
+        }
+    }
+
+    void save_capture(const TelemetryRing& ring, const ImuEvent& event,
+                      const vector<AdasData>& samples, string& payload) {
+        if (samples.empty()) return;
+
+        encode(samples, payload);
+
+        CrashCaptureHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "SDMC", 4);
+        header.payload_size = (uint32_t)payload.size();
+        header.vehicle_id = ring.vehicle_id_;
+        header.driver_id = ring.driver_id_.load();
+        header.trip_id = ring.trip_id_.load();
+        header.event_timestamp = event.timestamp;
+        header.sample_count = (uint32_t)samples.size();
+        header.peak = event.peak;
+        header.event_type = (uint8_t)event.type;
+        for (const auto& s : samples) {
+            if (s.timestamp < event.timestamp) header.pre_samples++;
+        }
+
+        uint64_t capture_id = append_capture(header, payload);
+        if (capture_id == 0) {
+            cerr << "❌ Failed to write crash capture for vehicle " << header.vehicle_id << endl;
+            return;
+        }
+
+        captures_++;
+        raw_bytes_ += samples.size() * sizeof(AdasData);
+        encoded_bytes_ += payload.size();
+
+        if (filer_) {
+            // Prefer the event position; fall back to the last GPS fix
+            double lat = event.latitude, lon = event.longitude;
+            for (size_t i = samples.size(); lat == 0 && lon == 0 && i-- > 0;) {
+                lat = samples[i].latitude;
+                lon = samples[i].longitude;
+            }
+
+            // No commas: the description may travel in a request body
+            char description[160];
+            snprintf(description, sizeof(description),
+                     "Automatic crash capture: %s %.1f m/s2 (%.1f g) over %u samples",
+                     imu_event_name(event.type), event.peak, event.peak / 9.81f,
+                     header.sample_count);
+
+            header.incident_id = filer_(capture_id, header, lat, lon, description);
+
+            if (header.incident_id != 0) {
+                fstream file(path_, ios::in | ios::out | ios::binary);
+                file.seekp(capture_id + offsetof(CrashCaptureHeader, incident_id));
+                file.write(reinterpret_cast<const char*>(&header.incident_id), sizeof(uint64_t));
+            }
+        }
+
+        if (callback_) callback_(capture_id, header);
+    }
+
+    // Returns the capture id (header offset), 0 on failure
+    uint64_t append_capture(const CrashCaptureHeader& header, const string& payload) {
+        ofstream file(path_, ios::binary | ios::app);
+        if (!file.is_open()) return 0;
+
+        file.seekp(0, ios::end);
+        uint64_t offset = (uint64_t)file.tellp();
+        if (offset == 0) {
+            file.write("SDMCRASH", 8);
+            offset = 8;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(payload.data(), payload.size());
+        file.flush();
+        return file.good() ? offset : 0;
+    }
+
+    static void put_varint(string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    static bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t byte = *p++;
+            v |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+public:
+    CrashRecorder(const string& capture_path, IncidentFiler filer = nullptr,
+                  const Config& config = Config())
+        : path_(capture_path), filer_(filer), config_(config), running_(false),
+          captures_(0), raw_bytes_(0), encoded_bytes_(0) {}
+
+    ~CrashRecorder() {
+        stop();
+    }
+
+    bool start() {
+        if (running_.exchange(true)) return false;
+        writer_ = thread(&CrashRecorder::writer_loop, this);
+        return true;
+    }
+
+    void stop() {
+        running_ = false;
+        if (writer_.joinable()) writer_.join();
+    }
+
+    // Takes the registry lock; fetch once per vehicle and keep the pointer.
+    // Rings live as long as the recorder.
+    TelemetryRing* ring(uint64_t vehicle_id) {
+        lock_guard<mutex> lock(rings_mtx_);
+        auto& slot = rings_[vehicle_id];
+        if (!slot) {
+            size_t capacity = (size_t)(config_.pre_ms + config_.post_ms) * config_.max_rate_hz / 1000;
+            slot.reset(new TelemetryRing(vehicle_id, capacity + capacity / 4 + 16));
+        }
+        return slot.get();
+    }
+
+    void set_capture_callback(CaptureCallback callback) {
+        callback_ = callback;
+    }
+
+    // Each sample's fields as fixed-point deltas from the previous sample,
+    // zigzag varint coded: typically 15-20 bytes instead of sizeof(AdasData)
+    static void encode(const vector<AdasData>& samples, string& out) {
+        out.clear();
+        int64_t prev[FIELDS] = {0};
+        int64_t q[FIELDS];
+
+        for (const auto& s : samples) {
+            quantize(s, q);
+            for (int f = 0; f < FIELDS; f++) {
+                int64_t delta = q[f] - prev[f];
+                put_varint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+                prev[f] = q[f];
+            }
+        }
+    }
+
+    static bool decode(const string& payload, uint32_t count, vector<AdasData>& samples) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(payload.data());
+        const uint8_t* end = p + payload.size();
+        int64_t q[FIELDS] = {0};
+
+        samples.clear();
+        samples.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            for (int f = 0; f < FIELDS; f++) {
+                uint64_t zz;
+                if (!get_varint(p, end, zz)) return false;
+                q[f] += (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+            }
+            AdasData s;
+            dequantize(q, s);
+            samples.push_back(s);
+        }
+        return p == end;
+    }
+
+    static bool read_capture(const string& path, uint64_t capture_id,
+                             CrashCaptureHeader& header, vector<AdasData>& samples) {
+        ifstream file(path, ios::binary);
+        if (!file.is_open() || capture_id < 8) return false;
+
+        file.seekg(capture_id);
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            memcmp(header.magic, "SDMC", 4) != 0) {
+            return false;
+        }
+
+        string payload(header.payload_size, '\0');
+        if (!file.read(&payload[0], payload.size())) return false;
+        return decode(payload, header.sample_count, samples);
+    }
+
+    uint64_t get_captures() const { return captures_.load(); }
+    uint64_t get_raw_bytes() const { return raw_bytes_.load(); }
+    uint64_t get_encoded_bytes() const { return encoded_bytes_.load(); }
+};
+
+#endif
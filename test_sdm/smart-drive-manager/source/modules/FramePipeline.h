@@ -0,0 +1,310 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Bounded single-producer single-consumer ring. The producer only moves
+// tail_, the consumer only moves head_, so neither side takes a lock.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+private:
+    vector<T> slots_;
+    size_t mask_;
+    // Padded apart so the two sides do not share a cache line; alignas would
+    // need C++17 aligned new for the heap-allocated rings
+    char pad0_[64];
+    atomic<uint64_t> head_; // next slot to read
+    char pad1_[64 - sizeof(atomic<uint64_t>)];
+    atomic<uint64_t> tail_; // next slot to write
+    char pad2_[64 - sizeof(atomic<uint64_t>)];
+
+public:
+    explicit SpscRing(size_t capacity) : head_(0), tail_(0) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer only; value is moved from on success
+    bool try_push(T& value) {
+        uint64_t tail = tail_.load(memory_order_relaxed);
+        if (tail - head_.load(memory_order_acquire) > mask_) return false;
+        slots_[tail & mask_] = move(value);
+        tail_.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool try_pop(T& value) {
+        uint64_t head = head_.load(memory_order_relaxed);
+        if (head == tail_.load(memory_order_acquire)) return false;
+        value = move(slots_[head & mask_]);
+        slots_[head & mask_] = T(); // drop references held by the slot
+        head_.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return (size_t)(tail_.load(memory_order_acquire) - head_.load(memory_order_acquire));
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+};
+
+// Fixed set of preallocated buffers handed out as reference-counted
+// handles. A buffer returns to the pool when its last handle goes away, so
+// a frame can be filled once and read in place by every later stage with
+// no per-frame allocation or copy. acquire() and handle release are
+// lock-free and may be called from any thread.
+template <typename T>
+class BufferPool {
+private:
+    struct Slot {
+        T value;
+        atomic<int> refs;
+        Slot() : refs(0) {}
+    };
+
+    vector<unique_ptr<Slot>> slots_;
+    atomic<size_t> next_;
+
+public:
+    class Handle {
+    private:
+        Slot* slot_;
+
+        // At zero the buffer is free for acquire() again
+        void release() {
+            if (slot_) slot_->refs.fetch_sub(1, memory_order_release);
+            slot_ = nullptr;
+        }
+
+    public:
+        Handle() : slot_(nullptr) {}
+        explicit Handle(Slot* slot) : slot_(slot) {}
+        Handle(const Handle& other) : slot_(other.slot_) {
+            if (slot_) slot_->refs.fetch_add(1, memory_order_relaxed);
+        }
+        Handle(Handle&& other) : slot_(other.slot_) { other.slot_ = nullptr; }
+        ~Handle() { release(); }
+
+        Handle& operator=(const Handle& other) {
+            if (this != &other) {
+                Handle copy(other);
+                swap(slot_, copy.slot_);
+            }
+            return *this;
+        }
+
+        Handle& operator=(Handle&& other) {
+            if (this != &other) {
+                release();
+                slot_ = other.slot_;
+                other.slot_ = nullptr;
+            }
+            return *this;
+        }
+
+        explicit operator bool() const { return slot_ != nullptr; }
+        T& operator*() const { return slot_->value; }
+        T* operator->() const { return &slot_->value; }
+        void reset() { release(); }
+    };
+
+    BufferPool() : next_(0) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Not thread-safe; call before handing out buffers. init sizes each one.
+    void allocate(size_t count, const function<void(T&)>& init) {
+        slots_.clear();
+        for (size_t i = 0; i < count; i++) {
+            slots_.emplace_back(new Slot());
+            if (init) init(slots_.back()->value);
+        }
+        next_ = 0;
+    }
+
+    // An empty handle when every buffer is in use
+    Handle acquire() {
+        size_t count = slots_.size();
+        size_t start = next_.fetch_add(1, memory_order_relaxed);
+        for (size_t i = 0; i < count; i++) {
+            Slot* slot = slots_[(start + i) % count].get();
+            int expected = 0;
+            if (slot->refs.load(memory_order_relaxed) == 0 &&
+                slot->refs.compare_exchange_strong(expected, 1, memory_order_acquire)) {
+                return Handle(slot);
+            }
+        }
+        return Handle();
+    }
+
+    size_t size() const { return slots_.size(); }
+
+    size_t in_use() const {
+        size_t used = 0;
+        for (const auto& slot : slots_) {
+            if (slot->refs.load(memory_order_relaxed) > 0) used++;
+        }
+        return used;
+    }
+};
+
+// A chain of stages, each on its own thread, joined by SpscRings:
+//   push() -> ring 0 -> stage 0 -> ring 1 -> stage 1 -> ... -> pop()
+// Every ring has one producer and one consumer and stages take jobs in
+// order, so jobs leave in the order they entered. A stage waits when the
+// next ring is full; only push() refuses work, which lets a live source
+// drop frames instead of building latency. Throughput is bounded by the
+// slowest stage rather than the sum of them.
+//
+// push() must be called from one thread and pop() from one thread.
+template <typename Job>
+class StagePipeline {
+public:
+    typedef function<void(Job&)> StageFn;
+
+    struct StageStats {
+        string name;
+        uint64_t jobs;
+        double avg_ms;
+        double busy; // fraction of wall time spent in the stage
+    };
+
+private:
+    struct Stage {
+        string name;
+        StageFn fn;
+        thread worker;
+        atomic<uint64_t> jobs;
+        atomic<uint64_t> busy_ns;
+        Stage(const string& n, StageFn f) : name(n), fn(move(f)), jobs(0), busy_ns(0) {}
+    };
+
+    size_t ring_capacity_;
+    vector<unique_ptr<Stage>> stages_;
+    vector<unique_ptr<SpscRing<Job>>> rings_;
+    atomic<bool> running_;
+    chrono::steady_clock::time_point started_;
+
+    // Spins briefly, then yields, then sleeps; stage work is milliseconds
+    static void backoff(int& idle) {
+        if (++idle < 64) return;
+        if (idle < 256) this_thread::yield();
+        else this_thread::sleep_for(chrono::microseconds(200));
+    }
+
+    void stage_loop(size_t index) {
+        Stage& stage = *stages_[index];
+        SpscRing<Job>& in = *rings_[index];
+        SpscRing<Job>& out = *rings_[index + 1];
+        Job job;
+        int idle = 0;
+
+        while (running_) {
+            if (!in.try_pop(job)) {
+                backoff(idle);
+                continue;
+            }
+            idle = 0;
+
+            auto start = chrono::steady_clock::now();
+            stage.fn(job);
+            stage.busy_ns += (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                                 chrono::steady_clock::now() - start).count();
+            stage.jobs++;
+
+            while (running_ && !out.try_push(job)) backoff(idle);
+            idle = 0;
+        }
+    }
+
+public:
+    explicit StagePipeline(size_t ring_capacity = 4)
+        : ring_capacity_(ring_capacity), running_(false) {}
+
+    ~StagePipeline() { stop(); }
+
+    // Before start()
+    void add_stage(const string& name, StageFn fn) {
+        stages_.emplace_back(new Stage(name, move(fn)));
+    }
+
+    void start() {
+        if (running_) return;
+
+        rings_.clear();
+        for (size_t i = 0; i <= stages_.size(); i++) {
+            rings_.emplace_back(new SpscRing<Job>(ring_capacity_));
+        }
+
+        running_ = true;
+        started_ = chrono::steady_clock::now();
+        for (size_t i = 0; i < stages_.size(); i++) {
+            stages_[i]->jobs = 0;
+            stages_[i]->busy_ns = 0;
+            stages_[i]->worker = thread(&StagePipeline::stage_loop, this, i);
+        }
+    }
+
+    // Jobs still in flight are discarded
+    void stop() {
+        running_ = false;
+        for (auto& stage : stages_) {
+            if (stage->worker.joinable()) stage->worker.join();
+        }
+    }
+
+    bool is_running() const { return running_; }
+
+    // False when the first stage is backed up; the job is left untouched
+    bool push(Job& job) {
+        return running_ && rings_.front()->try_push(job);
+    }
+
+    bool pop(Job& job, int timeout_ms) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+        int idle = 0;
+        while (!rings_.empty()) {
+            if (rings_.back()->try_pop(job)) return true;
+            if (!running_ || chrono::steady_clock::now() >= deadline) return false;
+            backoff(idle);
+        }
+        return false;
+    }
+
+    vector<StageStats> stats() const {
+        double wall_ns = (double)chrono::duration_cast<chrono::nanoseconds>(
+                             chrono::steady_clock::now() - started_).count();
+        vector<StageStats> result;
+        for (const auto& stage : stages_) {
+            StageStats s;
+            s.name = stage->name;
+            s.jobs = stage->jobs;
+            double busy = (double)stage->busy_ns;
+            s.avg_ms = s.jobs ? busy / s.jobs / 1e6 : 0;
+            s.busy = wall_ns > 0 ? busy / wall_ns : 0;
+            result.push_back(s);
+        }
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef IMU_EVENT_DETECTOR_H
+#define IMU_EVENT_DETECTOR_H
+
+#include "udp_receiver.h"
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+// Streaming driving-event detection over raw ADAS IMU samples (50-200 Hz).
+// Axes follow the device mount: accel_y longitudinal (+ forward), accel_x
+// lateral, accel_z vertical, gyro_z yaw rate. Timestamps are milliseconds.
+//
+// Per sample: a slow baseline per axis removes gravity and mounting bias, a
+// short moving average smooths the result, and jerk and yaw rate are derived
+// from it. Each event type is a hysteresis state machine (enter threshold,
+// lower exit threshold, minimum duration, refractory gap). State is fixed
+// size, so after a device's first sample processing never allocates.
+// Not thread-safe: use one detector per ingest thread.
+
+enum class ImuEventType : uint8_t {
+    HARD_BRAKE = 0,
+    HARSH_ACCEL = 1,
+    HARSH_CORNER = 2,
+    IMPACT = 3
+};
+
+static const int IMU_EVENT_TYPES = 4;
+
+inline const char* imu_event_name(ImuEventType type) {
+    switch (type) {
+        case ImuEventType::HARD_BRAKE: return "HARD_BRAKE";
+        case ImuEventType::HARSH_ACCEL: return "RAPID_ACCEL";
+        case ImuEventType::HARSH_CORNER: return "HARSH_CORNER";
+        case ImuEventType::IMPACT: return "IMPACT";
+    }
+    return "UNKNOWN";
+}
+
+struct ImuEvent {
+    uint64_t device_id;
+    ImuEventType type;
+    float peak;            // m/s² (yaw-qualified lateral accel for corners)
+    float jerk;            // m/s³ at confirmation
+    double latitude;
+    double longitude;
+    uint64_t timestamp;    // when the condition began
+};
+
+struct ImuThresholds {
+    float enter;           // m/s²
+    float exit;
+    uint32_t min_ms;       // condition must hold this long
+    uint32_t refractory_ms;
+};
+
+struct ImuDetectorConfig {
+    ImuThresholds brake;
+    ImuThresholds accel;
+    ImuThresholds corner;
+    ImuThresholds impact;  // on the unsmoothed magnitude
+    float corner_min_yaw;  // rad/s, separates turns from lane-change wobble
+    float baseline_tau_ms; // gravity/bias tracking time constant
+    uint32_t max_gap_ms;   // longer gaps reset the device's filters
+
+    ImuDetectorConfig() : corner_min_yaw(0.15f), baseline_tau_ms(8000.0f), max_gap_ms(1000) {
+        brake = {3.5f, 2.0f, 150, 1000};
+        accel = {3.0f, 1.5f, 200, 1000};
+        corner = {4.0f, 2.5f, 200, 1000};
+        impact = {39.0f, 10.0f, 0, 2000};   // ~4 g
+    }
+};
+
+class ImuEventDetector {
+public:
+    static const int WINDOW = 8;   // moving average length, ~40-160 ms
+
+private:
+    struct Hysteresis {
+        bool pending;
+        bool active;
+        uint64_t since;
+        uint64_t last_fired;
+        float peak;
+
+        Hysteresis() : pending(false), active(false), since(0), last_fired(0), peak(0) {}
+
+        // value is the rectified feature; true when an event is confirmed
+        bool update(float value, uint64_t now, const ImuThresholds& t) {
+            if (active) {
+                if (value > peak) peak = value;
+                if (value < t.exit) active = false;
+                return false;
+            }
+
+            if (value < t.enter) {
+                pending = false;
+                return false;
+            }
+
+            if (!pending) {
+                pending = true;
+                since = now;
+                peak = value;
+            } else if (value > peak) {
+                peak = value;
+            }
+
+            if (now - since < t.min_ms) return false;
+            if (last_fired != 0 && since - last_fired < t.refractory_ms) return false;
+
+            pending = false;
+            active = true;
+            last_fired = now;
+            return true;
+        }
+    };
+
+    struct DeviceState {
+        bool primed;
+        uint64_t last_ts;
+        float base_x, base_y, base_z;
+        float win_x[WINDOW], win_y[WINDOW], win_yaw[WINDOW];
+        float sum_x, sum_y, sum_yaw;
+        int win_pos;
+        int win_count;
+        float prev_long;
+        float jerk;
+        Hysteresis machines[IMU_EVENT_TYPES];
+
+        DeviceState() : primed(false) {}
+    };
+
+    ImuDetectorConfig config_;
+    unordered_map<uint64_t, DeviceState> devices_;
+    uint64_t samples_;
+    uint64_t events_;
+
+    void reset(DeviceState& d, const AdasData& s) {
+        d.primed = true;
+        d.last_ts = s.timestamp;
+        d.base_x = s.accel_x;
+        d.base_y = s.accel_y;
+        d.base_z = s.accel_z;
+        for (int i = 0; i < WINDOW; i++) {
+            d.win_x[i] = d.win_y[i] = d.win_yaw[i] = 0;
+        }
+        d.sum_x = d.sum_y = d.sum_yaw = 0;
+        d.win_pos = 0;
+        d.win_count = 0;
+        d.prev_long = 0;
+        d.jerk = 0;
+        for (int i = 0; i < IMU_EVENT_TYPES; i++) {
+            d.machines[i].pending = false;
+            d.machines[i].active = false;
+        }
+    }
+
+    static void emit(ImuEvent* out, size_t max_out, size_t& count, uint64_t device_id,
+                     ImuEventType type, const Hysteresis& m, float jerk, const AdasData& s) {
+        if (count >= max_out) return;
+        ImuEvent& e = out[count++];
+        e.device_id = device_id;
+        e.type = type;
+        e.peak = m.peak;
+        e.jerk = jerk;
+        e.latitude = s.latitude;
+        e.longitude = s.longitude;
+        e.timestamp = m.since;
+    }
+
+public:
+    ImuEventDetector(const ImuDetectorConfig& config = ImuDetectorConfig())
+        : config_(config), samples_(0), events_(0) {}
+
+    // Allocates the device's state up front so its first sample does not
+    void reserve_devices(size_t count) {
+        devices_.reserve(count);
+    }
+
+    // Feeds one sample; confirmed events are written to out (at most
+    // max_out) and their number returned
+    size_t process(uint64_t device_id, const AdasData& s, ImuEvent* out, size_t max_out) {
+        DeviceState& d = devices_[device_id];
+        samples_++;
+
+        if (!d.primed || s.timestamp <= d.last_ts ||
+            s.timestamp - d.last_ts > config_.max_gap_ms) {
+            reset(d, s);
+            return 0;
+        }
+
+        float dt_ms = (float)(s.timestamp - d.last_ts);
+        float dt = dt_ms / 1000.0f;
+        d.last_ts = s.timestamp;
+
+        float lin_x = s.accel_x - d.base_x;
+        float lin_y = s.accel_y - d.base_y;
+        float lin_z = s.accel_z - d.base_z;
+
+        // Moving average over the last WINDOW samples
+        d.sum_x += lin_x - d.win_x[d.win_pos];
+        d.sum_y += lin_y - d.win_y[d.win_pos];
+        d.sum_yaw += s.gyro_z - d.win_yaw[d.win_pos];
+        d.win_x[d.win_pos] = lin_x;
+        d.win_y[d.win_pos] = lin_y;
+        d.win_yaw[d.win_pos] = s.gyro_z;
+        d.win_pos = (d.win_pos + 1) % WINDOW;
+        if (d.win_count < WINDOW) d.win_count++;
+
+        float lateral = d.sum_x / d.win_count;
+        float longitudinal = d.sum_y / d.win_count;
+        float yaw_rate = d.sum_yaw / d.win_count;
+
+        float raw_jerk = (longitudinal - d.prev_long) / dt;
+        d.jerk += 0.3f * (raw_jerk - d.jerk);
+        d.prev_long = longitudinal;
+
+        size_t count = 0;
+        bool any_active = false;
+
+        float magnitude = sqrtf(lin_x * lin_x + lin_y * lin_y + lin_z * lin_z);
+        Hysteresis& impact = d.machines[(int)ImuEventType::IMPACT];
+        if (impact.update(magnitude, s.timestamp, config_.impact)) {
+            emit(out, max_out, count, device_id, ImuEventType::IMPACT, impact, d.jerk, s);
+        }
+
+        Hysteresis& brake = d.machines[(int)ImuEventType::HARD_BRAKE];
+        if (brake.update(-longitudinal, s.timestamp, config_.brake)) {
+            emit(out, max_out, count, device_id, ImuEventType::HARD_BRAKE, brake, d.jerk, s);
+        }
+
+        Hysteresis& accel = d.machines[(int)ImuEventType::HARSH_ACCEL];
+        if (accel.update(longitudinal, s.timestamp, config_.accel)) {
+            emit(out, max_out, count, device_id, ImuEventType::HARSH_ACCEL, accel, d.jerk, s);
+        }
+
+        float corner_value = fabsf(yaw_rate) >= config_.corner_min_yaw ? fabsf(lateral) : 0.0f;
+        Hysteresis& corner = d.machines[(int)ImuEventType::HARSH_CORNER];
+        if (corner.update(corner_value, s.timestamp, config_.corner)) {
+            emit(out, max_out, count, device_id, ImuEventType::HARSH_CORNER, corner, d.jerk, s);
+        }
+
+        for (int i = 0; i < IMU_EVENT_TYPES; i++) {
+            any_active = any_active || d.machines[i].active || d.machines[i].pending;
+        }
+
+        // Track gravity and mounting bias only while nothing is happening,
+        // so a long brake is not absorbed into the baseline
+        if (!any_active) {
+            float alpha = dt_ms / (config_.baseline_tau_ms + dt_ms);
+            d.base_x += alpha * (s.accel_x - d.base_x);
+            d.base_y += alpha * (s.accel_y - d.base_y);
+            d.base_z += alpha * (s.accel_z - d.base_z);
+        }
+
+        events_ += count;
+        return count;
+    }
+
+    // Primes a device's baseline, e.g. from a stationary calibration sample
+    void calibrate(uint64_t device_id, const AdasData& at_rest) {
+        reset(devices_[device_id], at_rest);
+    }
+
+    void forget_device(uint64_t device_id) {
+        devices_.erase(device_id);
+    }
+
+    // Converts to the event type the bridge already broadcasts
+    static AdasEvent to_adas_event(const ImuEvent& e) {
+        AdasEvent event;
+        event.event_type = imu_event_name(e.type);
+        event.value = e.peak;
+        event.latitude = e.latitude;
+        event.longitude = e.longitude;
+        event.timestamp = e.timestamp;
+        return event;
+    }
+
+    size_t device_count() const { return devices_.size(); }
+    uint64_t get_samples() const { return samples_; }
+    uint64_t get_events() const { return events_; }
+};
+
+#endif
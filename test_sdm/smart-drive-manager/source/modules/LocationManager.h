@@ -9,11 +9,16 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <functional>
 #include <iostream>
 #include <queue>
 #include <deque>
 #include <cmath>
+#include "../core/GeoMath.h"
 
 using json = nlohmann::json;
 using namespace std;
@@ -36,7 +41,7 @@ struct LocationData
 
 class LocationManager
 {
-private:
+public:
     enum class APIType {
         IP_API,           // Basic IP geolocation
         OPENSTREETMAP,    // Nominatim API (free, no key)
@@ -44,6 +49,8 @@ private:
         FALLBACK          // Multiple fallback options
     };
 
+private:
+
     atomic<bool> running;
     thread update_thread;
     
@@ -70,6 +77,40 @@ private:
     APIType current_api;
     vector<pair<APIType, string>> api_endpoints;
     int api_retry_count;
+    string client_ip;   // empty = the IP APIs locate this machine
+
+    // Async fetch layer. Every lookup has a key (API + client IP, or API +
+    // quantised position for reverse lookups); a key has at most one fetch
+    // in flight and successful answers are cached for cache_ttl_ms.
+    struct PendingFetch {
+        APIType api;
+        bool done;
+        bool ok;
+        LocationData location;
+
+        PendingFetch(APIType a) : api(a), done(false), ok(false) {}
+    };
+
+    struct CachedLocation {
+        LocationData location;
+        chrono::steady_clock::time_point expires;
+    };
+
+    mutex fetch_mutex;                  // guards everything below
+    condition_variable fetch_cv;        // signalled whenever a fetch finishes
+    unordered_map<string, shared_ptr<PendingFetch>> inflight;
+    unordered_map<string, CachedLocation> response_cache;
+    int active_fetches;
+    bool fetch_shutdown;                // set by stop(); ends rate-limit waits
+    chrono::steady_clock::time_point last_osm_request;
+
+    int cache_ttl_ms;
+    int hedge_delay_ms;      // start the next API if no answer after this long
+    int fetch_deadline_ms;   // upper bound on one refresh
+    uint64_t last_applied_timestamp;
+
+    static constexpr double CACHE_GRID_DEG = 0.001;   // ~100 m
+    static constexpr size_t MAX_CACHE_ENTRIES = 1024;
     
     // CURL callback
     static size_t WriteCallback(void *contents, size_t size, size_t nmemb, string *userp)
@@ -78,9 +119,25 @@ private:
         return size * nmemb;
     }
     
-    // CURL instance for connection reuse
-    CURL *curl_handle;
-    
+public:
+    struct FetchStats {
+        uint64_t lookups;         // fetches requested
+        uint64_t cache_hits;
+        uint64_t coalesced;       // joined a fetch already in flight
+        uint64_t outbound;        // HTTP requests actually sent
+        uint64_t failures;
+        uint64_t hedges;          // extra APIs started because the first was slow
+        uint64_t refreshes;
+        uint64_t refresh_failures;
+        uint64_t max_refresh_ms;
+
+        FetchStats() : lookups(0), cache_hits(0), coalesced(0), outbound(0), failures(0),
+                       hedges(0), refreshes(0), refresh_failures(0), max_refresh_ms(0) {}
+    };
+
+private:
+    FetchStats fetch_stats;   // guarded by fetch_mutex
+
 public:
     LocationManager(int interval_ms = 5)  // 500ms = 2Hz update rate
         : running(false), 
@@ -89,10 +146,14 @@ public:
           filtered_acceleration_ms2(0),
           current_api(APIType::IP_API),
           api_retry_count(0),
-          curl_handle(nullptr)
+          active_fetches(0),
+          fetch_shutdown(false),
+          cache_ttl_ms(30000),
+          hedge_delay_ms(300),
+          fetch_deadline_ms(2000),
+          last_applied_timestamp(0)
     {
         curl_global_init(CURL_GLOBAL_DEFAULT);
-        curl_handle = curl_easy_init();
         
         // Initialize multiple API endpoints
         api_endpoints = {
@@ -108,9 +169,6 @@ public:
     ~LocationManager()
     {
         stop();
-        if (curl_handle) {
-            curl_easy_cleanup(curl_handle);
-        }
         curl_global_cleanup();
     }
 
@@ -120,6 +178,10 @@ public:
         if (running)
             return false;
 
+        {
+            lock_guard<mutex> lock(fetch_mutex);
+            fetch_shutdown = false;
+        }
         running = true;
         update_thread = thread(&LocationManager::updateLoop, this);
         cout << "LocationManager started (interval: " << update_interval_ms << "ms)" << endl;
@@ -129,10 +191,24 @@ public:
     void stop()
     {
         running = false;
+        {
+            // Under the lock so a worker cannot miss the wake-up below
+            lock_guard<mutex> lock(fetch_mutex);
+            fetch_shutdown = true;
+        }
+        fetch_cv.notify_all();  // releases workers waiting out the OSM rate limit
+
         if (update_thread.joinable())
         {
             update_thread.join();
         }
+
+        // Fetch workers reference this object; wait for them. Any still
+        // waiting on the rate limit give up, so this is bounded by the CURL
+        // timeout of requests already sent.
+        unique_lock<mutex> lock(fetch_mutex);
+        fetch_cv.wait(lock, [this]() { return active_fetches == 0; });
+        fetch_shutdown = false;  // workers are gone; later refreshNow() may fetch again
         cout << "LocationManager stopped" << endl;
     }
 
@@ -174,6 +250,46 @@ public:
         event_callback = callback;
     }
     
+    // Point an API at another URL, e.g. a local stub server in tests
+    void setAPIEndpoint(APIType api, const string& url) {
+        lock_guard<mutex> lock(fetch_mutex);
+        for (auto& endpoint : api_endpoints) {
+            if (endpoint.first == api) {
+                endpoint.second = url;
+                return;
+            }
+        }
+        api_endpoints.push_back({api, url});
+    }
+
+    // Locate this IP instead of the caller's own address
+    void setClientIP(const string& ip) {
+        lock_guard<mutex> lock(fetch_mutex);
+        client_ip = ip;
+    }
+
+    void setFetchTiming(int ttl_ms, int hedge_ms, int deadline_ms) {
+        lock_guard<mutex> lock(fetch_mutex);
+        cache_ttl_ms = ttl_ms;
+        hedge_delay_ms = hedge_ms;
+        fetch_deadline_ms = deadline_ms;
+    }
+
+    void clearFetchCache() {
+        lock_guard<mutex> lock(fetch_mutex);
+        response_cache.clear();
+    }
+
+    FetchStats getFetchStats() {
+        lock_guard<mutex> lock(fetch_mutex);
+        return fetch_stats;
+    }
+
+    // One refresh outside the update loop; true if a location was obtained
+    bool refreshNow() {
+        return refreshLocation();
+    }
+
     // Manual location update (for testing with real GPS data)
     void updateLocationManually(double lat, double lon, double accuracy = 10.0) {
         LocationData new_loc;
@@ -197,13 +313,7 @@ private:
         {
             auto loop_start = chrono::steady_clock::now();
             
-            // Try to fetch from current API
-            bool success = fetchLocationFromAPI(current_api);
-            
-            if (!success) {
-                // Try fallback APIs
-                success = tryFallbackAPIs();
-            }
+            bool success = refreshLocation();
             
             if (success) {
                 last_success_time = chrono::steady_clock::now();
@@ -234,17 +344,183 @@ private:
         }
     }
     
-    bool tryFallbackAPIs() {
-        for (auto& api : api_endpoints) {
-            if (api.first == current_api) continue;
-            
-            cout << "Trying fallback API: " << apiToString(api.first) << endl;
-            if (fetchLocationFromAPI(api.first)) {
-                current_api = api.first;
-                return true;
+    // Races the APIs: the current one starts first and each further one is
+    // started hedge_delay_ms later while nothing has answered. The first good
+    // answer wins; losers keep running and only fill the cache.
+    bool refreshLocation() {
+        auto started = chrono::steady_clock::now();
+        LocationData result;
+        APIType winner = current_api;
+        bool ok = false;
+
+        {
+            unique_lock<mutex> lock(fetch_mutex);
+
+            vector<APIType> order;
+            order.push_back(current_api);
+            for (auto& api : api_endpoints) {
+                if (api.first != current_api) order.push_back(api.first);
+            }
+
+            auto deadline = started + chrono::milliseconds(fetch_deadline_ms);
+            vector<shared_ptr<PendingFetch>> attempts;
+            size_t next = 0;
+            auto next_hedge = started;
+
+            while (true) {
+                auto now = chrono::steady_clock::now();
+
+                bool all_failed = true;
+                for (auto& attempt : attempts) {
+                    if (attempt->done && attempt->ok) {
+                        result = attempt->location;
+                        winner = attempt->api;
+                        ok = true;
+                        break;
+                    }
+                    if (!attempt->done) all_failed = false;
+                }
+                if (ok) break;
+
+                // Next API when its hedge time comes or everything so far failed
+                if (next < order.size() && (now >= next_hedge || all_failed)) {
+                    shared_ptr<PendingFetch> attempt = startFetchLocked(order[next++]);
+                    if (attempt) {
+                        if (!all_failed) fetch_stats.hedges++;
+                        attempts.push_back(attempt);
+                        next_hedge = now + chrono::milliseconds(hedge_delay_ms);
+                    }
+                    continue;  // a cache hit is already done
+                }
+
+                if ((all_failed && next >= order.size()) || now >= deadline) break;
+
+                fetch_cv.wait_until(lock, next < order.size() ? min(next_hedge, deadline) : deadline);
             }
+
+            uint64_t elapsed_ms = chrono::duration_cast<chrono::milliseconds>(
+                chrono::steady_clock::now() - started).count();
+            fetch_stats.refreshes++;
+            if (!ok) fetch_stats.refresh_failures++;
+            if (elapsed_ms > fetch_stats.max_refresh_ms) fetch_stats.max_refresh_ms = elapsed_ms;
         }
-        return false;
+
+        if (!ok) return false;
+
+        current_api = winner;
+
+        // A cached answer already applied is not a new fix
+        if (result.timestamp != last_applied_timestamp) {
+            last_applied_timestamp = result.timestamp;
+            processNewLocation(result);
+        }
+        return true;
+    }
+
+    // Caller holds fetch_mutex. Returns a finished entry on a cache hit, the
+    // in-flight fetch for the same key, or a newly started one; nullptr if
+    // the API cannot be asked (reverse lookup without a position).
+    shared_ptr<PendingFetch> startFetchLocked(APIType api) {
+        string url;
+        string key = fetchKeyLocked(api, url);
+        if (key.empty()) return nullptr;
+
+        fetch_stats.lookups++;
+        auto now = chrono::steady_clock::now();
+
+        auto cached = response_cache.find(key);
+        if (cached != response_cache.end()) {
+            if (cached->second.expires > now) {
+                fetch_stats.cache_hits++;
+                auto hit = make_shared<PendingFetch>(api);
+                hit->done = true;
+                hit->ok = true;
+                hit->location = cached->second.location;
+                return hit;
+            }
+            response_cache.erase(cached);
+        }
+
+        auto existing = inflight.find(key);
+        if (existing != inflight.end()) {
+            fetch_stats.coalesced++;
+            return existing->second;
+        }
+
+        auto pending = make_shared<PendingFetch>(api);
+        inflight[key] = pending;
+        active_fetches++;
+
+        // Nominatim allows one request per second
+        auto not_before = now;
+        if (api == APIType::OPENSTREETMAP) {
+            not_before = max(now, last_osm_request + chrono::seconds(1));
+            last_osm_request = not_before;
+        }
+
+        thread([this, api, key, url, pending, not_before]() {
+            bool skip;
+            {
+                unique_lock<mutex> lock(fetch_mutex);
+                skip = fetch_cv.wait_until(lock, not_before, [this]() { return fetch_shutdown; });
+            }
+
+            LocationData location;
+            bool ok = !skip && fetchLocationFromAPI(api, url, location);
+
+            lock_guard<mutex> lock(fetch_mutex);
+            if (!skip) fetch_stats.outbound++;
+            if (ok) {
+                if (response_cache.size() >= MAX_CACHE_ENTRIES) response_cache.clear();
+                response_cache[key] = {location, chrono::steady_clock::now() +
+                                                 chrono::milliseconds(cache_ttl_ms)};
+            } else {
+                fetch_stats.failures++;
+            }
+            pending->ok = ok;
+            pending->location = location;
+            pending->done = true;
+            inflight.erase(key);
+            active_fetches--;
+            fetch_cv.notify_all();
+        }).detach();
+
+        return pending;
+    }
+
+    // Caller holds fetch_mutex
+    string fetchKeyLocked(APIType api, string& url) {
+        url = getAPIUrl(api);
+
+        if (api == APIType::OPENSTREETMAP) {
+            // Reverse lookup of the last known position
+            LocationData last;
+            {
+                lock_guard<mutex> lock(location_mutex);
+                last = current_location;
+            }
+            if (!last.valid) return "";
+
+            long long row = llround(last.latitude / CACHE_GRID_DEG);
+            long long col = llround(last.longitude / CACHE_GRID_DEG);
+            char query[64];
+            snprintf(query, sizeof(query), "lat=%.3f&lon=%.3f",
+                     row * CACHE_GRID_DEG, col * CACHE_GRID_DEG);
+            url += query;
+            return apiToString(api) + "@" + to_string(row) + "," + to_string(col);
+        }
+
+        if (!client_ip.empty() && api == APIType::IP_API) {
+            size_t query = url.find('?');
+            string base = query == string::npos ? url : url.substr(0, query);
+            string params = query == string::npos ? "" : url.substr(query);
+            if (!base.empty() && base.back() != '/') base += '/';
+            url = base + client_ip + params;
+        } else if (!client_ip.empty() && api == APIType::IPINFO) {
+            size_t json_path = url.rfind("/json");
+            if (json_path != string::npos) url.insert(json_path, "/" + client_ip);
+        }
+        return apiToString(api) + "#" + (client_ip.empty() ? "self" : client_ip);
     }
     
     string apiToString(APIType api) {
@@ -256,28 +532,25 @@ private:
         }
     }
 
-    bool fetchLocationFromAPI(APIType api_type)
+    // Runs on a fetch worker: no shared state is touched here
+    bool fetchLocationFromAPI(APIType api_type, const string& url, LocationData& location)
     {
-        if (!curl_handle) {
-            curl_handle = curl_easy_init();
-            if (!curl_handle) return false;
-        }
-        
-        string url = getAPIUrl(api_type);
+        CURL* curl = curl_easy_init();
+        if (!curl) return false;
+
         string response;
+        long status = 0;
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);   // required with threads
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "LocationManager/1.0");
         
-        curl_easy_setopt(curl_handle, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 5L);
-        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "LocationManager/1.0");
-        
-        // For OpenStreetMap, add delay to respect rate limits
-        if (api_type == APIType::OPENSTREETMAP) {
-            this_thread::sleep_for(chrono::seconds(1));
-        }
-        
-        CURLcode res = curl_easy_perform(curl_handle);
+        CURLcode res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_cleanup(curl);
         
         if (res != CURLE_OK)
         {
@@ -285,8 +558,11 @@ private:
                  << ": " << curl_easy_strerror(res) << endl;
             return false;
         }
+        if (status != 200) {
+            return false;
+        }
         
-        return parseLocationResponse(response, api_type);
+        return parseLocationResponse(response, api_type, location);
     }
     
     string getAPIUrl(APIType api_type) {
@@ -298,12 +574,11 @@ private:
         return api_endpoints[0].second; // Default
     }
 
-    bool parseLocationResponse(const string &response, APIType api_type)
+    bool parseLocationResponse(const string &response, APIType api_type, LocationData& new_loc)
     {
         try
         {
             auto j = json::parse(response);
-            LocationData new_loc;
             
             bool parsed = false;
             
@@ -323,7 +598,6 @@ private:
             
             if (parsed) {
                 new_loc.source = apiToString(api_type);
-                processNewLocation(new_loc);
                 return true;
             }
         }
@@ -442,20 +716,7 @@ private:
     
     double calculateHaversineDistance(double lat1, double lon1, double lat2, double lon2)
     {
-        const double R = 6371000.0; // Earth radius in meters
-        
-        double phi1 = lat1 * M_PI / 180.0;
-        double phi2 = lat2 * M_PI / 180.0;
-        double delta_phi = (lat2 - lat1) * M_PI / 180.0;
-        double delta_lambda = (lon2 - lon1) * M_PI / 180.0;
-        
-        double a = sin(delta_phi / 2.0) * sin(delta_phi / 2.0) +
-                   cos(phi1) * cos(phi2) *
-                   sin(delta_lambda / 2.0) * sin(delta_lambda / 2.0);
-        
-        double c = 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
-        
-        return R * c;
+        return GeoMath::haversine_m(lat1, lon1, lat2, lon2);
     }
     
     void checkEvents(double accel, double speed) {
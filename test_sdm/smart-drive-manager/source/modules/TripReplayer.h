@@ -0,0 +1,338 @@
+#ifndef TRIP_REPLAYER_H
+#define TRIP_REPLAYER_H
+
+#include "udp_receiver.h"
+#include "../core/TripManager.h"
+#include "../data_structures/MinHeap.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+// Replays a recorded trace as N virtual vehicles, optionally time-compressed,
+// and reports what the target could sustain. Every vehicle replays the whole
+// trace, staggered across one sample interval and shifted by a small
+// per-vehicle offset so the trips do not overlap exactly.
+
+struct ReplayConfig {
+    size_t vehicles;
+    double speedup;       // 10 = ten times real time; 0 = as fast as possible
+    double spread_deg;    // max per-vehicle lat/lon offset
+    uint64_t driver_id;
+    uint64_t first_vehicle_id;
+
+    ReplayConfig() : vehicles(100), speedup(1.0), spread_deg(0.01),
+                     driver_id(1), first_vehicle_id(1) {}
+};
+
+struct ReplayReport {
+    uint64_t points_sent;
+    uint64_t points_rejected;
+    uint64_t points_late;        // sent more than LATE_MS after their due time
+    double wall_seconds;
+    double points_per_second;
+    uint64_t max_queue_depth;
+    uint64_t points_received;    // as seen by the target
+    double mean_latency_ms;      // target-side, send -> processed
+    double max_latency_ms;
+
+    ReplayReport() : points_sent(0), points_rejected(0), points_late(0),
+                     wall_seconds(0), points_per_second(0), max_queue_depth(0),
+                     points_received(0), mean_latency_ms(0), max_latency_ms(0) {}
+};
+
+// Hooks the scheduler drives; only send is required
+struct ReplayTarget {
+    function<bool(size_t, const AdasData&)> start;    // vehicle, first sample
+    function<bool(size_t, const AdasData&)> send;
+    function<void(size_t, const AdasData&)> finish;   // vehicle, last sample
+    function<uint64_t()> queue_depth;
+};
+
+class TripReplayer {
+private:
+    static constexpr double LATE_MS = 100.0;
+    static constexpr uint64_t DEPTH_SAMPLE_EVERY = 1024;
+
+    struct ReplayStep {
+        double due_ms;
+        uint32_t vehicle;
+        uint32_t index;
+
+        bool operator<(const ReplayStep& other) const {
+            return due_ms < other.due_ms;
+        }
+    };
+
+    // Trace timestamps may be s, ms, us or ns depending on the recorder
+    static uint64_t to_milliseconds(uint64_t ts) {
+        if (ts > 100000000000000000ULL) return ts / 1000000;
+        if (ts > 100000000000000ULL) return ts / 1000;
+        if (ts < 100000000000ULL) return ts * 1000;
+        return ts;
+    }
+
+    static uint64_t now_ms() {
+        return chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static AdasData shifted(const AdasData& sample, size_t vehicle, double spread_deg) {
+        AdasData out = sample;
+        out.latitude += spread_deg * (((vehicle * 7919) % 1000) / 1000.0 - 0.5) * 2.0;
+        out.longitude += spread_deg * (((vehicle * 104729) % 1000) / 1000.0 - 0.5) * 2.0;
+        return out;
+    }
+
+public:
+    // Reads ADAS_DATA lines; other lines are skipped. Timestamps become ms.
+    static bool load_adas_csv(const string& path, vector<AdasData>& trace) {
+        ifstream file(path);
+        if (!file.is_open()) return false;
+
+        string line;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            AdasData data;
+            if (UDPReceiver::parse_adas_data(line, data)) {
+                data.timestamp = to_milliseconds(data.timestamp);
+                trace.push_back(data);
+            }
+        }
+
+        return !trace.empty();
+    }
+
+    // Stored trajectory (TripManager::get_trip_waypoints) as a trace
+    static vector<AdasData> from_waypoints(const vector<GPSWaypoint>& waypoints) {
+        vector<AdasData> trace;
+        trace.reserve(waypoints.size());
+
+        for (const auto& wp : waypoints) {
+            AdasData data = AdasData();
+            data.timestamp = wp.timestamp / 1000000;
+            data.latitude = wp.latitude;
+            data.longitude = wp.longitude;
+            data.kalman_speed = wp.speed / 3.6f;
+            data.gps_speed = data.kalman_speed;
+            trace.push_back(data);
+        }
+
+        return trace;
+    }
+
+    static string format_adas_data(const AdasData& d) {
+        ostringstream ss;
+        ss << "ADAS_DATA," << d.timestamp << ','
+           << fixed << setprecision(7) << d.latitude << ',' << d.longitude << ','
+           << setprecision(3) << d.kalman_speed << ',' << d.gps_speed << ','
+           << d.accel_x << ',' << d.accel_y << ',' << d.accel_z << ','
+           << d.gyro_x << ',' << d.gyro_y << ',' << d.gyro_z;
+        return ss.str();
+    }
+
+    static ReplayReport run(const vector<AdasData>& trace, const ReplayConfig& config,
+                            const ReplayTarget& target) {
+        ReplayReport report;
+        if (trace.empty() || config.vehicles == 0 || !target.send) return report;
+
+        double interval_ms = trace.size() > 1
+            ? (double)((int64_t)trace[1].timestamp - (int64_t)trace[0].timestamp) : 1000.0;
+        if (interval_ms <= 0) interval_ms = 1000.0;
+
+        double scale = config.speedup > 0 ? 1.0 / config.speedup : 1.0;
+        uint64_t origin = trace[0].timestamp;
+
+        MinHeap<ReplayStep> schedule;
+        for (size_t v = 0; v < config.vehicles; v++) {
+            double stagger = interval_ms * v / config.vehicles;
+            schedule.insert({stagger * scale, (uint32_t)v, 0});
+        }
+
+        auto start = chrono::steady_clock::now();
+
+        while (!schedule.empty()) {
+            ReplayStep step = schedule.extract_min();
+
+            if (config.speedup > 0) {
+                auto due = start + chrono::microseconds((int64_t)(step.due_ms * 1000.0));
+                auto now = chrono::steady_clock::now();
+                if (now < due) {
+                    this_thread::sleep_until(due);
+                } else if (chrono::duration<double, milli>(now - due).count() > LATE_MS) {
+                    report.points_late++;
+                }
+            }
+
+            AdasData sample = shifted(trace[step.index], step.vehicle, config.spread_deg);
+
+            if (step.index == 0 && target.start && !target.start(step.vehicle, sample)) {
+                report.points_rejected += trace.size();
+                continue;
+            }
+
+            if (target.send(step.vehicle, sample)) {
+                report.points_sent++;
+            } else {
+                report.points_rejected++;
+            }
+
+            if (target.queue_depth &&
+                (report.points_sent + report.points_rejected) % DEPTH_SAMPLE_EVERY == 0) {
+                uint64_t depth = target.queue_depth();
+                if (depth > report.max_queue_depth) report.max_queue_depth = depth;
+            }
+
+            if (step.index + 1 < trace.size()) {
+                double stagger = interval_ms * step.vehicle / config.vehicles;
+                // Non-monotonic traces would otherwise schedule before the origin
+                double offset = (double)((int64_t)trace[step.index + 1].timestamp - (int64_t)origin);
+                if (offset < 0) offset = 0;
+                schedule.insert({(stagger + offset) * scale, step.vehicle, step.index + 1});
+            } else if (target.finish) {
+                target.finish(step.vehicle, sample);
+            }
+        }
+
+        report.wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (report.wall_seconds > 0) {
+            report.points_per_second = report.points_sent / report.wall_seconds;
+        }
+
+        return report;
+    }
+
+    // In-process: one trip per vehicle through log_gps_point, ended with end_trip
+    static ReplayReport replay_to_trip_manager(TripManager& trips, const vector<AdasData>& trace,
+                                               const ReplayConfig& config) {
+        vector<uint64_t> trip_ids(config.vehicles, 0);
+        TripManager::GPSIngestStats before = trips.get_ingest_stats();
+
+        ReplayTarget target;
+        target.start = [&](size_t v, const AdasData& first) {
+            trip_ids[v] = trips.start_trip(config.driver_id, config.first_vehicle_id + v,
+                                           first.latitude, first.longitude);
+            return trip_ids[v] != 0;
+        };
+        target.send = [&](size_t v, const AdasData& d) {
+            return trips.log_gps_point(trip_ids[v], d.latitude, d.longitude, d.kalman_speed * 3.6f);
+        };
+        target.finish = [&](size_t v, const AdasData& last) {
+            trips.end_trip(trip_ids[v], last.latitude, last.longitude);
+        };
+        target.queue_depth = [&]() {
+            return trips.get_ingest_stats().queue_depth;
+        };
+
+        ReplayReport report = run(trace, config, target);
+
+        trips.flush_gps_buffer();
+        TripManager::GPSIngestStats after = trips.get_ingest_stats();
+
+        report.points_received = after.points_ingested - before.points_ingested;
+        if (report.points_received > 0) {
+            report.mean_latency_ms = (after.latency_sum_ns - before.latency_sum_ns) /
+                                     1000000.0 / report.points_received;
+        }
+        report.max_latency_ms = after.latency_max_ns / 1000000.0;
+        if (after.queue_high_water > report.max_queue_depth) {
+            report.max_queue_depth = after.queue_high_water;
+        }
+
+        return report;
+    }
+
+    // Sends ADAS_DATA datagrams stamped with the current time. With loopback
+    // an in-process UDPReceiver on the same port measures delivery and latency;
+    // otherwise only the send side is reported.
+    static ReplayReport replay_to_udp(const string& host, uint16_t port,
+                                      const vector<AdasData>& trace,
+                                      const ReplayConfig& config, bool loopback) {
+        ReplayReport report;
+
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock < 0) {
+            cerr << "❌ Failed to create UDP socket" << endl;
+            return report;
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            cerr << "❌ Invalid host address: " << host << endl;
+            close(sock);
+            return report;
+        }
+
+        atomic<uint64_t> received(0);
+        atomic<uint64_t> latency_sum_ms(0);
+        atomic<uint64_t> latency_max_ms(0);
+        UDPReceiver receiver(port);
+
+        if (loopback) {
+            receiver.set_data_callback([&](const AdasData& d) {
+                uint64_t now = now_ms();
+                uint64_t latency = now > d.timestamp ? now - d.timestamp : 0;
+                received++;
+                latency_sum_ms += latency;
+                if (latency > latency_max_ms.load()) latency_max_ms = latency;
+            });
+            if (!receiver.start()) {
+                close(sock);
+                return report;
+            }
+        }
+
+        ReplayTarget target;
+        target.send = [&](size_t, const AdasData& d) {
+            AdasData stamped = d;
+            stamped.timestamp = now_ms();
+            string message = format_adas_data(stamped);
+            return sendto(sock, message.data(), message.size(), 0,
+                          (struct sockaddr*)&addr, sizeof(addr)) == (ssize_t)message.size();
+        };
+
+        report = run(trace, config, target);
+
+        if (loopback) {
+            // Let in-flight datagrams arrive
+            this_thread::sleep_for(chrono::milliseconds(200));
+            receiver.stop();
+
+            report.points_received = received.load();
+            if (report.points_received > 0) {
+                report.mean_latency_ms = (double)latency_sum_ms.load() / report.points_received;
+            }
+            report.max_latency_ms = (double)latency_max_ms.load();
+        }
+
+        close(sock);
+        return report;
+    }
+
+    static void print_report(const ReplayReport& r) {
+        cout << fixed << setprecision(1);
+        cout << "Points sent:       " << r.points_sent << endl;
+        cout << "Points rejected:   " << r.points_rejected << endl;
+        cout << "Points late:       " << r.points_late << endl;
+        cout << "Wall time:         " << r.wall_seconds << " s" << endl;
+        cout << "Throughput:        " << r.points_per_second << " points/s" << endl;
+        cout << "Max queue depth:   " << r.max_queue_depth << endl;
+        cout << "Points received:   " << r.points_received << endl;
+        cout << setprecision(3);
+        cout << "Mean latency:      " << r.mean_latency_ms << " ms" << endl;
+        cout << "Max latency:       " << r.max_latency_ms << " ms" << endl;
+    }
+};
+
+#endif
@@ -440,11 +440,12 @@ bool CameraManager::stopV4L2Streaming()
     return true;
 }
 
-Mat CameraManager::readV4L2Frame(bool blocking)
+// Decodes into frame, reusing its buffer when the size and type match
+bool CameraManager::readV4L2Frame(Mat &frame, bool blocking)
 {
     if (v4l2_fd < 0 || !is_streaming)
     {
-        return Mat();
+        return false;
     }
 
     // FIXED: Use poll instead of select for better reliability
@@ -461,13 +462,13 @@ Mat CameraManager::readV4L2Frame(bool blocking)
         {
             cerr << "V4L2 poll error: " << strerror(errno) << endl;
         }
-        return Mat();
+        return false;
     }
 
     if (ret == 0)
     {
         // Timeout - normal for non-blocking
-        return Mat();
+        return false;
     }
 
     struct v4l2_buffer buf = {};
@@ -480,24 +481,25 @@ Mat CameraManager::readV4L2Frame(bool blocking)
         {
             cerr << "V4L2 dequeue error: " << strerror(errno) << endl;
         }
-        return Mat();
+        return false;
     }
 
-    Mat frame;
+    bool decoded = false;
 
     // FIXED: Better format handling
     if (v4l2_pixel_format == V4L2_PIX_FMT_MJPEG)
     {
-        // Decode MJPEG
-        vector<uchar> data((uchar *)v4l2_buffers[buf.index].start,
-                           (uchar *)v4l2_buffers[buf.index].start + buf.bytesused);
-        frame = imdecode(data, IMREAD_COLOR);
+        // Decode MJPEG straight from the mapped buffer
+        Mat data(1, (int)buf.bytesused, CV_8UC1, v4l2_buffers[buf.index].start);
+        imdecode(data, IMREAD_COLOR, &frame);
+        decoded = !frame.empty();
     }
     else if (v4l2_pixel_format == V4L2_PIX_FMT_YUYV)
     {
         // Convert YUYV to BGR
         Mat yuyv(config.height, config.width, CV_8UC2, v4l2_buffers[buf.index].start);
         cvtColor(yuyv, frame, COLOR_YUV2BGR_YUYV);
+        decoded = true;
     }
     else if (v4l2_pixel_format == V4L2_PIX_FMT_YUV420)
     {
@@ -509,11 +511,11 @@ Mat CameraManager::readV4L2Frame(bool blocking)
         try
         {
             cvtColor(yuv_frame, frame, COLOR_YUV2BGR_I420);
+            decoded = true;
         }
         catch (const cv::Exception &e)
         {
             cerr << "YUV420 conversion failed: " << e.what() << endl;
-            frame = Mat();
         }
     }
 
@@ -523,7 +525,7 @@ Mat CameraManager::readV4L2Frame(bool blocking)
         cerr << "V4L2 requeue error: " << strerror(errno) << endl;
     }
 
-    return frame;
+    return decoded;
 }
 
 bool CameraManager::setV4L2Control(unsigned int id, int value)
@@ -673,7 +675,9 @@ bool CameraManager::grabFrame(Mat &frame)
         return false;
     }
 
-    Mat captured_frame;
+    // Frames are decoded into the caller's buffer, so a caller that passes
+    // the same Mat back each time does not allocate per frame
+    bool captured = false;
     static int consecutive_empty = 0;
     static auto last_success = steady_clock::now();
 
@@ -682,7 +686,7 @@ bool CameraManager::grabFrame(Mat &frame)
 #ifdef __linux__
     case CAMERA_V4L2:
     case CAMERA_ANDROID_USB:
-        captured_frame = readV4L2Frame(false);
+        captured = readV4L2Frame(frame, false);
         break;
 #endif
     case CAMERA_ANDROID_IP:
@@ -693,14 +697,15 @@ bool CameraManager::grabFrame(Mat &frame)
         {
             return false;
         }
-        if (!cap.retrieve(captured_frame))
+        if (!cap.retrieve(frame))
         {
             return false;
         }
+        captured = !frame.empty();
         break;
     }
 
-    if (captured_frame.empty())
+    if (!captured)
     {
         consecutive_empty++;
 
@@ -739,8 +744,6 @@ bool CameraManager::grabFrame(Mat &frame)
     consecutive_empty = 0;
     last_success = steady_clock::now();
 
-    frame = captured_frame;
-
     // Update FPS
     frame_counter++;
     auto current_time = steady_clock::now();
@@ -800,10 +803,10 @@ void CameraManager::stopBackgroundCapture()
 
 void CameraManager::captureThread()
 {
+    Mat frame; // reused so grabFrame decodes into the same buffer
+
     while (capturing && camera_opened)
     {
-        Mat frame;
-
         if (grabFrame(frame) && !frame.empty())
         {
             lock_guard<mutex> lock(frame_mutex);
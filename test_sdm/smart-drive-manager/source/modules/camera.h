@@ -157,7 +157,7 @@ private:
     bool setupV4L2Buffers();
     bool startV4L2Streaming();
     bool stopV4L2Streaming();
-    Mat readV4L2Frame(bool blocking = false);
+    bool readV4L2Frame(Mat& frame, bool blocking = false);
     bool setV4L2Control(unsigned int id, int value);
     int getV4L2Control(unsigned int id);
     vector<string> getV4L2Formats();
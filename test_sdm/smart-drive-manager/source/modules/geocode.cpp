@@ -0,0 +1,89 @@
+// geocode.cpp - OFFLINE REVERSE GEOCODER TOOL
+//
+// Build (from source/modules):
+//   g++ -std=c++14 -O3 -march=native -o geocode geocode.cpp
+//
+// Examples:
+//   ./geocode build cities500.txt compiled/places.geo
+//   ./geocode lookup compiled/places.geo 48.8566 2.3522
+//   ./geocode bench compiled/places.geo 1000000
+#include "../core/ReverseGeocoder.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+
+using namespace std;
+
+static void usage() {
+    cout << "Usage:" << endl;
+    cout << "  geocode build INPUT OUTPUT       GeoNames dump or name,lat,lon[,cc[,pop]] CSV" << endl;
+    cout << "  geocode lookup INDEX LAT LON     nearest place" << endl;
+    cout << "  geocode bench INDEX [N]          N random lookups (default 1000000)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    string command = argv[1];
+
+    if (command == "build" && argc == 4) {
+        auto start = chrono::steady_clock::now();
+        size_t places = 0;
+        if (!ReverseGeocoder::build(argv[2], argv[3], places)) {
+            cerr << "❌ Could not build " << argv[3] << " from " << argv[2] << endl;
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "✓ " << places << " places written to " << argv[3]
+             << " in " << fixed << setprecision(2) << seconds << " s" << endl;
+        return 0;
+    }
+
+    ReverseGeocoder geocoder;
+    if (!geocoder.open(argv[2])) {
+        cerr << "❌ Cannot open index " << argv[2] << endl;
+        return 1;
+    }
+
+    if (command == "lookup" && argc == 5) {
+        ReverseGeocodeResult result;
+        if (!geocoder.lookup(stod(argv[3]), stod(argv[4]), result, 1e9)) {
+            cout << "No place found" << endl;
+            return 1;
+        }
+        cout << result.name << (result.country.empty() ? "" : ", " + result.country)
+             << fixed << setprecision(5) << " (" << result.latitude << ", " << result.longitude
+             << ") " << setprecision(2) << result.distance_km << " km" << endl;
+        return 0;
+    }
+
+    if (command == "bench") {
+        size_t n = argc > 3 ? stoul(argv[3]) : 1000000;
+        mt19937_64 rng(42);
+        uniform_real_distribution<double> lat(-60, 70), lon(-180, 180);
+
+        vector<pair<double, double>> queries(n);
+        for (auto& q : queries) q = make_pair(lat(rng), lon(rng));
+
+        size_t found = 0;
+        auto start = chrono::steady_clock::now();
+        for (const auto& q : queries) {
+            ReverseGeocodeResult result;
+            if (geocoder.lookup(q.first, q.second, result, 1e9)) found++;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << geocoder.place_count() << " places, " << n << " lookups, " << found << " found" << endl;
+        cout << fixed << setprecision(3) << seconds * 1e6 / n << " us per lookup, "
+             << geocoder.get_cache_hits() << " cache hits" << endl;
+        return 0;
+    }
+
+    usage();
+    return 1;
+}
@@ -19,12 +19,23 @@ struct UFLD_Lane
     int id;
 };
 
+// Where detectLanes spent its time, in milliseconds
+struct UFLD_StageTimes
+{
+    double roi;   // grayscale and blur of the ROI
+    double canny; // edges and trapezoid mask
+    double hough; // Hough segments, grouping and line fits
+    double track; // band search on tracking frames
+};
+
 struct UFLD_Result
 {
     vector<UFLD_Lane> lanes;
     double inference_time;
     bool detected;
-    UFLD_Result() : detected(false), inference_time(0) {}
+    bool tracked; // from the band search around tracked lanes, not a full search
+    UFLD_StageTimes stages;
+    UFLD_Result() : inference_time(0), detected(false), tracked(false), stages() {}
 };
 
 class UltraFastLaneDetector
@@ -50,6 +61,44 @@ private:
     float min_slope = 0.3f; // Minimum absolute slope for valid lane
     float max_slope = 3.0f; // Maximum absolute slope
 
+    // Tracking: a Kalman filter per side on the lane line x = a * y + b (ROI
+    // coordinates). While both are confident, frames only look for edges in
+    // a band around each predicted line; a full search runs every
+    // redetect_interval frames or when confidence drops.
+    bool tracking_enabled = true;
+    int redetect_interval = 15;
+    int track_band = 20;              // half-width of the search band, px
+    float min_track_confidence = 0.35f;
+    int max_track_misses = 3;         // frames a lane may coast unseen
+
+    struct LaneFit
+    {
+        bool found;
+        float a, b;
+        float confidence;
+    };
+
+    struct LaneTrack
+    {
+        KalmanFilter kf;
+        bool active;
+        int misses;
+        float confidence;
+        LaneTrack() : kf(4, 2, 0, CV_32F), active(false), misses(0), confidence(0) {}
+    };
+
+    LaneTrack tracks[2]; // 0 = left, 1 = right
+    int frames_since_search = 0;
+
+    // Working buffers, reallocated only when the ROI size changes so that
+    // steady-state frames reuse them
+    Size roi_size;
+    Mat gray, blurred, edges;
+    Mat roi_mask; // trapezoid, depends only on roi_size
+    vector<Vec4i> lines, left_lines, right_lines;
+    vector<Point> fit_points;
+    Mat warning_bar;
+
 public:
     UltraFastLaneDetector() : model_loaded(false), debug_mode(false) {}
 
@@ -64,116 +113,119 @@ public:
 
     void setDebugMode(bool enable) { debug_mode = enable; }
 
+    void setTracking(bool enable)
+    {
+        tracking_enabled = enable;
+        resetTracks();
+    }
+
     UFLD_Result detectLanes(const Mat &frame)
     {
         UFLD_Result result;
+        detectLanes(frame, result);
+        return result;
+    }
+
+    // Fills result in place, reusing its lane storage; with a result kept
+    // across frames of one size this allocates nothing once warmed up
+    bool detectLanes(const Mat &frame, UFLD_Result &result)
+    {
         auto start = chrono::high_resolution_clock::now();
+        result.detected = false;
+        result.tracked = false;
+        result.inference_time = 0;
+        result.stages = UFLD_StageTimes();
 
         if (frame.empty())
-            return result;
+        {
+            result.lanes.clear();
+            return false;
+        }
 
         // 1. Define ROI (ignore sky and hood)
         int roi_top = frame.rows * roi_top_ratio;
         int roi_height = frame.rows * (roi_bottom_ratio - roi_top_ratio);
         Rect roi(0, roi_top, frame.cols, roi_height);
         Mat roi_frame = frame(roi);
+        prepareBuffers(roi.size());
 
-        // 2. Convert to grayscale
-        Mat gray;
-        cvtColor(roi_frame, gray, COLOR_BGR2GRAY);
+        LaneFit fits[2] = {};
+        bool tracked = false;
 
-        // 3. Apply Gaussian blur to reduce noise
-        Mat blurred;
-        GaussianBlur(gray, blurred, Size(5, 5), 0);
-
-        // 4. Edge detection
-        Mat edges;
-        Canny(blurred, edges, canny_low, canny_high);
-
-        // 5. Mask to focus on lane areas (trapezoidal region)
-        Mat mask = Mat::zeros(edges.size(), edges.type());
-        Point pts[4] = {
-            Point(edges.cols * 0.1, edges.rows),       // Bottom left
-            Point(edges.cols * 0.4, edges.rows * 0.3), // Top left
-            Point(edges.cols * 0.6, edges.rows * 0.3), // Top right
-            Point(edges.cols * 0.9, edges.rows)        // Bottom right
-        };
-        fillConvexPoly(mask, pts, 4, Scalar(255));
-
-        Mat masked_edges;
-        bitwise_and(edges, mask, masked_edges);
-
-        // 6. Detect lines using Hough transform
-        vector<Vec4i> lines;
-        HoughLinesP(masked_edges, lines, 1, CV_PI / 180,
-                    hough_threshold, min_line_length, max_line_gap);
-
-        if (debug_mode)
+        if (tracking_enabled)
         {
-            cout << "Detected " << lines.size() << " raw lines" << endl;
-        }
-
-        // 7. Separate left and right lanes based on slope
-        vector<Vec4i> left_lines, right_lines;
-        int center_x = frame.cols / 2;
-
-        for (const auto &line : lines)
-        {
-            int x1 = line[0], y1 = line[1];
-            int x2 = line[2], y2 = line[3];
-
-            // Calculate slope
-            float slope = (y2 - y1) / (float)(x2 - x1 + 1e-6);
-
-            // Filter by slope
-            if (abs(slope) < min_slope || abs(slope) > max_slope)
-                continue;
-
-            // Separate by position and slope
-            int mid_x = (x1 + x2) / 2;
-            if (slope < 0 && mid_x < center_x)
+            for (auto &track : tracks)
             {
-                left_lines.push_back(line);
+                if (track.active)
+                    track.kf.predict();
             }
-            else if (slope > 0 && mid_x > center_x)
+
+            if (shouldTrack())
             {
-                right_lines.push_back(line);
+                tracked = trackLanes(roi_frame, fits, result.stages);
             }
         }
 
-        // 8. Average lines to get lane lines
-        result.lanes.clear();
+        if (!tracked)
+        {
+            searchLanes(roi_frame, frame.cols / 2, fits, result.stages);
+            frames_since_search = 0;
+        }
+        else
+        {
+            frames_since_search++;
+        }
 
-        if (!left_lines.empty())
+        // Output: filtered tracks when tracking, raw fits otherwise
+        if (tracking_enabled)
         {
-            UFLD_Lane left_lane = averageLines(left_lines, roi, roi_top);
-            left_lane.id = 0;
-            left_lane.confidence = min(1.0f, left_lines.size() / 10.0f);
-            result.lanes.push_back(left_lane);
+            correctTracks(fits);
         }
 
-        if (!right_lines.empty())
+        size_t lane_count = 0;
+        for (int side = 0; side < 2; side++)
         {
-            UFLD_Lane right_lane = averageLines(right_lines, roi, roi_top);
-            right_lane.id = 1;
-            right_lane.confidence = min(1.0f, right_lines.size() / 10.0f);
-            result.lanes.push_back(right_lane);
+            float a, b, confidence;
+            if (tracking_enabled)
+            {
+                const LaneTrack &track = tracks[side];
+                if (!track.active)
+                    continue;
+                a = track.kf.statePost.at<float>(0);
+                b = track.kf.statePost.at<float>(1);
+                confidence = track.confidence;
+            }
+            else
+            {
+                if (!fits[side].found)
+                    continue;
+                a = fits[side].a;
+                b = fits[side].b;
+                confidence = fits[side].confidence;
+            }
+
+            UFLD_Lane &lane = laneSlot(result, lane_count++);
+            laneFromLine(a, b, roi, roi_top, lane);
+            lane.id = side;
+            lane.confidence = confidence;
         }
 
+        result.lanes.resize(lane_count);
         result.detected = !result.lanes.empty();
+        result.tracked = tracked;
 
         auto end = chrono::high_resolution_clock::now();
         result.inference_time = chrono::duration<double, milli>(end - start).count();
 
         if (debug_mode)
         {
-            cout << "Left lines: " << left_lines.size()
-                 << ", Right lines: " << right_lines.size() << endl;
-            cout << "Final lanes: " << result.lanes.size() << endl;
+            cout << "Final lanes: " << result.lanes.size()
+                 << (tracked ? " (tracked)" : "") << endl;
         }
 
-        return result;
+        return result.detected;
     }
+
     bool checkLaneDeparture(const UFLD_Result &result, const Mat &frame,
                             string &direction, double &deviation)
     {
@@ -256,12 +308,13 @@ public:
             return;
         }
 
-        vector<Scalar> colors = {
+        static const Scalar colors[] = {
             Scalar(0, 255, 0),   // Green for left
             Scalar(0, 0, 255),   // Red for right
             Scalar(255, 255, 0), // Cyan
             Scalar(255, 0, 255)  // Magenta
         };
+        const size_t color_count = sizeof(colors) / sizeof(colors[0]);
 
         for (size_t i = 0; i < result.lanes.size(); i++)
         {
@@ -269,7 +322,7 @@ public:
             if (lane.points.size() < 2)
                 continue;
 
-            Scalar color = colors[i % colors.size()];
+            Scalar color = colors[i % color_count];
 
             // Draw thick lane line
             for (size_t j = 0; j < lane.points.size() - 1; j++)
@@ -311,10 +364,14 @@ public:
         pulse = (pulse + 1) % 60;
         float alpha = 0.4f + 0.4f * abs(sin(pulse * 0.1f));
 
-        Mat overlay = frame.clone();
-        rectangle(overlay, Point(0, 0), Point(frame.cols, 80),
-                  Scalar(0, 0, 255), FILLED);
-        addWeighted(frame, 1.0 - alpha, overlay, alpha, 0, frame);
+        // Only the banner is blended, against a reused solid red buffer
+        Mat banner = frame(Rect(0, 0, frame.cols, min(80, frame.rows)));
+        if (warning_bar.size() != banner.size() || warning_bar.type() != banner.type())
+        {
+            warning_bar.create(banner.size(), banner.type());
+            warning_bar.setTo(Scalar(0, 0, 255));
+        }
+        addWeighted(banner, 1.0 - alpha, warning_bar, alpha, 0, banner);
 
         string text = "⚠ LANE DEPARTURE: " + direction + " (" +
                       to_string((int)(deviation * 100)) + "%)";
@@ -327,40 +384,330 @@ public:
     }
 
 private:
-    UFLD_Lane averageLines(const vector<Vec4i> &lines, const Rect &roi, int roi_offset)
+    void prepareBuffers(Size size)
     {
-        UFLD_Lane lane;
+        if (size == roi_size)
+            return;
 
-        if (lines.empty())
-            return lane;
+        roi_size = size;
+        resetTracks();
+        gray.create(size, CV_8UC1);
+        blurred.create(size, CV_8UC1);
+        edges.create(size, CV_8UC1);
+
+        roi_mask.create(size, CV_8UC1);
+        roi_mask.setTo(Scalar(0));
+        Point pts[4] = {
+            Point(size.width * 0.1, size.height),       // Bottom left
+            Point(size.width * 0.4, size.height * 0.3), // Top left
+            Point(size.width * 0.6, size.height * 0.3), // Top right
+            Point(size.width * 0.9, size.height)        // Bottom right
+        };
+        fillConvexPoly(roi_mask, pts, 4, Scalar(255));
+
+        // Typical frames yield tens to hundreds of segments; reserving up
+        // front keeps busy frames from growing these mid-stream
+        size_t line_capacity = 4096;
+        lines.reserve(line_capacity);
+        left_lines.reserve(line_capacity);
+        right_lines.reserve(line_capacity);
+        fit_points.reserve(2 * line_capacity);
+    }
+
+    // The index-th lane of result, reusing an existing entry's storage
+    static UFLD_Lane &laneSlot(UFLD_Result &result, size_t index)
+    {
+        if (result.lanes.size() <= index)
+            result.lanes.resize(index + 1);
+        result.lanes[index].points.clear();
+        return result.lanes[index];
+    }
+
+    // Full search: Canny over the ROI, masked to the trapezoid, then Hough
+    // segments grouped by side and fitted to one line each
+    void searchLanes(const Mat &roi_frame, int center_x, LaneFit fits[2], UFLD_StageTimes &stages)
+    {
+        auto mark = chrono::steady_clock::now();
+
+        // 2. Convert to grayscale
+        cvtColor(roi_frame, gray, COLOR_BGR2GRAY);
+
+        // 3. Apply Gaussian blur to reduce noise
+        GaussianBlur(gray, blurred, Size(5, 5), 0);
+        stages.roi += lapMs(mark);
+
+        // 4. Edge detection
+        Canny(blurred, edges, canny_low, canny_high);
+
+        // 5. Mask to focus on lane areas (trapezoidal region)
+        bitwise_and(edges, roi_mask, edges);
+        stages.canny += lapMs(mark);
+
+        // 6. Detect lines using Hough transform
+        HoughLinesP(edges, lines, 1, CV_PI / 180,
+                    hough_threshold, min_line_length, max_line_gap);
+
+        if (debug_mode)
+        {
+            cout << "Detected " << lines.size() << " raw lines" << endl;
+        }
+
+        // 7. Separate left and right lanes based on slope
+        left_lines.clear();
+        right_lines.clear();
 
-        // Collect all points
-        vector<Point> all_points;
         for (const auto &line : lines)
         {
-            all_points.push_back(Point(line[0], line[1]));
-            all_points.push_back(Point(line[2], line[3]));
+            int x1 = line[0], y1 = line[1];
+            int x2 = line[2], y2 = line[3];
+
+            // Calculate slope
+            float slope = (y2 - y1) / (float)(x2 - x1 + 1e-6);
+
+            // Filter by slope
+            if (abs(slope) < min_slope || abs(slope) > max_slope)
+                continue;
+
+            // Separate by position and slope
+            int mid_x = (x1 + x2) / 2;
+            if (slope < 0 && mid_x < center_x)
+            {
+                left_lines.push_back(line);
+            }
+            else if (slope > 0 && mid_x > center_x)
+            {
+                right_lines.push_back(line);
+            }
+        }
+
+        // 8. Average lines to get lane lines
+        fitSegments(left_lines, fits[0]);
+        fitSegments(right_lines, fits[1]);
+        stages.hough += lapMs(mark);
+
+        if (debug_mode)
+        {
+            cout << "Left lines: " << left_lines.size()
+                 << ", Right lines: " << right_lines.size() << endl;
+        }
+    }
+
+    bool shouldTrack() const
+    {
+        if (frames_since_search >= redetect_interval)
+            return false;
+
+        // trackLanes never searches an inactive side, so a lost lane needs
+        // a full search to be picked up again
+        for (const auto &track : tracks)
+        {
+            if (!track.active || track.confidence < min_track_confidence)
+                return false;
+        }
+        return true;
+    }
+
+    // Band search around each predicted line: edges are found only inside
+    // the band's bounding box, and each sampled row contributes the mean x
+    // of its edge pixels. False when no lane was found, so the caller can
+    // fall back to a full search.
+    bool trackLanes(const Mat &roi_frame, LaneFit fits[2], UFLD_StageTimes &stages)
+    {
+        auto mark = chrono::steady_clock::now();
+        const int row_step = 2;
+        bool any = false;
+
+        for (int side = 0; side < 2; side++)
+        {
+            LaneFit &fit = fits[side];
+            fit.found = false;
+            if (!tracks[side].active)
+                continue;
+
+            float a = tracks[side].kf.statePre.at<float>(0);
+            float b = tracks[side].kf.statePre.at<float>(1);
+
+            int h = roi_frame.rows;
+            float x_top = b;
+            float x_bottom = a * (h - 1) + b;
+            int x0 = max(0, (int)floor(min(x_top, x_bottom)) - track_band - 3);
+            int x1 = min(roi_frame.cols - 1, (int)ceil(max(x_top, x_bottom)) + track_band + 3);
+            if (x1 - x0 < 8)
+                continue;
+
+            Rect band(x0, 0, x1 - x0 + 1, h);
+            Mat gray_band = gray(band);
+            Mat blurred_band = blurred(band);
+            Mat edges_band = edges(band);
+            cvtColor(roi_frame(band), gray_band, COLOR_BGR2GRAY);
+            GaussianBlur(gray_band, blurred_band, Size(5, 5), 0);
+            Canny(blurred_band, edges_band, canny_low, canny_high);
+
+            double n = 0, sy = 0, sx = 0, syy = 0, sxy = 0;
+            int rows = 0;
+            for (int y = 0; y < h; y += row_step)
+            {
+                rows++;
+                float xc = a * y + b;
+                int from = max(x0, (int)(xc - track_band));
+                int to = min(x1, (int)(xc + track_band));
+                if (from > to)
+                    continue;
+
+                const uchar *edge_row = edges.ptr<uchar>(y);
+                const uchar *mask_row = roi_mask.ptr<uchar>(y);
+                int hits = 0, sum = 0;
+                for (int x = from; x <= to; x++)
+                {
+                    if (edge_row[x] && mask_row[x])
+                    {
+                        hits++;
+                        sum += x;
+                    }
+                }
+                if (hits == 0)
+                    continue;
+
+                double x = (double)sum / hits;
+                n++;
+                sy += y;
+                sx += x;
+                syy += (double)y * y;
+                sxy += x * y;
+            }
+
+            double denom = n * syy - sy * sy;
+            if (n < max(8.0, rows * 0.15) || abs(denom) < 1e-9)
+                continue;
+
+            fit.a = (float)((n * sxy - sy * sx) / denom);
+            fit.b = (float)((sx - fit.a * sy) / n);
+            fit.confidence = min(1.0f, (float)(n / rows) / 0.5f);
+            fit.found = true;
+            any = true;
+        }
+
+        stages.track += lapMs(mark);
+        return any;
+    }
+
+    // Milliseconds since mark, which moves to now
+    static double lapMs(chrono::steady_clock::time_point &mark)
+    {
+        auto now = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(now - mark).count();
+        mark = now;
+        return ms;
+    }
+
+    // Call after predict() on every active track
+    void correctTracks(const LaneFit fits[2])
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            LaneTrack &track = tracks[side];
+            const LaneFit &fit = fits[side];
+
+            if (!track.active)
+            {
+                if (fit.found)
+                    startTrack(track, fit);
+                continue;
+            }
+
+            if (fit.found)
+            {
+                float measurement[2] = {fit.a, fit.b};
+                track.kf.correct(Mat(2, 1, CV_32F, measurement));
+                track.misses = 0;
+                track.confidence = fit.confidence;
+            }
+            else if (++track.misses > max_track_misses)
+            {
+                track.active = false;
+            }
+            else
+            {
+                track.confidence *= 0.5f; // coasting on the prediction
+            }
+        }
+    }
+
+    // Constant-velocity model on (a, b); noise in the units of each: a is
+    // a dimensionless slope, b is pixels
+    void startTrack(LaneTrack &track, const LaneFit &fit)
+    {
+        KalmanFilter &kf = track.kf;
+        kf.transitionMatrix = (Mat_<float>(4, 4) << 1, 0, 1, 0,
+                                                   0, 1, 0, 1,
+                                                   0, 0, 1, 0,
+                                                   0, 0, 0, 1);
+        setIdentity(kf.measurementMatrix);
+        kf.processNoiseCov = Mat::diag((Mat_<float>(4, 1) << 1e-4f, 1.0f, 1e-5f, 0.1f));
+        kf.measurementNoiseCov = Mat::diag((Mat_<float>(2, 1) << 2e-3f, 25.0f));
+        kf.errorCovPost = Mat::diag((Mat_<float>(4, 1) << 1e-2f, 100.0f, 1e-3f, 10.0f));
+        kf.statePost = (Mat_<float>(4, 1) << fit.a, fit.b, 0, 0);
+
+        track.active = true;
+        track.misses = 0;
+        track.confidence = fit.confidence;
+    }
+
+    void resetTracks()
+    {
+        for (auto &track : tracks)
+        {
+            track.active = false;
+            track.misses = 0;
+            track.confidence = 0;
+        }
+        frames_since_search = 0;
+    }
+
+    // Least-squares line through the segment end points, as x = a * y + b
+    void fitSegments(const vector<Vec4i> &segments, LaneFit &fit)
+    {
+        fit.found = false;
+        if (segments.empty())
+            return;
+
+        // Collect all points
+        fit_points.clear();
+        for (const auto &line : segments)
+        {
+            fit_points.push_back(Point(line[0], line[1]));
+            fit_points.push_back(Point(line[2], line[3]));
         }
 
         // Fit line using least squares
         Vec4f fitted_line;
-        fitLine(all_points, fitted_line, DIST_L2, 0, 0.01, 0.01);
+        fitLine(fit_points, fitted_line, DIST_L2, 0, 0.01, 0.01);
 
         float vx = fitted_line[0];
         float vy = fitted_line[1];
         float x0 = fitted_line[2];
         float y0 = fitted_line[3];
 
+        fit.a = vx / (vy + 1e-6);
+        fit.b = x0 - fit.a * y0;
+        fit.confidence = min(1.0f, segments.size() / 10.0f);
+        fit.found = true;
+    }
+
+    void laneFromLine(float a, float b, const Rect &roi, int roi_offset, UFLD_Lane &lane)
+    {
+        lane.points.clear();
+
         // Generate points along the line
         int y_start = 0;
         int y_end = roi.height;
         int num_points = 20;
+        lane.points.reserve(num_points);
 
         for (int i = 0; i < num_points; i++)
         {
             float y = y_start + (y_end - y_start) * i / (float)num_points;
-            float t = (y - y0) / (vy + 1e-6);
-            float x = x0 + vx * t;
+            float x = a * y + b;
 
             // Convert back to full frame coordinates
             int full_x = (int)x;
@@ -371,8 +718,6 @@ private:
                 lane.points.push_back(Point(full_x, full_y));
             }
         }
-
-        return lane;
     }
 };
 
@@ -1,12 +1,13 @@
 // main.cpp - FIXED: Stable capture with proper error handling
 #include "camera.h"
 #include "lane_detector.h"
+#include "FramePipeline.h"
 
 #include <iostream>
 #include <thread>
 #include <atomic>
 #include <memory>
-#include <queue>
+#include <deque>
 #include <mutex>
 #include <chrono>
 #include <iomanip>
@@ -132,73 +133,22 @@ struct SystemConfig
     float aggressive_accel_threshold = 4.5f;
 };
 
-template <typename T>
-class ThreadSafeQueue
-{
-private:
-    queue<T> queue_;
-    mutable mutex mutex_;
-    condition_variable cond_;
-    size_t max_size_;
-
-public:
-    ThreadSafeQueue(size_t max_size = 2) : max_size_(max_size) {}
-
-    void push(T value)
-    {
-        lock_guard<mutex> lock(mutex_);
-        while (queue_.size() >= max_size_)
-        {
-            queue_.pop();
-        }
-        queue_.push(move(value));
-        cond_.notify_one();
-    }
-
-    bool try_pop(T &value)
-    {
-        lock_guard<mutex> lock(mutex_);
-        if (queue_.empty())
-        {
-            return false;
-        }
-        value = move(queue_.front());
-        queue_.pop();
-        return true;
-    }
-
-    bool wait_and_pop(T &value, int timeout_ms = 100)
-    {
-        unique_lock<mutex> lock(mutex_);
-        if (!cond_.wait_for(lock, milliseconds(timeout_ms),
-                            [this]
-                            { return !queue_.empty(); }))
-        {
-            return false;
-        }
-        value = move(queue_.front());
-        queue_.pop();
-        return true;
-    }
+typedef BufferPool<Mat>::Handle FrameHandle;
+typedef BufferPool<UFLD_Result>::Handle LaneHandle;
 
-    size_t size() const
-    {
-        lock_guard<mutex> lock(mutex_);
-        return queue_.size();
-    }
-
-    bool empty() const
-    {
-        lock_guard<mutex> lock(mutex_);
-        return queue_.empty();
-    }
-
-    void clear()
-    {
-        lock_guard<mutex> lock(mutex_);
-        queue<T> empty;
-        swap(queue_, empty);
-    }
+// One frame's trip through the processing stages
+struct FrameJob
+{
+    uint64_t seq = 0;
+    steady_clock::time_point captured;
+    FrameHandle frame; // pooled; written by capture, then edited in place
+
+    // Filled by the detect stage for the annotate stage; empty when lanes
+    // were not run on this frame
+    LaneHandle lanes;
+    bool departure = false;
+    string direction;
+    double deviation = 0;
 };
 
 class SmartDriveManager
@@ -211,14 +161,21 @@ private:
     unique_ptr<CameraManager> camera;
     unique_ptr<UltraFastLaneDetector> lane_detector;
 
-
     atomic<bool> running;
     atomic<bool> processing_active;
 
-    ThreadSafeQueue<Mat> capture_queue;
-    ThreadSafeQueue<Mat> display_queue;
+    // Declared before everything holding its handles so it is destroyed last.
+    // Its size caps the frames in flight: capture drops when it is empty.
+    static const size_t FRAME_POOL_SIZE = 8;
+    BufferPool<Mat> frame_pool;
+    // One result per frame buffer, so a job can always get one. Pooled
+    // results keep their lane storage, so detection stays allocation-free.
+    BufferPool<UFLD_Result> lane_pool;
+
+    // capture -> preprocess -> detect -> annotate -> display (main thread)
+    StagePipeline<FrameJob> pipeline;
+    FrameHandle last_display_frame; // display thread only
 
-    thread processing_thread;
     thread capture_thread;
 
     FPSCounter total_fps_counter;
@@ -256,8 +213,7 @@ public:
           phone_camera_used(false),
           running(false),
           processing_active(false),
-          capture_queue(2),
-          display_queue(2),
+          pipeline(4),
           frame_count(0),
           lane_processing_time(0),
           simulated_target_speed(0),
@@ -432,15 +388,23 @@ public:
         running = true;
         processing_active = true;
 
+        int rows = config.camera_height, cols = config.camera_width;
+        frame_pool.allocate(FRAME_POOL_SIZE, [rows, cols](Mat &buffer)
+                            { buffer.create(rows, cols, CV_8UC3); });
+        lane_pool.allocate(FRAME_POOL_SIZE, nullptr);
+
+        pipeline.add_stage("preprocess", [this](FrameJob &job)
+                           { preprocessStage(job); });
+        pipeline.add_stage("detect", [this](FrameJob &job)
+                           { detectStage(job); });
+        pipeline.add_stage("annotate", [this](FrameJob &job)
+                           { annotateStage(job); });
+        pipeline.start();
+
         capture_thread = thread(&SmartDriveManager::captureLoop, this);
-        processing_thread = thread(&SmartDriveManager::processingLoop, this);
 
         displayLoop();
 
-        if (processing_thread.joinable())
-        {
-            processing_thread.join();
-        }
         if (capture_thread.joinable())
         {
             capture_thread.join();
@@ -457,8 +421,7 @@ public:
             camera->release();
         }
 
-        capture_queue.clear();
-        display_queue.clear();
+        pipeline.stop();
 
         printPerformanceStats();
     }
@@ -530,6 +493,13 @@ private:
         cout << "Max Latency: " << perf_stats.max_latency << "ms" << endl;
         cout << "Dropped Frames: " << perf_stats.dropped_frames << endl;
         cout << "Average FPS: " << total_fps_counter.getFPS() << endl;
+
+        for (const auto &stage : pipeline.stats())
+        {
+            cout << "Stage " << left << setw(10) << stage.name << right
+                 << stage.avg_ms << "ms avg, " << (int)(stage.busy * 100) << "% busy, "
+                 << stage.jobs << " frames" << endl;
+        }
     }
 
     bool initializeCamera()
@@ -608,7 +578,8 @@ private:
     // FIXED: Much more conservative capture loop
     void captureLoop()
     {
-        Mat frame;
+        Mat overflow; // takes the camera's frame when the pool is empty
+        uint64_t next_seq = 0;
         int consecutive_failures = 0;
         const int max_failures = 50; // Increased tolerance
 
@@ -618,6 +589,10 @@ private:
         {
             auto capture_start = steady_clock::now();
 
+            // The camera decodes straight into a pooled buffer
+            FrameHandle buffer = frame_pool.acquire();
+            Mat &frame = buffer ? *buffer : overflow;
+
             if (!camera->grabFrame(frame))
             {
                 consecutive_failures++;
@@ -654,7 +629,17 @@ private:
             }
 
             capture_fps_counter.update();
-            capture_queue.push(frame.clone());
+
+            // A backed-up pipeline drops the new frame rather than queueing
+            // latency; stages downstream never drop, so order is kept
+            FrameJob job;
+            job.seq = next_seq++;
+            job.captured = capture_start;
+            job.frame = move(buffer);
+            if (!job.frame || !pipeline.push(job))
+            {
+                perf_stats.dropped_frames++;
+            }
 
             auto capture_end = steady_clock::now();
             double latency = duration_cast<microseconds>(
@@ -673,80 +658,93 @@ private:
         cout << "Capture thread stopped" << endl;
     }
 
-    void processingLoop()
+    // Brings frames to the configured size when the camera ignored it
+    void preprocessStage(FrameJob &job)
     {
-        Mat frame;
-        int processed_frames = 0;
-
-        cout << "Processing thread started" << endl;
-
-        while (processing_active && !g_should_exit)
+        Mat &frame = *job.frame;
+        if (frame.cols == config.camera_width && frame.rows == config.camera_height)
         {
-            if (!capture_queue.wait_and_pop(frame, 200))
-            {
-                continue;
-            }
-
-            if (frame.empty())
-                continue;
-
-            auto process_start = steady_clock::now();
-
-            Mat processed_frame = frame.clone();
-            processed_frames++;
+            return;
+        }
 
-            bool run_heavy_detection = (processed_frames % config.detection_interval == 0);
+        // Resizing in place would allocate, so use a second pooled buffer
+        Size size(config.camera_width, config.camera_height);
+        FrameHandle resized = frame_pool.acquire();
+        if (resized)
+        {
+            resize(frame, *resized, size);
+            job.frame = move(resized);
+        }
+        else
+        {
+            resize(frame, frame, size);
+        }
+    }
 
-            if (config.enable_lane_detection && lane_detector && processed_frames % 2 == 0)
-            {
-                auto lane_start = chrono::high_resolution_clock::now();
+    // Lanes on every second frame, as before; the detector is only used here
+    // apart from its stateless drawing helpers
+    void detectStage(FrameJob &job)
+    {
+        job.lanes.reset();
+        job.departure = false;
 
-                auto result = lane_detector->detectLanes(processed_frame);
+        if (!processing_active || !config.enable_lane_detection || !lane_detector ||
+            job.seq % 2 != 0)
+        {
+            return;
+        }
 
-                // ALWAYS draw lanes, even if empty (for debugging)
-                lane_detector->drawLanes(processed_frame, result, true);
+        LaneHandle lanes = lane_pool.acquire();
+        if (!lanes)
+        {
+            return;
+        }
 
-                string direction;
-                double deviation;
-                bool departure = lane_detector->checkLaneDeparture(
-                    result, processed_frame, direction, deviation);
+        auto lane_start = chrono::high_resolution_clock::now();
 
-                if (departure)
-                {
-                    lane_detector->drawDepartureWarning(
-                        processed_frame, direction, deviation, true);
+        const Mat &frame = *job.frame;
+        lane_detector->detectLanes(frame, *lanes);
 
-                    if (!lane_departure_alert.exchange(true))
-                    {
-                        cout << "\a";
-                        cout << "🚨 LANE DEPARTURE: " << direction << " ("
-                             << fixed << setprecision(1) << abs(deviation * 100) << "%)" << endl;
-                    }
-                }
-                else
-                {
-                    lane_departure_alert = false;
-                }
+        job.departure = lane_detector->checkLaneDeparture(
+            *lanes, frame, job.direction, job.deviation);
+        job.lanes = move(lanes);
 
-                auto lane_end = chrono::high_resolution_clock::now();
-                lane_processing_time = duration_cast<milliseconds>(
-                                           lane_end - lane_start)
-                                           .count();
+        if (job.departure)
+        {
+            if (!lane_departure_alert.exchange(true))
+            {
+                cout << "\a";
+                cout << "🚨 LANE DEPARTURE: " << job.direction << " ("
+                     << fixed << setprecision(1) << abs(job.deviation * 100) << "%)" << endl;
             }
-            
-            addOverlays(processed_frame);
-            display_queue.push(processed_frame);
+        }
+        else
+        {
+            lane_departure_alert = false;
+        }
 
-            auto process_end = steady_clock::now();
-            total_processing_time = duration_cast<milliseconds>(
-                                        process_end - process_start)
-                                        .count();
+        auto lane_end = chrono::high_resolution_clock::now();
+        lane_processing_time = duration_cast<milliseconds>(
+                                   lane_end - lane_start)
+                                   .count();
+    }
 
-            total_fps_counter.update();
+    void annotateStage(FrameJob &job)
+    {
+        Mat &frame = *job.frame;
+        if (job.lanes)
+        {
+            // ALWAYS draw lanes, even if empty (for debugging)
+            lane_detector->drawLanes(frame, *job.lanes, true);
 
+            if (job.departure)
+            {
+                lane_detector->drawDepartureWarning(
+                    frame, job.direction, job.deviation, true);
+            }
         }
 
-        cout << "Processing thread stopped" << endl;
+        addOverlays(frame);
     }
 
     void addOverlays(Mat &frame)
@@ -766,7 +764,7 @@ private:
 
     void displayLoop()
     {
-        Mat display_frame;
+        FrameJob job;
         auto last_fps_update = steady_clock::now();
         int frames_displayed = 0;
         double current_display_fps = 0;
@@ -783,10 +781,17 @@ private:
 
         while (running && !g_should_exit)
         {
-            if (display_queue.try_pop(display_frame))
+            if (pipeline.pop(job, 10) && job.frame)
             {
+                Mat &display_frame = *job.frame;
                 if (!display_frame.empty())
                 {
+                    // Capture to screen
+                    total_processing_time = duration_cast<milliseconds>(
+                                                steady_clock::now() - job.captured)
+                                                .count();
+                    total_fps_counter.update();
+
                     frames_displayed++;
 
                     auto current_time = steady_clock::now();
@@ -836,13 +841,9 @@ private:
                     }
 
                     imshow("Smart Drive Manager", display_frame);
+                    last_display_frame = job.frame;
                 }
             }
-            else
-            {
-                // Wait a bit if no frame available
-                this_thread::sleep_for(chrono::milliseconds(10));
-            }
 
             int key = waitKey(1);
             if (key != -1)
@@ -911,9 +912,9 @@ private:
         case 's':
         case 'S':
         {
-            Mat screenshot;
-            if (display_queue.try_pop(screenshot))
+            if (last_display_frame && !last_display_frame->empty())
             {
+                const Mat &screenshot = *last_display_frame;
                 static int screenshot_count = 0;
                 stringstream filename;
                 time_t now = time(nullptr);
@@ -0,0 +1,134 @@
+// replay.cpp - TRIP REPLAY / FLEET SIMULATION
+//
+// Build (from source/modules):
+//   g++ -std=c++14 -O3 -march=native -fno-math-errno -fno-trapping-math -o replay replay.cpp -lpthread -lcrypto
+//
+// Examples:
+//   ./replay trace.csv --vehicles 2000 --speedup 10
+//   ./replay trace.csv --target udp --host 127.0.0.1 --port 5555 --vehicles 200
+//   ./replay --trip 42 --db compiled/replay.db --vehicles 500 --speedup 0
+#include "TripReplayer.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static void usage() {
+    cout << "Usage: replay [trace.csv | --trip ID] [options]" << endl;
+    cout << "  --vehicles N     virtual vehicles (default 100)" << endl;
+    cout << "  --speedup X      time compression, 0 = as fast as possible (default 1)" << endl;
+    cout << "  --spread DEG     per-vehicle position offset (default 0.01)" << endl;
+    cout << "  --target T       trip (in-process TripManager) or udp (default trip)" << endl;
+    cout << "  --host H         udp destination (default 127.0.0.1)" << endl;
+    cout << "  --port P         udp port (default 5555)" << endl;
+    cout << "  --loopback       run a UDPReceiver in-process to measure delivery" << endl;
+    cout << "  --db PATH        database for the trip target (default compiled/replay.db)" << endl;
+    cout << "  --index PATH     index directory (default compiled/replay_indexes)" << endl;
+    cout << "  --driver ID      driver id for replayed trips (default 1)" << endl;
+    cout << "  --trip ID        replay a stored trip from the database instead of a CSV" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    ReplayConfig config;
+    string trace_path;
+    string target = "trip";
+    string host = "127.0.0.1";
+    uint16_t port = 5555;
+    bool loopback = false;
+    string db_path = "compiled/replay.db";
+    string index_path = "compiled/replay_indexes";
+    uint64_t stored_trip = 0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--vehicles" && has_value) config.vehicles = stoul(argv[++i]);
+        else if (arg == "--speedup" && has_value) config.speedup = stod(argv[++i]);
+        else if (arg == "--spread" && has_value) config.spread_deg = stod(argv[++i]);
+        else if (arg == "--target" && has_value) target = argv[++i];
+        else if (arg == "--host" && has_value) host = argv[++i];
+        else if (arg == "--port" && has_value) port = (uint16_t)stoul(argv[++i]);
+        else if (arg == "--loopback") loopback = true;
+        else if (arg == "--db" && has_value) db_path = argv[++i];
+        else if (arg == "--index" && has_value) index_path = argv[++i];
+        else if (arg == "--driver" && has_value) config.driver_id = stoull(argv[++i]);
+        else if (arg == "--trip" && has_value) stored_trip = stoull(argv[++i]);
+        else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+        else if (arg[0] != '-') trace_path = arg;
+        else { usage(); return 1; }
+    }
+
+    if (trace_path.empty() && stored_trip == 0) {
+        usage();
+        return 1;
+    }
+
+    vector<AdasData> trace;
+    if (!trace_path.empty() && !TripReplayer::load_adas_csv(trace_path, trace)) {
+        cerr << "❌ No ADAS_DATA samples in " << trace_path << endl;
+        return 1;
+    }
+
+    DatabaseManager* db = nullptr;
+    CacheManager* cache = nullptr;
+    IndexManager* index = nullptr;
+    TripManager* trips = nullptr;
+
+    if (target == "trip" || stored_trip != 0) {
+        db = new DatabaseManager(db_path);
+        if (!db->open()) {
+            // Small dedicated database so replays do not touch real data
+            SDMConfig db_config;
+            db_config.max_drivers = 1000;
+            db_config.max_vehicles = config.vehicles + 1000;
+            db_config.max_trips = config.vehicles * 4 + 10000;
+            if (!db->create(db_config) || !db->open()) {
+                cerr << "❌ Cannot open database " << db_path << endl;
+                return 1;
+            }
+        }
+
+        cache = new CacheManager(256, 256, 512, 1024);
+        index = new IndexManager(index_path);
+        if (!index->open_indexes()) {
+            mkdir(index_path.c_str(), 0755);
+            index->create_indexes();
+        }
+
+        trips = new TripManager(*db, *cache, *index);
+    }
+
+    if (stored_trip != 0) {
+        trace = TripReplayer::from_waypoints(trips->get_trip_waypoints(stored_trip));
+        if (trace.empty()) {
+            cerr << "❌ No stored GPS points for trip " << stored_trip << endl;
+            return 1;
+        }
+    }
+
+    cout << "Replaying " << trace.size() << " samples x " << config.vehicles
+         << " vehicles (speedup " << config.speedup << ") -> " << target << endl;
+
+    ReplayReport report;
+    if (target == "udp") {
+        report = TripReplayer::replay_to_udp(host, port, trace, config, loopback);
+    } else if (target == "trip") {
+        trips->start_gps_ingest();
+        report = TripReplayer::replay_to_trip_manager(*trips, trace, config);
+        trips->stop_gps_ingest();
+    } else {
+        usage();
+        return 1;
+    }
+
+    cout << endl;
+    TripReplayer::print_report(report);
+
+    delete trips;
+    delete index;
+    delete cache;
+    delete db;
+
+    return 0;
+}
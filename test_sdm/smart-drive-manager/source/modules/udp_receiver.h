@@ -27,6 +27,7 @@ struct AdasData {
     float gyro_x;          // rad/s
     float gyro_y;
     float gyro_z;
+    uint64_t vehicle_id = 0; // optional trailing field; 0 when the sender omits it
 };
 
 struct AdasEvent {
@@ -80,34 +81,22 @@ private:
         
         if (parts[0] == "ADAS_DATA" && parts.size() >= 12) {
             AdasData data;
-            try {
-                data.timestamp = stoull(parts[1]);
-                data.latitude = stod(parts[2]);
-                data.longitude = stod(parts[3]);
-                data.kalman_speed = stof(parts[4]);
-                data.gps_speed = stof(parts[5]);
-                data.accel_x = stof(parts[6]);
-                data.accel_y = stof(parts[7]);
-                data.accel_z = stof(parts[8]);
-                data.gyro_x = stof(parts[9]);
-                data.gyro_y = stof(parts[10]);
-                data.gyro_z = stof(parts[11]);
-                
-                if (data_callback_) {
-                    data_callback_(data);
-                }
-                
-                // Log every 50th packet to avoid spam
-                static int packet_count = 0;
-                if (++packet_count % 50 == 0) {
-                    cout << "📊 [" << client_ip << "] Speed: " 
-                         << (data.kalman_speed * 3.6) << " km/h | "
-                         << "GPS: " << data.latitude << ", " << data.longitude 
-                         << " | Accel: " << data.accel_y << " m/s²" << endl;
-                }
-                
-            } catch (const exception& e) {
-                cerr << "❌ Error parsing ADAS_DATA: " << e.what() << endl;
+            if (!parse_adas_fields(parts, data)) {
+                cerr << "❌ Error parsing ADAS_DATA" << endl;
+                return;
+            }
+            
+            if (data_callback_) {
+                data_callback_(data);
+            }
+            
+            // Log every 50th packet to avoid spam
+            static int packet_count = 0;
+            if (++packet_count % 50 == 0) {
+                cout << "📊 [" << client_ip << "] Speed: " 
+                     << (data.kalman_speed * 3.6) << " km/h | "
+                     << "GPS: " << data.latitude << ", " << data.longitude 
+                     << " | Accel: " << data.accel_y << " m/s²" << endl;
             }
         }
         else if (parts[0] == "ADAS_EVENT" && parts.size() >= 6) {
@@ -134,7 +123,30 @@ private:
         }
     }
     
-    vector<string> split(const string& str, char delimiter) {
+    static bool parse_adas_fields(const vector<string>& parts, AdasData& data) {
+        if (parts.size() < 12 || parts[0] != "ADAS_DATA") return false;
+        
+        try {
+            data.timestamp = stoull(parts[1]);
+            data.latitude = stod(parts[2]);
+            data.longitude = stod(parts[3]);
+            data.kalman_speed = stof(parts[4]);
+            data.gps_speed = stof(parts[5]);
+            data.accel_x = stof(parts[6]);
+            data.accel_y = stof(parts[7]);
+            data.accel_z = stof(parts[8]);
+            data.gyro_x = stof(parts[9]);
+            data.gyro_y = stof(parts[10]);
+            data.gyro_z = stof(parts[11]);
+            data.vehicle_id = parts.size() > 12 ? stoull(parts[12]) : 0;
+        } catch (const exception&) {
+            return false;
+        }
+        
+        return true;
+    }
+    
+    static vector<string> split(const string& str, char delimiter) {
         vector<string> tokens;
         stringstream ss(str);
         string token;
@@ -170,6 +182,12 @@ public:
         int opt = 1;
         setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
         
+        // Wake up periodically so stop() is not stuck behind a blocking recvfrom
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 200000;
+        setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        
         struct sockaddr_in server_addr;
         memset(&server_addr, 0, sizeof(server_addr));
         server_addr.sin_family = AF_INET;
@@ -214,6 +232,11 @@ public:
     }
     
     bool is_running() const { return running_; }
+    
+    // Parses one ADAS_DATA line, as sent by the device or recorded to CSV
+    static bool parse_adas_data(const string& message, AdasData& data) {
+        return parse_adas_fields(split(message, ','), data);
+    }
 };
 
 #endif
@@ -0,0 +1,376 @@
+// vision_bench.cpp - HEADLESS LANE PIPELINE BENCHMARK
+//
+// Feeds recorded video through CameraManager's OpenCV path into
+// UltraFastLaneDetector, with no camera or display, and reports per-stage
+// latency, throughput and how steady the detections are.
+//
+// Build (from source/modules):
+//   g++ -std=c++14 -O3 -march=native -o vision_bench vision_bench.cpp camera.cpp $(pkg-config --cflags --libs opencv4) -lpthread
+//
+// Examples:
+//   ./vision_bench drive.mp4
+//   ./vision_bench frames/%05d.png --no-tracking --frames 2000
+//   ./vision_bench drive.mp4 --truth drive_lanes.csv --csv per_frame.csv
+//
+// Image sequences use OpenCV's printf-style patterns. A truth file has one
+// "frame,left_x,right_x" line per labelled frame (bottom-row lane x in
+// pixels, -1 when absent); frames are numbered from 0 per input.
+#include "camera.h"
+#include "lane_detector.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+using namespace chrono;
+
+// Every sample is kept; runs are thousands of frames, not millions
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(const string& name) : name_(name) {}
+
+    void add(double ms) { samples_.push_back(ms); }
+
+    void print() {
+        cout << "  " << left << setw(10) << name_ << right;
+        if (samples_.empty()) {
+            cout << "  (not run)" << endl;
+            return;
+        }
+
+        sort(samples_.begin(), samples_.end());
+        double sum = 0;
+        for (double s : samples_) sum += s;
+
+        cout << fixed << setprecision(3)
+             << "  n=" << setw(6) << samples_.size()
+             << "  mean=" << setw(8) << sum / samples_.size()
+             << "  p50=" << setw(8) << percentile(0.50)
+             << "  p90=" << setw(8) << percentile(0.90)
+             << "  p99=" << setw(8) << percentile(0.99)
+             << "  max=" << setw(8) << samples_.back() << " ms" << endl;
+
+        // Doubling buckets from 0.125 ms
+        static const double bounds[] = {0.125, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64};
+        const int buckets = sizeof(bounds) / sizeof(bounds[0]) + 1;
+        size_t counts[buckets] = {};
+        for (double s : samples_) {
+            int b = 0;
+            while (b < buckets - 1 && s >= bounds[b]) b++;
+            counts[b]++;
+        }
+
+        size_t peak = *max_element(counts, counts + buckets);
+        for (int b = 0; b < buckets; b++) {
+            if (counts[b] == 0) continue;
+            ostringstream label;
+            if (b == buckets - 1) label << ">= " << bounds[b - 1];
+            else label << "< " << bounds[b];
+            cout << "      " << setw(9) << label.str() << " ms " << setw(6) << counts[b] << " "
+                 << string((size_t)ceil(40.0 * counts[b] / peak), '#') << endl;
+        }
+    }
+
+private:
+    string name_;
+    vector<double> samples_;
+
+    double percentile(double q) const {
+        return samples_[(size_t)(q * (samples_.size() - 1))];
+    }
+};
+
+struct Truth {
+    double left_x;
+    double right_x;
+};
+
+// Bottom-most point of the lane with the given id, or -1
+static double laneBottomX(const UFLD_Result& result, int id) {
+    for (const auto& lane : result.lanes) {
+        if (lane.id == id && !lane.points.empty()) return lane.points.back().x;
+    }
+    return -1;
+}
+
+static bool loadTruth(const string& path, map<long, Truth>& truth) {
+    ifstream in(path);
+    if (!in.is_open()) return false;
+
+    string line;
+    while (getline(in, line)) {
+        long frame;
+        Truth t;
+        char c1, c2;
+        istringstream row(line);
+        if (row >> frame >> c1 >> t.left_x >> c2 >> t.right_x) truth[frame] = t;
+    }
+    return !truth.empty();
+}
+
+// Frame-to-frame steadiness of the detector's output
+struct StabilityStats {
+    long frames = 0;
+    long detected = 0;
+    long tracked = 0;
+    long lane_count_changes = 0;
+    long departure_toggles = 0;
+    long departures = 0;
+    double jitter_sum[2] = {0, 0}; // |bottom x change| between consecutive frames
+    long jitter_n[2] = {0, 0};
+
+    double truth_error_sum[2] = {0, 0};
+    long truth_n[2] = {0, 0};
+    long truth_missed[2] = {0, 0}; // lane labelled but not reported
+    long truth_spurious[2] = {0, 0}; // lane reported but labelled absent
+
+    size_t last_lanes = 0;
+    double last_x[2] = {-1, -1};
+    bool last_departure = false;
+
+    void add(const UFLD_Result& result, bool departure) {
+        if (frames > 0) {
+            if (result.lanes.size() != last_lanes) lane_count_changes++;
+            if (departure != last_departure) departure_toggles++;
+        }
+        frames++;
+        if (result.detected) detected++;
+        if (result.tracked) tracked++;
+        if (departure) departures++;
+
+        for (int id = 0; id < 2; id++) {
+            double x = laneBottomX(result, id);
+            if (x >= 0 && last_x[id] >= 0) {
+                jitter_sum[id] += fabs(x - last_x[id]);
+                jitter_n[id]++;
+            }
+            last_x[id] = x;
+        }
+
+        last_lanes = result.lanes.size();
+        last_departure = departure;
+    }
+
+    void addTruth(const UFLD_Result& result, const Truth& truth) {
+        double expected[2] = {truth.left_x, truth.right_x};
+        for (int id = 0; id < 2; id++) {
+            double x = laneBottomX(result, id);
+            if (expected[id] < 0) {
+                if (x >= 0) truth_spurious[id]++;
+            } else if (x < 0) {
+                truth_missed[id]++;
+            } else {
+                truth_error_sum[id] += fabs(x - expected[id]);
+                truth_n[id]++;
+            }
+        }
+    }
+
+    void print(bool have_truth) const {
+        auto pct = [this](long n) { return frames ? 100.0 * n / frames : 0.0; };
+        static const char* names[2] = {"left", "right"};
+
+        cout << fixed << setprecision(1);
+        cout << "  Detected:            " << pct(detected) << "% of frames" << endl;
+        cout << "  Tracked:             " << pct(tracked) << "% of frames" << endl;
+        cout << "  Lane count changes:  " << lane_count_changes << endl;
+        cout << "  Departure warnings:  " << departures << " frames, "
+             << departure_toggles << " toggles" << endl;
+        for (int id = 0; id < 2; id++) {
+            cout << "  " << left << setw(6) << names[id] << right << " jitter:        "
+                 << setprecision(2) << (jitter_n[id] ? jitter_sum[id] / jitter_n[id] : 0.0)
+                 << " px/frame" << setprecision(1) << endl;
+        }
+
+        if (!have_truth) return;
+        for (int id = 0; id < 2; id++) {
+            cout << "  " << left << setw(6) << names[id] << right << " vs truth:      "
+                 << setprecision(2) << (truth_n[id] ? truth_error_sum[id] / truth_n[id] : 0.0)
+                 << " px mean error, " << truth_missed[id] << " missed, "
+                 << truth_spurious[id] << " spurious" << setprecision(1) << endl;
+        }
+    }
+};
+
+static void usage() {
+    cout << "Usage: vision_bench <video | image pattern> [more inputs] [options]" << endl;
+    cout << "  --frames N       stop after N measured frames per input (default all)" << endl;
+    cout << "  --warmup N       frames run before measuring (default 10)" << endl;
+    cout << "  --every N        run lane detection on every Nth frame, like the live" << endl;
+    cout << "                   loop's 2 (default 1)" << endl;
+    cout << "  --no-tracking    full search on every detected frame" << endl;
+    cout << "  --truth PATH     frame,left_x,right_x labels for the (single) input" << endl;
+    cout << "  --csv PATH       per-frame timings and lane positions" << endl;
+}
+
+static double lapMs(steady_clock::time_point& mark) {
+    auto now = steady_clock::now();
+    double ms = duration<double, milli>(now - mark).count();
+    mark = now;
+    return ms;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> inputs;
+    long max_frames = -1;
+    long warmup = 10;
+    int every = 1;
+    bool tracking = true;
+    string truth_path;
+    string csv_path;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--frames" && has_value) max_frames = stol(argv[++i]);
+        else if (arg == "--warmup" && has_value) warmup = stol(argv[++i]);
+        else if (arg == "--every" && has_value) every = max(1, stoi(argv[++i]));
+        else if (arg == "--no-tracking") tracking = false;
+        else if (arg == "--truth" && has_value) truth_path = argv[++i];
+        else if (arg == "--csv" && has_value) csv_path = argv[++i];
+        else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+        else if (arg[0] != '-') inputs.push_back(arg);
+        else { usage(); return 1; }
+    }
+
+    if (inputs.empty()) {
+        usage();
+        return 1;
+    }
+
+    map<long, Truth> truth;
+    if (!truth_path.empty()) {
+        if (inputs.size() != 1 || !loadTruth(truth_path, truth)) {
+            cerr << "❌ --truth needs one input and a non-empty " << truth_path << endl;
+            return 1;
+        }
+    }
+
+    ofstream csv;
+    if (!csv_path.empty()) {
+        csv.open(csv_path);
+        csv << "input,frame,decode_ms,roi_ms,canny_ms,hough_ms,track_ms,departure_ms,draw_ms,"
+               "tracked,lanes,left_x,right_x" << endl;
+    }
+
+    LatencyHistogram decode_h("decode"), roi_h("roi"), canny_h("canny"), hough_h("hough"),
+        track_h("track"), detect_h("detect"), departure_h("departure"), draw_h("draw"),
+        frame_h("frame");
+    StabilityStats stability;
+    long measured = 0;
+    double measured_ms = 0;
+
+    UltraFastLaneDetector detector;
+    detector.initialize();
+    UFLD_Result result;
+
+    for (size_t input = 0; input < inputs.size(); input++) {
+        CameraManager camera;
+        if (!camera.initialize(inputs[input], 1280, 720, 30, CameraManager::CAMERA_OPENCV)) {
+            cerr << "❌ Cannot open " << inputs[input] << endl;
+            return 1;
+        }
+        detector.setTracking(tracking); // fresh tracks per input
+
+        Mat frame;
+        long frame_index = -1;
+        long input_measured = 0;
+        auto input_start = steady_clock::now();
+
+        while (max_frames < 0 || input_measured < max_frames) {
+            auto mark = steady_clock::now();
+            auto frame_start = mark;
+            if (!camera.grabFrame(frame)) break;
+            double decode_ms = lapMs(mark);
+            frame_index++;
+
+            bool run_detection = frame_index % every == 0;
+            double departure_ms = 0, draw_ms = 0;
+            bool departure = false;
+
+            if (run_detection) {
+                detector.detectLanes(frame, result);
+                lapMs(mark);
+
+                string direction;
+                double deviation;
+                departure = detector.checkLaneDeparture(result, frame, direction, deviation);
+                departure_ms = lapMs(mark);
+
+                detector.drawLanes(frame, result, true);
+                if (departure) detector.drawDepartureWarning(frame, direction, deviation, true);
+                draw_ms = lapMs(mark);
+            }
+            double frame_ms = duration<double, milli>(steady_clock::now() - frame_start).count();
+
+            if (frame_index < warmup) continue;
+            input_measured++;
+            measured++;
+            measured_ms += frame_ms;
+
+            decode_h.add(decode_ms);
+            frame_h.add(frame_ms);
+            if (!run_detection) continue;
+
+            const UFLD_StageTimes& st = result.stages;
+            detect_h.add(result.inference_time);
+            departure_h.add(departure_ms);
+            draw_h.add(draw_ms);
+            if (result.tracked) {
+                track_h.add(st.track);
+            } else {
+                roi_h.add(st.roi);
+                canny_h.add(st.canny);
+                hough_h.add(st.hough);
+                if (st.track > 0) track_h.add(st.track); // band search fell through
+            }
+
+            stability.add(result, departure);
+            auto t = truth.find(frame_index);
+            if (t != truth.end()) stability.addTruth(result, t->second);
+
+            if (csv.is_open()) {
+                csv << input << "," << frame_index << "," << decode_ms << "," << st.roi << ","
+                    << st.canny << "," << st.hough << "," << st.track << "," << departure_ms << ","
+                    << draw_ms << "," << (result.tracked ? 1 : 0) << "," << result.lanes.size() << ","
+                    << laneBottomX(result, 0) << "," << laneBottomX(result, 1) << endl;
+            }
+        }
+
+        double input_s = duration<double>(steady_clock::now() - input_start).count();
+        cout << inputs[input] << ": " << frame_index + 1 << " frames in " << fixed
+             << setprecision(2) << input_s << " s" << endl;
+        camera.release();
+    }
+
+    if (measured == 0) {
+        cerr << "❌ No frames measured (inputs shorter than --warmup?)" << endl;
+        return 1;
+    }
+
+    cout << endl << "=== Vision pipeline (" << measured << " frames, tracking "
+         << (tracking ? "on" : "off") << ", detect every " << every << ") ===" << endl;
+    cout << fixed << setprecision(1) << "  Throughput: " << measured * 1000.0 / measured_ms
+         << " frames/s (decode + lanes + draw, single thread)" << endl;
+
+    cout << endl << "Latency per stage:" << endl;
+    for (LatencyHistogram* h : {&decode_h, &roi_h, &canny_h, &hough_h, &track_h, &detect_h,
+                                &departure_h, &draw_h, &frame_h}) {
+        h->print();
+    }
+
+    cout << endl << "Stability:" << endl;
+    stability.print(!truth.empty());
+
+    return 0;
+}
@@ -22,6 +22,7 @@
 #include "LocationManager.h"
 #include "../core/DatabaseManager.h"
 #include "../core/TripManager.h"
+#include "../core/GeofenceManager.h"
 #include "../core/VehicleManager.h"
 #include "../core/CacheManager.h"
 #include "../core/IndexManager.h"
@@ -151,6 +152,10 @@ private:
     TripManager *trip_manager = nullptr;
     VehicleManager *vehicle_manager = nullptr;
 
+    // Checked on every GPS fix from this device, trip or not, so it is not
+    // attached to trip_manager (that would report each transition twice)
+    GeofenceManager geofences;
+
     // Active trip tracking
     uint64_t current_trip_id = 0;
     double current_trip_start_lat = 0;
@@ -385,6 +390,12 @@ public:
 
             // Initialize trip and vehicle managers
             trip_manager = new TripManager(*db_manager, *cache_manager, *index_manager);
+            trip_manager->start_gps_ingest();
+
+            geofences.load_from_file("compiled/geofences.csv");
+            geofences.set_event_callback([this](const GeofenceEvent &ev)
+                                         { broadcast_geofence_event(ev); });
+            cout << "✓ Geofences loaded (" << geofences.fence_count() << ")" << endl;
             vehicle_manager = new VehicleManager(*db_manager, *cache_manager, *index_manager);
 
             cout << "✓ Database managers initialized" << endl;
@@ -666,6 +677,8 @@ private:
                            (live_data.lane_departures.load() * 3.0);
             live_data.safety_score = max(0.0, min(1000.0, score));
 
+            geofences.update_position(0, latitude, longitude, timestamp);
+
             // Log GPS point if trip is active
             if (live_data.trip_active.load() && trip_manager && current_trip_id > 0)
             {
@@ -1313,6 +1326,27 @@ private:
         broadcast_message(warning.dump());
     }
 
+    void broadcast_geofence_event(const GeofenceEvent &ev)
+    {
+        string name;
+        geofences.get_fence_name(ev.fence_id, name);
+
+        json data_obj = json::object();
+        data_obj["fence_id"] = ev.fence_id;
+        data_obj["fence_name"] = name;
+        data_obj["fence_type"] = (int)ev.type;
+        data_obj["event"] = ev.entered ? "enter" : "exit";
+        data_obj["latitude"] = ev.latitude;
+        data_obj["longitude"] = ev.longitude;
+        data_obj["timestamp"] = time(nullptr);
+
+        json message = json::object();
+        message["type"] = "geofence";
+        message["data"] = data_obj;
+
+        broadcast_message(message.dump());
+    }
+
     void send_message(connection_hdl hdl, const string &msg)
     {
         try
@@ -1,5 +1,5 @@
 // websocket_bridge_udp.cpp - WebSocket bridge with UDP ADAS receiver
-// Compile: g++ -std=c++17 websocket_bridge_udp.cpp -o websocket_bridge -pthread -lwebsockets
+// Compile: g++ -std=c++17 websocket_bridge_udp.cpp -o websocket_bridge -pthread -lwebsockets -lcrypto
 
 #include <libwebsockets.h>
 #include <thread>
@@ -10,7 +10,14 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <memory>
+#include <map>
+#include <vector>
+#include <unordered_map>
 #include "udp_receiver.h"
+#include "ImuEventDetector.h"
+#include "CrashRecorder.h"
+#include "../../include/sdm_config.hpp"
 
 using namespace std;
 
@@ -26,6 +33,177 @@ atomic<bool> running(true);
 // UDP Receiver
 UDPReceiver* udp_receiver = nullptr;
 
+// Runs on the UDP receive thread only
+ImuEventDetector imu_detector;
+
+// Talks to the SDM server's request API. The server is the only process
+// that writes the database, so the bridge asks it for trip context and has
+// it file crash incidents. Logs in as the configured admin.
+class ServerClient {
+private:
+    string host_;
+    uint16_t port_;
+    string username_;
+    string password_;
+    mutex mtx_;
+    string session_id_;
+
+    // One HTTP POST; the server answers once and closes the connection
+    bool post(const string& body, string& response) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+
+        struct timeval timeout;
+        timeout.tv_sec = 2;
+        timeout.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port_);
+        inet_pton(AF_INET, host_.c_str(), &addr.sin_addr);
+
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return false;
+        }
+
+        // The server reads a request with a single recv, so send it whole
+        string request = "POST / HTTP/1.1\r\n"
+                         "Host: " + host_ + "\r\n"
+                         "Content-Type: application/json\r\n"
+                         "Content-Length: " + to_string(body.size()) + "\r\n"
+                         "\r\n" + body;
+        if (send(fd, request.data(), request.size(), 0) != (ssize_t)request.size()) {
+            close(fd);
+            return false;
+        }
+
+        string reply;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            reply.append(buffer, n);
+        }
+        close(fd);
+
+        size_t body_start = reply.find("\r\n\r\n");
+        if (body_start == string::npos) return false;
+        response = reply.substr(body_start + 4);
+        return true;
+    }
+
+    bool login_locked() {
+        string response;
+        string body = "{\"operation\":\"user_login\",\"username\":\"" + username_ +
+                      "\",\"password\":\"" + password_ + "\"}";
+        if (!post(body, response) || field(response, "status") != "success") {
+            return false;
+        }
+        session_id_ = field(response, "session_id");
+        return !session_id_.empty();
+    }
+
+public:
+    ServerClient(const string& host, uint16_t port, const string& username,
+                 const string& password)
+        : host_(host), port_(port), username_(username), password_(password) {}
+
+    // String value of "key" anywhere in a flat server response
+    static string field(const string& json, const string& key) {
+        string marker = "\"" + key + "\":\"";
+        size_t start = json.find(marker);
+        if (start == string::npos) return "";
+        start += marker.size();
+        size_t end = json.find('"', start);
+        return end == string::npos ? "" : json.substr(start, end - start);
+    }
+
+    static uint64_t id_field(const string& json, const string& key) {
+        string value = field(json, key);
+        return value.empty() ? 0 : strtoull(value.c_str(), nullptr, 10);
+    }
+
+    // True on a success response. Logs in first, and again once if the
+    // session has expired.
+    bool request(const string& operation, const map<string, string>& params,
+                 string& response) {
+        lock_guard<mutex> lock(mtx_);
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (session_id_.empty() && !login_locked()) return false;
+
+            string body = "{\"operation\":\"" + operation + "\",\"session_id\":\"" + session_id_ + "\"";
+            for (const auto& param : params) {
+                body += ",\"" + param.first + "\":\"" + param.second + "\"";
+            }
+            body += "}";
+
+            if (!post(body, response)) return false;
+            if (field(response, "status") == "success") return true;
+            if (field(response, "code") != "UNAUTHORIZED") return false;
+            session_id_.clear();
+        }
+        return false;
+    }
+};
+
+unique_ptr<ServerClient> server_client;
+
+// Pre/post-impact telemetry, one ring per vehicle. Created in main; captures
+// are filed as incidents by the server.
+unique_ptr<CrashRecorder> crash_recorder;
+
+// UDP receive thread only; saves taking the recorder's registry lock
+unordered_map<uint64_t, TelemetryRing*> telemetry_rings;
+
+// Vehicles seen on the UDP stream, for the context thread
+mutex vehicles_mutex;
+vector<uint64_t> seen_vehicles;
+
+static const int CONTEXT_REFRESH_MS = 5000;
+
+TelemetryRing* telemetry_ring_for(uint64_t vehicle_id) {
+    auto it = telemetry_rings.find(vehicle_id);
+    if (it != telemetry_rings.end()) return it->second;
+
+    TelemetryRing* ring = crash_recorder->ring(vehicle_id);
+    telemetry_rings[vehicle_id] = ring;
+    {
+        lock_guard<mutex> lock(vehicles_mutex);
+        seen_vehicles.push_back(vehicle_id);
+    }
+    return ring;
+}
+
+// Keeps each ring's driver and trip in step with the server's active trips,
+// so captures carry them. Network calls stay off the UDP thread.
+void context_thread() {
+    while (running) {
+        vector<uint64_t> vehicles;
+        {
+            lock_guard<mutex> lock(vehicles_mutex);
+            vehicles = seen_vehicles;
+        }
+
+        for (uint64_t vehicle_id : vehicles) {
+            string response;
+            uint64_t driver_id = 0, trip_id = 0;
+            if (server_client->request("trip_get_active",
+                                       {{"vehicle_id", to_string(vehicle_id)}}, response)) {
+                driver_id = ServerClient::id_field(response, "driver_id");
+                trip_id = ServerClient::id_field(response, "trip_id");
+            }
+            crash_recorder->ring(vehicle_id)->set_context(driver_id, trip_id);
+        }
+
+        for (int waited = 0; running && waited < CONTEXT_REFRESH_MS; waited += 100) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+    }
+}
+
 // Convert ADAS data to JSON for WebSocket
 string adas_data_to_json(const AdasData& data) {
     ostringstream oss;
@@ -169,6 +347,33 @@ int main() {
     cout << "  SMART DRIVE WEBSOCKET BRIDGE WITH UDP" << endl;
     cout << "═══════════════════════════════════════════════" << endl;
     
+    // The server's port and admin account, for filing crash incidents
+    SDMConfig config;
+    if (!config.load_from_file("../../include/sdm.conf")) {
+        config.load_from_file("../include/sdm.conf");
+    }
+    server_client.reset(new ServerClient("127.0.0.1", config.port,
+                                         config.admin_username, config.admin_password));
+    
+    crash_recorder.reset(new CrashRecorder("compiled/crash_captures.bin",
+        [](uint64_t capture_id, const CrashCaptureHeader& header, double latitude,
+           double longitude, const string& description) -> uint64_t {
+            string response;
+            if (!server_client->request("incident_file_crash",
+                                        {{"vehicle_id", to_string(header.vehicle_id)},
+                                         {"driver_id", to_string(header.driver_id)},
+                                         {"trip_id", to_string(header.trip_id)},
+                                         {"capture_id", to_string(capture_id)},
+                                         {"latitude", to_string(latitude)},
+                                         {"longitude", to_string(longitude)},
+                                         {"description", description}},
+                                        response)) {
+                cerr << "⚠ Server did not file an incident for crash capture " << capture_id << endl;
+                return 0;
+            }
+            return ServerClient::id_field(response, "incident_id");
+        }));
+    
     // Start UDP receiver
     udp_receiver = new UDPReceiver(5555);
     
@@ -176,6 +381,19 @@ int main() {
     udp_receiver->set_data_callback([](const AdasData& data) {
         string json = adas_data_to_json(data);
         broadcast_message(json);
+        
+        // Server-side detection from the raw IMU stream
+        ImuEvent events[IMU_EVENT_TYPES];
+        TelemetryRing* telemetry_ring = telemetry_ring_for(data.vehicle_id);
+        telemetry_ring->push(data);
+        size_t count = imu_detector.process(data.vehicle_id, data, events, IMU_EVENT_TYPES);
+        for (size_t i = 0; i < count; i++) {
+            broadcast_message(adas_event_to_json(ImuEventDetector::to_adas_event(events[i])));
+            if (events[i].type == ImuEventType::IMPACT) {
+                telemetry_ring->trigger(events[i]);
+                cout << "🚨🚨🚨 CRITICAL EVENT: IMPACT " << events[i].peak << " m/s² 🚨🚨🚨" << endl;
+            }
+        }
     });
     
     // Set callback for ADAS events
@@ -189,9 +407,18 @@ int main() {
         }
     });
     
+    crash_recorder->set_capture_callback([](uint64_t capture_id, const CrashCaptureHeader& header) {
+        cout << "💾 Crash capture " << capture_id << " saved (" << header.sample_count
+             << " samples";
+        if (header.incident_id) cout << ", incident " << header.incident_id;
+        cout << ")" << endl;
+    });
+    crash_recorder->start();
+    
     if (!udp_receiver->start()) {
         cerr << "❌ Failed to start UDP receiver" << endl;
         delete udp_receiver;
+        crash_recorder.reset();
         return 1;
     }
     
@@ -200,10 +427,12 @@ int main() {
     cout << "   1. Open MainActivity.kt" << endl;
     cout << "   2. Set UDP_SERVER_IP to your computer's IP" << endl;
     cout << "   3. Set UDP_PORT to 5555" << endl;
+    cout << "   4. Append the vehicle id to each ADAS_DATA packet" << endl;
     cout << endl;
     
     // Start WebSocket server
     thread ws_thread(websocket_thread);
+    thread trip_context_thread(context_thread);
     
     cout << "✅ System ready. Press Ctrl+C to stop." << endl;
     
@@ -212,8 +441,11 @@ int main() {
     
     // Cleanup
     running = false;
+    trip_context_thread.join();
     udp_receiver->stop();
     delete udp_receiver;
+    crash_recorder.reset();  // stops its thread before the server client goes
+    server_client.reset();
     
     cout << "👋 Shutdown complete" << endl;
     
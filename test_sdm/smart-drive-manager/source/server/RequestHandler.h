@@ -149,6 +149,7 @@ private:
         result["location_address"] = string(incident.location_address);
         result["description"] = string(incident.description);
         result["is_resolved"] = to_string(incident.is_resolved);
+        result["telemetry_capture_id"] = to_string(incident.telemetry_capture_id);
         return result;
     }
 
@@ -408,6 +409,35 @@ public:
 
             return response_builder_.success_with_array("TRIP_HISTORY", "trips", trip_maps);
         }
+        else if (operation == "trip_get_map_points")
+        {
+            // Points of every driver's trips
+            if (driver.role == UserRole::DRIVER)
+            {
+                return response_builder_.error("PERMISSION_DENIED",
+                                               "Fleet map points require an admin or fleet manager");
+            }
+
+            double min_lat = stod(SimpleJSON::get_value(params, "min_lat", "0"));
+            double min_lon = stod(SimpleJSON::get_value(params, "min_lon", "0"));
+            double max_lat = stod(SimpleJSON::get_value(params, "max_lat", "0"));
+            double max_lon = stod(SimpleJSON::get_value(params, "max_lon", "0"));
+            int limit = stoi(SimpleJSON::get_value(params, "limit", "500"));
+
+            auto points = trip_mgr_.get_trip_points_in_area(min_lat, min_lon, max_lat, max_lon,
+                                                            limit > 0 ? limit : 500);
+
+            vector<map<string, string>> point_maps;
+            for (const auto &point : points)
+            {
+                point_maps.push_back({{"kind", to_string((int)point.kind)},
+                                      {"trip_id", to_string(point.entity_id)},
+                                      {"latitude", to_string(point.latitude)},
+                                      {"longitude", to_string(point.longitude)}});
+            }
+
+            return response_builder_.success_with_array("TRIP_MAP_POINTS", "points", point_maps);
+        }
         else if (operation == "trip_get_statistics")
         {
             auto stats = trip_mgr_.get_driver_statistics(driver.driver_id);
@@ -417,6 +447,82 @@ public:
                                                                  {"avg_speed", to_string(stats.avg_speed)},
                                                                  {"safety_score", to_string(stats.safety_score)}});
         }
+        else if (operation == "trip_get_active")
+        {
+            if (driver.role == UserRole::DRIVER)
+            {
+                return response_builder_.error("PERMISSION_DENIED",
+                                               "Active trip lookup requires an admin or fleet manager");
+            }
+
+            uint64_t vehicle_id = stoull(SimpleJSON::get_value(params, "vehicle_id", "0"));
+            uint64_t trip_id = 0, driver_id = 0;
+            if (!trip_mgr_.get_active_trip(vehicle_id, trip_id, driver_id))
+            {
+                return response_builder_.error("NO_ACTIVE_TRIP",
+                                               "Vehicle has no trip in progress");
+            }
+
+            return response_builder_.success("TRIP_ACTIVE", {{"vehicle_id", to_string(vehicle_id)},
+                                                             {"trip_id", to_string(trip_id)},
+                                                             {"driver_id", to_string(driver_id)}});
+        }
+        else if (operation == "trip_get_vehicle_statistics")
+        {
+            uint64_t vehicle_id = stoull(SimpleJSON::get_value(params, "vehicle_id", "0"));
+            uint64_t start_time = stoull(SimpleJSON::get_value(params, "start_time", "0"));
+            uint64_t end_time = stoull(SimpleJSON::get_value(params, "end_time",
+                                                             to_string(get_current_timestamp())));
+
+            // Drivers may only see vehicles they own
+            if (driver.role == UserRole::DRIVER)
+            {
+                VehicleInfo vehicle;
+                if (!vehicle_mgr_.get_vehicle(vehicle_id, vehicle) ||
+                    vehicle.owner_driver_id != driver.driver_id)
+                {
+                    return response_builder_.error("PERMISSION_DENIED",
+                                                   "Vehicle statistics are limited to your own vehicles");
+                }
+            }
+
+            auto stats = trip_mgr_.get_vehicle_statistics(vehicle_id, start_time, end_time);
+
+            return response_builder_.success("VEHICLE_TRIP_STATISTICS", {{"vehicle_id", to_string(vehicle_id)},
+                                                                         {"total_trips", to_string(stats.total_trips)},
+                                                                         {"total_distance", to_string(stats.total_distance)},
+                                                                         {"total_fuel", to_string(stats.total_fuel)},
+                                                                         {"avg_speed", to_string(stats.avg_speed)},
+                                                                         {"max_speed", to_string(stats.max_speed)},
+                                                                         {"total_harsh_events", to_string(stats.total_harsh_events)}});
+        }
+        else if (operation == "trip_get_fleet_statistics")
+        {
+            if (driver.role == UserRole::DRIVER)
+            {
+                return response_builder_.error("PERMISSION_DENIED",
+                                               "Fleet statistics require an admin or fleet manager");
+            }
+
+            uint64_t start_time = stoull(SimpleJSON::get_value(params, "start_time", "0"));
+            uint64_t end_time = stoull(SimpleJSON::get_value(params, "end_time",
+                                                             to_string(get_current_timestamp())));
+
+            auto stats = trip_mgr_.get_fleet_statistics(start_time, end_time);
+            auto distribution = trip_mgr_.get_fleet_distribution(start_time, end_time);
+
+            return response_builder_.success("FLEET_STATISTICS", {{"total_trips", to_string(stats.total_trips)},
+                                                                  {"total_distance", to_string(stats.total_distance)},
+                                                                  {"total_fuel", to_string(stats.total_fuel)},
+                                                                  {"avg_speed", to_string(stats.avg_speed)},
+                                                                  {"total_harsh_events", to_string(stats.total_harsh_events)},
+                                                                  {"speed_p50", to_string(distribution.speed_p50)},
+                                                                  {"speed_p95", to_string(distribution.speed_p95)},
+                                                                  {"duration_p50", to_string(distribution.duration_p50)},
+                                                                  {"duration_p95", to_string(distribution.duration_p95)},
+                                                                  {"active_drivers", to_string(distribution.active_drivers)},
+                                                                  {"active_vehicles", to_string(distribution.active_vehicles)}});
+        }
 
         return response_builder_.error("UNKNOWN_OPERATION",
                                        "Unknown trip operation: " + operation);
@@ -815,6 +921,46 @@ public:
                                                "Failed to report incident");
             }
         }
+        else if (operation == "incident_file_crash")
+        {
+            // Filed by the UDP bridge for its crash captures, so this process
+            // stays the only writer of the incident table
+            if (driver.role == UserRole::DRIVER)
+            {
+                return response_builder_.error("PERMISSION_DENIED",
+                                               "Crash filing requires an admin or fleet manager");
+            }
+
+            uint64_t vehicle_id = stoull(SimpleJSON::get_value(params, "vehicle_id", "0"));
+            uint64_t crash_driver = stoull(SimpleJSON::get_value(params, "driver_id", "0"));
+            uint64_t trip_id = stoull(SimpleJSON::get_value(params, "trip_id", "0"));
+            uint64_t capture_id = stoull(SimpleJSON::get_value(params, "capture_id", "0"));
+            double lat = stod(SimpleJSON::get_value(params, "latitude", "0"));
+            double lon = stod(SimpleJSON::get_value(params, "longitude", "0"));
+            string description = SimpleJSON::get_value(params, "description");
+
+            // The bridge may not have learned the trip yet
+            if (trip_id == 0)
+            {
+                trip_mgr_.get_active_trip(vehicle_id, trip_id, crash_driver);
+            }
+
+            uint64_t incident_id = incident_mgr_.report_incident(
+                crash_driver, vehicle_id, IncidentType::ACCIDENT, lat, lon, "",
+                description, trip_id, capture_id);
+
+            if (incident_id > 0)
+            {
+                return response_builder_.success("INCIDENT_REPORTED", {{"incident_id", to_string(incident_id)},
+                                                                       {"driver_id", to_string(crash_driver)},
+                                                                       {"trip_id", to_string(trip_id)}});
+            }
+            else
+            {
+                return response_builder_.error("INCIDENT_REPORT_FAILED",
+                                               "Failed to file crash incident");
+            }
+        }
         else if (operation == "incident_get_list")
         {
             auto incidents = incident_mgr_.get_driver_incidents(driver.driver_id);
@@ -827,6 +973,29 @@ public:
 
             return response_builder_.success_with_array("INCIDENT_LIST", "incidents", incident_maps);
         }
+        else if (operation == "incident_get_nearby")
+        {
+            // Incidents of every driver
+            if (driver.role == UserRole::DRIVER)
+            {
+                return response_builder_.error("PERMISSION_DENIED",
+                                               "Nearby incident lookup requires an admin or fleet manager");
+            }
+
+            double lat = stod(SimpleJSON::get_value(params, "latitude", "0"));
+            double lon = stod(SimpleJSON::get_value(params, "longitude", "0"));
+            int limit = stoi(SimpleJSON::get_value(params, "limit", "10"));
+
+            auto incidents = incident_mgr_.get_incidents_near(lat, lon, limit > 0 ? limit : 10);
+
+            vector<map<string, string>> incident_maps;
+            for (const auto &incident : incidents)
+            {
+                incident_maps.push_back(incident_to_map(incident));
+            }
+
+            return response_builder_.success_with_array("INCIDENT_NEARBY", "incidents", incident_maps);
+        }
         else if (operation == "incident_get_statistics")
         {
             auto stats = incident_mgr_.get_incident_statistics(driver.driver_id);
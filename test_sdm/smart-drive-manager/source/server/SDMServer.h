@@ -17,6 +17,8 @@
 #include "../../source/core/ExpenseManager.h"
 #include "../../source/core/DriverManager.h"
 #include "../../source/core/IncidentManager.h"
+#include "../../source/core/GeofenceManager.h"
+#include "../../source/core/ReverseGeocoder.h"
 
 #include "RequestHandler.h"
 #include "ResponseBuilder.h"
@@ -56,6 +58,11 @@ private:
     ExpenseManager *expense_manager_;
     DriverManager *driver_manager_;
     IncidentManager *incident_manager_;
+    GeofenceManager *geofence_manager_;
+    ReverseGeocoder *geocoder_;
+    RollupManager *rollup_manager_;
+    ExpiryIndex *expiry_index_;
+    ExpiryScheduler *expiry_scheduler_;
 
     RequestHandler *request_handler_;
 
@@ -75,6 +82,9 @@ public:
           vehicle_manager_(nullptr), expense_manager_(nullptr),
           driver_manager_(nullptr),
           incident_manager_(nullptr),
+          geofence_manager_(nullptr),
+          geocoder_(nullptr), rollup_manager_(nullptr),
+          expiry_index_(nullptr), expiry_scheduler_(nullptr),
           request_handler_(nullptr),
           total_requests_(0), total_errors_(0), rejected_requests_(0)
     {
@@ -155,7 +165,63 @@ public:
         driver_manager_ = new DriverManager(*db_manager_, *cache_manager_,
                                             *index_manager_);
 
-        incident_manager_ = new IncidentManager(*db_manager_, *cache_manager_);
+        incident_manager_ = new IncidentManager(*db_manager_, *cache_manager_, *index_manager_);
+
+        DriverLeaderboard &leaderboard = driver_manager_->leaderboard();
+        session_manager_->set_leaderboard(&leaderboard);
+        trip_manager_->set_leaderboard(&leaderboard);
+        incident_manager_->set_leaderboard(&leaderboard);
+
+        // Fences live next to the database: <db dir>/geofences.csv
+        geofence_manager_ = new GeofenceManager();
+        string db_dir = config_.database_path.substr(0, config_.database_path.find_last_of('/') + 1);
+        geofence_manager_->load_from_file(db_dir + "geofences.csv");
+        geofence_manager_->set_event_callback([](const GeofenceEvent &ev)
+                                              { cout << "[GEOFENCE] Vehicle " << ev.vehicle_id
+                                                     << (ev.entered ? " entered " : " left ")
+                                                     << "fence " << ev.fence_id << endl; });
+        trip_manager_->set_geofences(geofence_manager_);
+        cout << "    ✓ Geofences loaded (" << geofence_manager_->fence_count() << ")" << endl;
+
+        // Optional offline place index: <db dir>/places.geo (see modules/geocode.cpp)
+        geocoder_ = new ReverseGeocoder();
+        if (geocoder_->open(db_dir + "places.geo"))
+        {
+            trip_manager_->set_geocoder(geocoder_);
+            incident_manager_->set_geocoder(geocoder_);
+            cout << "    ✓ Reverse geocoder loaded (" << geocoder_->place_count() << " places)" << endl;
+        }
+
+        // Daily trip/expense rollups: <db>.rollup, backfilled on first start
+        rollup_manager_ = new RollupManager(config_.database_path + ".rollup");
+        bool rollups_existed = false;
+        if (rollup_manager_->open(rollups_existed))
+        {
+            if (!rollups_existed)
+            {
+                rollup_manager_->rebuild(*db_manager_);
+            }
+            else
+            {
+                rollup_manager_->rebuild_sketches(*db_manager_);
+            }
+            trip_manager_->set_rollups(rollup_manager_);
+            expense_manager_->set_rollups(rollup_manager_);
+            cout << "    ✓ Rollups loaded (" << rollup_manager_->owner_count() << " drivers/vehicles)" << endl;
+        }
+
+        // Licenses, insurance, registrations and documents by expiry date
+        expiry_index_ = new ExpiryIndex();
+        expiry_index_->rebuild(*db_manager_);
+        driver_manager_->set_expiry_index(expiry_index_);
+        vehicle_manager_->set_expiry_index(expiry_index_);
+        expiry_scheduler_ = new ExpiryScheduler(*expiry_index_);
+        expiry_scheduler_->set_callback([](const ExpiryScheduler::Alert &alert)
+                                        { cout << "[EXPIRY] " << expiry_kind_name(alert.entry.kind) << ": "
+                                               << alert.entry.label << " (driver " << alert.entry.owner_id << ") "
+                                               << (alert.days_until_expiry < 0 ? "expired" : "in " + to_string(alert.days_until_expiry) + " days")
+                                               << endl; });
+        cout << "    ✓ Expiry index loaded (" << expiry_index_->size() << " dates)" << endl;
 
         cout << "    ✓ Feature modules initialized" << endl;
 
@@ -212,6 +278,7 @@ public:
         {
             cerr << "ERROR: Failed to set socket options" << endl;
             close(server_socket_);
+            server_socket_ = -1;
             return false;
         }
 
@@ -224,6 +291,7 @@ public:
         {
             cerr << "ERROR: Failed to bind socket to port " << config_.port << endl;
             close(server_socket_);
+            server_socket_ = -1;
             return false;
         }
 
@@ -231,11 +299,15 @@ public:
         {
             cerr << "ERROR: Failed to listen on socket" << endl;
             close(server_socket_);
+            server_socket_ = -1;
             return false;
         }
 
         running_ = true;
 
+        trip_manager_->start_gps_ingest();
+        expiry_scheduler_->start();
+
         cout << "Starting " << config_.worker_threads << " worker threads..." << endl;
         for (int i = 0; i < config_.worker_threads; i++)
         {
@@ -261,27 +333,36 @@ public:
         return true;
     }
 
+    // Only flags the server to stop and wakes the listener, so it is safe
+    // to call from a signal handler; stop() does the joining
+    void request_shutdown()
+    {
+        running_ = false;
+        if (server_socket_ >= 0)
+        {
+            shutdown(server_socket_, SHUT_RDWR);
+        }
+    }
+
     void stop()
     {
-        if (!running_)
+        // A shutdown request clears running_ but leaves the socket open
+        if (server_socket_ < 0)
             return;
 
         cout << endl;
         cout << "Shutting down server..." << endl;
 
-        running_ = false;
-
-        if (server_socket_ >= 0)
-        {
-            close(server_socket_);
-            server_socket_ = -1;
-        }
+        request_shutdown();
 
         if (listener_thread_.joinable())
         {
             listener_thread_.join();
         }
 
+        close(server_socket_);
+        server_socket_ = -1;
+
         for (auto &thread : worker_threads_)
         {
             if (thread.joinable())
@@ -292,6 +373,9 @@ public:
 
         worker_threads_.clear();
 
+        trip_manager_->stop_gps_ingest();
+        expiry_scheduler_->stop();
+
         print_statistics();
 
         cout << "Server stopped successfully." << endl;
@@ -492,12 +576,18 @@ private:
         
         delete incident_manager_;
         
-        delete driver_manager_;
         delete expense_manager_;
         delete vehicle_manager_;
         delete trip_manager_;
+        delete geofence_manager_;
+        delete geocoder_;
+        delete rollup_manager_;
+        delete expiry_scheduler_;
+        delete expiry_index_;
         
         delete session_manager_;
+        // Owns the leaderboard the trip, incident and session managers point at
+        delete driver_manager_;
         delete security_manager_;
         delete index_manager_;
         delete cache_manager_;
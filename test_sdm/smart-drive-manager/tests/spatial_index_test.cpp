@@ -0,0 +1,142 @@
+// spatial_index_test.cpp - SpatialIndex::nearest against brute force
+//
+// Build and run (from tests):
+//   g++ -std=c++14 -O2 -o spatial_index_test spatial_index_test.cpp -lpthread -lcrypto && ./spatial_index_test
+//
+// Exits non-zero on the first mismatch. Points cluster near the poles and
+// on both sides of the antimeridian, where a flat lat/lon box misses
+// neighbours.
+
+#include "../source/core/SpatialIndex.h"
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+
+struct Point
+{
+    uint64_t id;
+    double lat, lon;
+};
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (!ok)
+    {
+        cerr << "FAIL: " << what << endl;
+        failures++;
+    }
+}
+
+// Compares the k nearest distances; ids may differ only on exact ties
+static void check_nearest(SpatialIndex &index, const vector<Point> &points,
+                          double lat, double lon, size_t k, const string &label)
+{
+    vector<double> expected;
+    for (const auto &p : points)
+        expected.push_back(GeoMath::haversine_km(lat, lon, p.lat, p.lon));
+    sort(expected.begin(), expected.end());
+    if (expected.size() > k)
+        expected.resize(k);
+
+    vector<SpatialHit> hits = index.nearest(lat, lon, k);
+    check(hits.size() == expected.size(), label + ": result count");
+    for (size_t i = 0; i < hits.size() && i < expected.size(); i++)
+    {
+        if (fabs(hits[i].distance_km - expected[i]) > 1e-3)
+        {
+            check(false, label + ": neighbour " + to_string(i) + " at " +
+                             to_string(hits[i].distance_km) + " km, expected " +
+                             to_string(expected[i]) + " km");
+            break;
+        }
+    }
+}
+
+int main()
+{
+    char dir[] = "/tmp/spatial_index_testXXXXXX";
+    if (!mkdtemp(dir))
+    {
+        cerr << "cannot create temp dir" << endl;
+        return 1;
+    }
+    string filename = string(dir) + "/spatial.idx";
+
+    SpatialIndex index(filename);
+    if (!index.create())
+    {
+        cerr << "cannot create index" << endl;
+        return 1;
+    }
+
+    mt19937 rng(7);
+    uniform_real_distribution<double> unit(0, 1);
+    vector<Point> points;
+    uint64_t next_id = 1;
+
+    auto add = [&](double lat, double lon)
+    {
+        Point p{next_id++, lat, lon};
+        points.push_back(p);
+        check(index.insert(SpatialKind::INCIDENT, p.id, lat, lon), "insert");
+    };
+
+    // Around the north pole, all longitudes
+    for (int i = 0; i < 300; i++)
+        add(89.0 + unit(rng), -180 + 360 * unit(rng));
+    // Around the south pole
+    for (int i = 0; i < 300; i++)
+        add(-89.0 - unit(rng), -180 + 360 * unit(rng));
+    // Straddling the antimeridian near Fiji
+    for (int i = 0; i < 300; i++)
+        add(-18 + 2 * unit(rng), 179 + 0.99 * unit(rng));
+    for (int i = 0; i < 300; i++)
+        add(-18 + 2 * unit(rng), -180 + 0.99 * unit(rng));
+    // High latitude, away from the pole and the antimeridian
+    for (int i = 0; i < 300; i++)
+        add(78 + unit(rng), 15 + 2 * unit(rng));
+
+    // A neighbour just over a pole: flat boxes stop at the query's longitude
+    check_nearest(index, points, 89.95, 0.0, 1, "north pole, k=1");
+    check_nearest(index, points, 89.95, 100.0, 10, "north pole, k=10");
+    check_nearest(index, points, -89.95, -45.0, 10, "south pole, k=10");
+    check_nearest(index, points, 90.0, 0.0, 5, "at the north pole");
+
+    // Nearest neighbours on the other side of +-180
+    check_nearest(index, points, -17.0, 179.999, 10, "antimeridian from the east edge");
+    check_nearest(index, points, -17.0, -179.999, 10, "antimeridian from the west edge");
+    check_nearest(index, points, -17.0, 180.0, 25, "antimeridian at 180");
+
+    // Cap wider than cos(lat) scaling covers at high latitude
+    check_nearest(index, points, 79.5, 16.0, 50, "high latitude, k=50");
+
+    // Random queries over the clusters
+    for (int q = 0; q < 200; q++)
+    {
+        const Point &near = points[rng() % points.size()];
+        double lat = max(-90.0, min(90.0, near.lat + (unit(rng) - 0.5)));
+        double lon = near.lon + (unit(rng) - 0.5);
+        if (lon > 180)
+            lon -= 360;
+        if (lon < -180)
+            lon += 360;
+        check_nearest(index, points, lat, lon, 1 + rng() % 20, "random query " + to_string(q));
+    }
+
+    index.close();
+    unlink(filename.c_str());
+    rmdir(dir);
+
+    if (failures)
+    {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "spatial_index_test: all checks passed" << endl;
+    return 0;
+}